@@ -70,10 +70,6 @@ setup_mcpd_config() {
 start() {
 	logger -p info -t "mcastpamgr" "start_service()"
 
-	if [ -e /tmp/mcastpa-dump ]; then
-		rm /tmp/mcastpa-dump
-	fi
-
 	killall mcast-pa 
 
 	setup_mcpd_config
@@ -182,12 +178,6 @@ iptv_stop() {
 }
 
 show() {
-	if [ -e /var/run/mcast-pa.pid ]; then
-		pid=$(cat /var/run/mcast-pa.pid)
-		kill -USR1 $pid
-		echo " "
-	fi
-
 	echo " "
 	echo "ip route: "
 	echo " "
@@ -237,9 +227,13 @@ show() {
 	echo " "
        logread | grep mcast | tail -n 20	
 	echo " "
-      	if [ -e /tmp/mcastpa-dump ]; then
-      		cat /tmp/mcastpa-dump
-	fi
+	echo "mcastpa-ctl stats: "
+	echo " "
+	mcastpa-ctl stats
+	echo " "
+	echo "mcastpa-snap: "
+	echo " "
+	mcastpa-snap
 	echo " "
 
 }
@@ -252,11 +246,7 @@ vsacfg() {
 	op=$1
 	group=$2
 	device=$3
-	echo "$op $group $device" > /tmp/vsapa.cfg
-	if [ -e /var/run/mcast-pa.pid ]; then
-		pid=$(cat /var/run/mcast-pa.pid)
-		kill -USR2 $pid
-	fi
+	mcastpa-ctl "$op" "$group" "$device"
 
 }
 
@@ -26,10 +26,13 @@
   @date Spring 2016
   @brief Intel Multicast Packet Accelerator
   @details Adds and deletes multicast groups to Intel PPA subsystem using ppacmd, mcast_cli or libmcastfapi
+  exported as the mcast_pa_intel_ops backend named after the variant built
 
  */
 
 #include <mcast-pa.h>
+#include <errno.h>
+#include <arpa/inet.h>
 
 // choose one and only one of these three: 
 
@@ -39,7 +42,29 @@
 
 // are you sure ? 
 
+#if defined(INTEL_MCAST_USE_PPA) || defined(INTEL_MCAST_USE_MCAST_CLI)
+/**
+ * @brief formats a binary request address for a command line
+ * @details empty string if the address is not set
+ * @returns buf
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static char *
+pa_addr_str(struct mcastpa_addr_t *addr, char *buf, size_t len)
+{
+	buf[0] = 0;
+	if (addr->family != AF_UNSPEC)
+		inet_ntop(addr->family, &addr->u, buf, len);
+	return (buf);
+}
+#endif
+
 #ifdef INTEL_MCAST_USE_PPA
+#define PA_INTEL_NAME "ppa"
+#define PA_INTEL_CAPS 0
 /**
  * @brief inits intel mcast subsystem
  * @details 
@@ -48,7 +73,7 @@
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_init(struct mcastpa_system_init_t *msi)
 {
 
@@ -64,27 +89,34 @@ pa_init(struct mcastpa_system_init_t *msi)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_join(struct mcastpa_join_leave_t *mjl)
 {
 	int len = 0;
-	char cmd[128] = { 0 };
-	char *lan;
+	char cmd[512] = { 0 };
+	char group[INET6_ADDRSTRLEN];
+	char srcip[INET6_ADDRSTRLEN];
 	int bridge = 0;
+	int port;
+
+	if (mjl->version != MCASTPA_JL_VERSION)
+		return (-EINVAL);
 
 	if (mjl->flags & MJL_FLAG_BRIDGE)
 		bridge = 1;
 
-	syslog(LOG_NOTICE, "%s:%d join request group %s wan %s\n", __FUNCTION__, __LINE__, mjl->group, mjl->wan);
-	if (mjl->flags & MJL_FLAG_LAN) {
-		syslog(LOG_NOTICE, "%s:%d lan %s\n", __FUNCTION__, __LINE__, mjl->lan);
-	}
-	len += sprintf(cmd + len, "ppacmd addmc -s %d -g %s -w %s -i %s ", bridge, mjl->group, mjl->wan, mjl->srcip);
-
-	lan = strtok(mjl->lan, " ");
-	while (lan != NULL) {
-		len += sprintf(cmd + len, "-l %s ", lan);
-		lan = strtok(NULL, " ");
+	pa_addr_str(&mjl->group, group, sizeof (group));
+	pa_addr_str(&mjl->srcip, srcip, sizeof (srcip));
+	syslog(LOG_NOTICE, "%s:%d join request group %s wan %s\n", __FUNCTION__, __LINE__, group,
+	       mcast_if_name(mjl->wan_ifindex));
+	len += snprintf(cmd + len, sizeof (cmd) - len, "ppacmd addmc -s %d -g %s -w %s -i %s ", bridge, group,
+			mcast_if_name(mjl->wan_ifindex), srcip);
+
+	mcastpa_portmap_for_each(port, &mjl->lan) {
+		if (len >= sizeof (cmd))
+			break;
+		len += snprintf(cmd + len, sizeof (cmd) - len, "-l %s ",
+				mcast_if_name(mcast_port_ifindex(mjl->br_ifindex, port)));
 	}
 
 	system(cmd);
@@ -99,30 +131,38 @@ pa_join(struct mcastpa_join_leave_t *mjl)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_leave(struct mcastpa_join_leave_t *mjl)
 {
 	int len = 0;
-	char cmd[128] = { 0 };
-	char *lan;
+	char cmd[512] = { 0 };
+	char group[INET6_ADDRSTRLEN];
+	char srcip[INET6_ADDRSTRLEN];
 	int bridge = 0;
+	int port;
+
+	if (mjl->version != MCASTPA_JL_VERSION)
+		return (-EINVAL);
 
 	if (mjl->flags & MJL_FLAG_BRIDGE)
 		bridge = 1;
 
-	syslog(LOG_NOTICE, "%s:%d leave request group %s wan %s\n", __FUNCTION__, __LINE__, mjl->group, mjl->wan);
+	pa_addr_str(&mjl->group, group, sizeof (group));
+	pa_addr_str(&mjl->srcip, srcip, sizeof (srcip));
+	syslog(LOG_NOTICE, "%s:%d leave request group %s wan %s\n", __FUNCTION__, __LINE__, group,
+	       mcast_if_name(mjl->wan_ifindex));
 
 	if (mjl->flags & MJL_FLAG_LAN) {
-		syslog(LOG_NOTICE, "%s:%d lan %s\n", __FUNCTION__, __LINE__, mjl->lan);
-		len += sprintf(cmd + len, "ppacmd addmc -s %d -g %s -w %s -i %s ",
-			       bridge, mjl->group, mjl->wan, mjl->srcip);
-		lan = strtok(mjl->lan, " ");
-		while (lan != NULL) {
-			len += sprintf(cmd + len, "-l %s ", lan);
-			lan = strtok(NULL, " ");
+		len += snprintf(cmd + len, sizeof (cmd) - len, "ppacmd addmc -s %d -g %s -w %s -i %s ",
+				bridge, group, mcast_if_name(mjl->wan_ifindex), srcip);
+		mcastpa_portmap_for_each(port, &mjl->lan) {
+			if (len >= sizeof (cmd))
+				break;
+			len += snprintf(cmd + len, sizeof (cmd) - len, "-l %s ",
+					mcast_if_name(mcast_port_ifindex(mjl->br_ifindex, port)));
 		}
 	} else {
-		len += sprintf(cmd + len, "ppacmd addmc -g %s ", mjl->group);
+		len += snprintf(cmd + len, sizeof (cmd) - len, "ppacmd addmc -g %s ", group);
 	}
 
 	system(cmd);
@@ -138,7 +178,7 @@ pa_leave(struct mcastpa_join_leave_t *mjl)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_deinit(struct mcastpa_system_init_t *msi)
 {
 
@@ -150,6 +190,8 @@ pa_deinit(struct mcastpa_system_init_t *msi)
 
 #ifdef INTEL_MCAST_USE_MCAST_CLI
 #define MCAST_CLI "/opt/lantiq/usr/sbin/mcast_cli"
+#define PA_INTEL_NAME "mcast-cli"
+#define PA_INTEL_CAPS 0
 /**
  * @brief inits intel mcast_cli subsystem
  * @details 
@@ -158,7 +200,7 @@ pa_deinit(struct mcastpa_system_init_t *msi)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_init(struct mcastpa_system_init_t *msi)
 {
 	int len = 0;
@@ -182,16 +224,24 @@ pa_init(struct mcastpa_system_init_t *msi)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_join(struct mcastpa_join_leave_t *mjl)
 {
 	int len = 0;
 	char cmd[128] = { 0 };
+	char group[INET6_ADDRSTRLEN];
+	char srcip[INET6_ADDRSTRLEN];
 
-	syslog(LOG_NOTICE, "%s:%d join request group %s wan %s\n", __FUNCTION__, __LINE__, mjl->group, mjl->wan);
+	if (mjl->version != MCASTPA_JL_VERSION)
+		return (-EINVAL);
 
-	len += sprintf(cmd + len, "%s -O ADD -G %s -R %s -S %s -I %s \n", MCAST_CLI,
-		       mjl->group, mjl->wan, mjl->srcip, mjl->lan_dev);
+	pa_addr_str(&mjl->group, group, sizeof (group));
+	pa_addr_str(&mjl->srcip, srcip, sizeof (srcip));
+	syslog(LOG_NOTICE, "%s:%d join request group %s wan %s\n", __FUNCTION__, __LINE__, group,
+	       mcast_if_name(mjl->wan_ifindex));
+
+	len += snprintf(cmd + len, sizeof (cmd) - len, "%s -O ADD -G %s -R %s -S %s -I %s \n", MCAST_CLI,
+			group, mcast_if_name(mjl->wan_ifindex), srcip, mcast_if_name(mjl->lan_ifindex));
 
 	system(cmd);
 	syslog(LOG_NOTICE, "%s:%d cmd %s\n", __FUNCTION__, __LINE__, cmd);
@@ -205,16 +255,24 @@ pa_join(struct mcastpa_join_leave_t *mjl)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_leave(struct mcastpa_join_leave_t *mjl)
 {
 	int len = 0;
 	char cmd[128] = { 0 };
+	char group[INET6_ADDRSTRLEN];
+	char srcip[INET6_ADDRSTRLEN];
 
-	syslog(LOG_NOTICE, "%s:%d join request group %s wan %s\n", __FUNCTION__, __LINE__, mjl->group, mjl->wan);
+	if (mjl->version != MCASTPA_JL_VERSION)
+		return (-EINVAL);
 
-	len += sprintf(cmd + len, "%s -O DEL -G %s -R %s -S %s -I %s \n", MCAST_CLI,
-		       mjl->group, mjl->wan, mjl->srcip, mjl->lan_dev);
+	pa_addr_str(&mjl->group, group, sizeof (group));
+	pa_addr_str(&mjl->srcip, srcip, sizeof (srcip));
+	syslog(LOG_NOTICE, "%s:%d leave request group %s wan %s\n", __FUNCTION__, __LINE__, group,
+	       mcast_if_name(mjl->wan_ifindex));
+
+	len += snprintf(cmd + len, sizeof (cmd) - len, "%s -O DEL -G %s -R %s -S %s -I %s \n", MCAST_CLI,
+			group, mcast_if_name(mjl->wan_ifindex), srcip, mcast_if_name(mjl->lan_ifindex));
 
 	system(cmd);
 	syslog(LOG_NOTICE, "%s:%d cmd %s\n", __FUNCTION__, __LINE__, cmd);
@@ -229,7 +287,7 @@ pa_leave(struct mcastpa_join_leave_t *mjl)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_deinit(struct mcastpa_system_init_t *msi)
 {
 	int len = 0;
@@ -256,6 +314,8 @@ pa_deinit(struct mcastpa_system_init_t *msi)
 #define MCAST_HELPER_DEV_MAJOR_NUM  240
 #define MCAST_HELPER_DEVICE	"/dev/mcast"
 #define MCAST_HELPER_DEV_MINOR_NUM  0
+#define PA_INTEL_NAME "fapi"
+#define PA_INTEL_CAPS MCAST_PA_CAP_UPDATE
 
 /**
  * @brief inits intel mcast_helper module
@@ -312,7 +372,7 @@ pa_init_sos(struct mcastpa_system_init_t *msi)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_init(struct mcastpa_system_init_t *msi)
 {
 	int res = 0;
@@ -327,6 +387,59 @@ pa_init(struct mcastpa_system_init_t *msi)
 	return (res);
 }
 
+/**
+ * @brief fills a fapi member from a binary join leave request
+ * @details addresses are copied as is - only interface names are looked up
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+pa_fapi_member_set(MCAST_MEMBER_t *xmcastcfg, struct mcastpa_join_leave_t *mjl)
+{
+	memset(xmcastcfg, 0, sizeof (MCAST_MEMBER_t));
+	if (mjl->group.family == AF_INET6) {
+		xmcastcfg->groupIP.type = IPV6;
+		xmcastcfg->groupIP.addr.ip6 = mjl->group.u.ip6;
+	} else {
+		xmcastcfg->groupIP.type = IPV4;
+		xmcastcfg->groupIP.addr.ip4 = mjl->group.u.ip4;
+	}
+	if (mjl->srcip.family == AF_INET6) {
+		xmcastcfg->srcIP.type = IPV6;
+		xmcastcfg->srcIP.addr.ip6 = mjl->srcip.u.ip6;
+	} else {
+		xmcastcfg->srcIP.type = IPV4;
+		if (mjl->srcip.family == AF_INET)
+			xmcastcfg->srcIP.addr.ip4 = mjl->srcip.u.ip4;
+	}
+	strncpy(xmcastcfg->rxIntfName, mcast_if_name(mjl->wan_ifindex), IFNAMSIZ - 1);
+	strncpy(xmcastcfg->intfName, mcast_if_name(mjl->lan_ifindex), IFNAMSIZ - 1);
+	memcpy(xmcastcfg->macaddr, mjl->srcmac, ETH_ALEN);
+}
+
+/**
+ * @brief logs a programmed fapi member
+ * @details keeps the channel change NOTICE log readable
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+pa_fapi_member_log(const char *what, MCAST_MEMBER_t *xmcastcfg, int res)
+{
+	char group[INET6_ADDRSTRLEN];
+	char srcip[INET6_ADDRSTRLEN];
+
+	inet_ntop(xmcastcfg->groupIP.type == IPV6 ? AF_INET6 : AF_INET, &xmcastcfg->groupIP.addr, group,
+		  sizeof (group));
+	inet_ntop(xmcastcfg->srcIP.type == IPV6 ? AF_INET6 : AF_INET, &xmcastcfg->srcIP.addr, srcip, sizeof (srcip));
+	syslog(LOG_NOTICE, "%s group %s wan %s lan %s src %s res %d\n", what, group, xmcastcfg->rxIntfName,
+	       xmcastcfg->intfName, srcip, res);
+}
+
 /**
  * @brief joins by libmcastfapi call
  * @details first group join is add additions are updates
@@ -335,42 +448,25 @@ pa_init(struct mcastpa_system_init_t *msi)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_join(struct mcastpa_join_leave_t *mjl)
 {
 	int res = 0;
 	MCAST_MEMBER_t xmcastcfg;
 
-	memset(&xmcastcfg, 0, sizeof (xmcastcfg));
-	xmcastcfg.groupIP.type = IPV4;
-	res = inet_pton(AF_INET, (const char *) mjl->group, &(xmcastcfg.groupIP.addr.ip4.s_addr));
+	if (mjl->version != MCASTPA_JL_VERSION)
+		return (-EINVAL);
 
-	strncpy(xmcastcfg.rxIntfName, mjl->wan, IFNAMSIZ);
-	strncpy(xmcastcfg.intfName, mjl->lan_dev, IFNAMSIZ);
-	memcpy(xmcastcfg.macaddr,mjl->srcmac, ETH_ALEN);
+	pa_fapi_member_set(&xmcastcfg, mjl);
 
-	if (strlen(mjl->srcip) > 4) {
-		xmcastcfg.srcIP.type = IPV4;
-		inet_pton(AF_INET, (const char *) mjl->srcip, &(xmcastcfg.srcIP.addr.ip4.s_addr));
-	}
 	if (mjl->flags & MJL_FLAG_UPDATE) {
 		res = fapi_mch_update_entry(&xmcastcfg);
-		syslog(LOG_NOTICE, "%s:%d join update group %s wan %s lan %s src %s res %d\n", __FUNCTION__, __LINE__,
-		       mjl->group, mjl->wan, mjl->lan_dev, mjl->srcip, res);
+		pa_fapi_member_log("pa_join: join update", &xmcastcfg, res);
 	} else {
 		res = fapi_mch_add_entry(&xmcastcfg);
-		syslog(LOG_NOTICE, "%s:%d join new group %s wan %s lan %s src %s res %d\n", __FUNCTION__, __LINE__,
-		       mjl->group, mjl->wan, mjl->lan_dev, mjl->srcip, res);
-	}
-	if ( mjl->flags & MJL_FLAG_BRIDGE ) {
-		static int count=0;
-		count++;
-		/* on startup in bridge mode we can't process these things back to back */
-		if (count < 12) {
-			sleep(1);
-			syslog(LOG_NOTICE, "%s:%d sleeping after join count %d\n", __FUNCTION__, __LINE__,count);
-		}
+		pa_fapi_member_log("pa_join: join new", &xmcastcfg, res);
 	}
+	/* back to back adds are paced by the programming queue (mcast-pq.c) */
 	return (res);
 }
 
@@ -382,23 +478,18 @@ pa_join(struct mcastpa_join_leave_t *mjl)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_leave(struct mcastpa_join_leave_t *mjl)
 {
 	int res;
 	MCAST_MEMBER_t xmcastcfg;
 
-	memset(&xmcastcfg, 0, sizeof (xmcastcfg));
-	xmcastcfg.groupIP.type = IPV4;
-	inet_pton(AF_INET, mjl->group, &(xmcastcfg.groupIP.addr.ip4.s_addr));
-	strncpy(xmcastcfg.rxIntfName, mjl->wan, IFNAMSIZ);
-	strncpy(xmcastcfg.intfName, mjl->lan_dev, IFNAMSIZ);
-	memcpy(xmcastcfg.macaddr,mjl->srcmac, ETH_ALEN);
-	xmcastcfg.srcIP.type = IPV4;
-	inet_pton(AF_INET, mjl->srcip, &(xmcastcfg.srcIP.addr.ip4.s_addr));
+	if (mjl->version != MCASTPA_JL_VERSION)
+		return (-EINVAL);
+
+	pa_fapi_member_set(&xmcastcfg, mjl);
 	res = fapi_mch_del_entry(&xmcastcfg);
-	syslog(LOG_NOTICE, "%s:%d leave group %s wan %s lan %s src %s res %d\n", __FUNCTION__, __LINE__, mjl->group,
-	       mjl->wan, mjl->lan_dev, mjl->srcip, res);
+	pa_fapi_member_log("pa_leave: leave", &xmcastcfg, res);
 	return (res);
 }
 
@@ -411,7 +502,7 @@ pa_leave(struct mcastpa_join_leave_t *mjl)
  * @callgraph
  * @callergraph
  */
-int
+static int
 pa_deinit(struct mcastpa_system_init_t *msi)
 {
 	int res = 0;
@@ -422,3 +513,16 @@ pa_deinit(struct mcastpa_system_init_t *msi)
 }
 
 #endif				// INTEL_MCAST_USE_MCAST_FAPI
+
+/**
+ * intel backend - the variant chosen above
+ */
+struct mcast_pa_ops_t mcast_pa_intel_ops = {
+	.name = PA_INTEL_NAME,
+	.caps = PA_INTEL_CAPS,
+	.capacity = 0,
+	.init = pa_init,
+	.join = pa_join,
+	.leave = pa_leave,
+	.deinit = pa_deinit,
+};
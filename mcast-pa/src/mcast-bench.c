@@ -0,0 +1,628 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: channel zap storm load generator                                 */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-bench.c
+  @author tim.hayes@smartrg.com
+  @brief mcast-pa-bench - drives the mcast-pa engine with a synthetic channel zap storm
+  @details Builds the same RTM_NEWLINK and RTM_NEWMDB/RTM_DELMDB messages the kernel sends
+  for a population of bridges, ports, stations and channels and feeds them to the unmodified
+  mdb, group table and programming queue code.  Stations zap after a dwell time drawn from
+  a fixed, uniform or exponential distribution, optionally all at once in bursts.  The backend
+  is null or record, optionally with a fixed cost per call, so it runs on any linux host
+  without an accelerator.  At the end events/s, cpu time, RSS and the
+  per stage latency histograms are printed.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <syslog.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <asm/types.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include "if_bridge.h"
+#include <mcast-pa.h>
+#include <mcast-bench.h>
+#include <mcast-hist.h>
+
+#define BENCH_BUF_SIZE 16384			/* one netlink read worth of messages */
+#define BENCH_IFINDEX_BASE 2			/* first synthetic ifindex - 1 is lo */
+
+enum bench_dist_t {
+	BENCH_DIST_FIXED,			/**< every dwell is the mean */
+	BENCH_DIST_UNIFORM,			/**< 0 to twice the mean */
+	BENCH_DIST_EXP,				/**< exponential - poisson zaps */
+};
+
+struct bench_station_t {
+	int br_ifindex;				/**< bridge of the station */
+	int ifindex;				/**< bridge port of the station */
+	int channel;				/**< channel watched - -1 if none */
+	unsigned char mac[ETH_ALEN];		/**< station mac */
+	uint64_t due_ns;			/**< next zap */
+};
+
+struct bench_t {
+	int bridges;				/**< bridges */
+	int ports;				/**< ports per bridge */
+	int stations;				/**< stations spread over all ports */
+	int channels;				/**< distinct groups */
+	int ipv6;				/**< ff3e:: groups instead of 239.1.x.y */
+	int dist;				/**< enum bench_dist_t */
+	double dwell_ms;			/**< mean dwell time */
+	int burst_ms;				/**< interval of zap bursts - 0 for none */
+	int burst_pct;				/**< stations zapping in a burst */
+	int seconds;				/**< run time */
+	unsigned int cost_us;			/**< time spent in each driver call */
+	struct mcast_pa_ops_t *pa;		/**< backend called after the cost */
+	struct mcast_pa_ops_t ops;		/**< backend the engine sees - same name and caps */
+	struct bench_station_t *st;		/**< stations */
+	int *heap;				/**< station indexes by due time */
+	char buf[BENCH_BUF_SIZE];		/**< pending netlink messages */
+	int len;				/**< bytes in buf */
+	uint64_t msgs;				/**< netlink messages generated */
+	uint64_t zaps;				/**< channel changes */
+	uint64_t bursts;			/**< zap bursts */
+	uint64_t calls;				/**< driver calls - written by the worker */
+};
+
+static struct bench_t bench;
+
+/**
+ * @brief benchmark join or leave - fixed cost then the chosen backend
+ * @details runs on the programming worker only
+ * @author tim.hayes@smartrg.com
+ */
+static int
+bench_pa_call(int (*call) (struct mcastpa_join_leave_t *), struct mcastpa_join_leave_t *mjl)
+{
+	struct timespec ts;
+
+	if (bench.cost_us) {
+		ts.tv_sec = bench.cost_us / 1000000;
+		ts.tv_nsec = (bench.cost_us % 1000000) * 1000;
+		while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+			;
+	}
+	__atomic_add_fetch(&bench.calls, 1, __ATOMIC_RELAXED);
+	return (call(mjl));
+}
+
+static int
+bench_pa_join(struct mcastpa_join_leave_t *mjl)
+{
+	return (bench_pa_call(bench.pa->join, mjl));
+}
+
+static int
+bench_pa_leave(struct mcastpa_join_leave_t *mjl)
+{
+	return (bench_pa_call(bench.pa->leave, mjl));
+}
+
+static uint64_t
+bench_now(void)
+{
+	return (mcast_hist_now());
+}
+
+/**
+ * @brief draws a dwell time
+ * @returns ns
+ * @author tim.hayes@smartrg.com
+ */
+static uint64_t
+bench_dwell(void)
+{
+	double ms = bench.dwell_ms;
+
+	switch (bench.dist) {
+	case BENCH_DIST_UNIFORM:
+		ms = drand48() * 2 * bench.dwell_ms;
+		break;
+	case BENCH_DIST_EXP:
+		ms = -bench.dwell_ms * log(1.0 - drand48());
+		break;
+	}
+	return ((uint64_t) (ms * 1000000.0));
+}
+
+/**
+ * @brief hands the pending messages to the engine
+ * @author tim.hayes@smartrg.com
+ */
+static void
+bench_flush(void)
+{
+	mcastpa_bench_input(bench.buf, bench.len);
+	bench.len = 0;
+}
+
+/**
+ * @brief starts a netlink message in the pending buffer
+ * @returns message - flushes first if it may not fit
+ * @author tim.hayes@smartrg.com
+ */
+static struct nlmsghdr *
+bench_msg(int type, int hdrlen)
+{
+	struct nlmsghdr *n;
+
+	if (bench.len + 256 > BENCH_BUF_SIZE)
+		bench_flush();
+	n = (struct nlmsghdr *) (bench.buf + bench.len);
+	memset(n, 0, NLMSG_SPACE(hdrlen));
+	n->nlmsg_len = NLMSG_LENGTH(hdrlen);
+	n->nlmsg_type = type;
+	n->nlmsg_seq = ++bench.msgs;
+	return (n);
+}
+
+/**
+ * @brief appends an attribute
+ * @returns attribute - its length can be extended for nesting
+ * @author tim.hayes@smartrg.com
+ */
+static struct rtattr *
+bench_attr(struct nlmsghdr *n, int type, const void *data, int len)
+{
+	struct rtattr *rta = (struct rtattr *) (((char *) n) + NLMSG_ALIGN(n->nlmsg_len));
+
+	rta->rta_type = type;
+	rta->rta_len = RTA_LENGTH(len);
+	if (len)
+		memcpy(RTA_DATA(rta), data, len);
+	n->nlmsg_len = NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+	return (rta);
+}
+
+/**
+ * @brief closes a nested attribute
+ * @author tim.hayes@smartrg.com
+ */
+static void
+bench_attr_end(struct nlmsghdr *n, struct rtattr *nest)
+{
+	nest->rta_len = (char *) n + n->nlmsg_len - (char *) nest;
+}
+
+/**
+ * @brief queues a RTM_NEWLINK for a bridge or a bridge port
+ * @author tim.hayes@smartrg.com
+ */
+static void
+bench_link(int ifindex, const char *name, int master)
+{
+	struct nlmsghdr *n = bench_msg(RTM_NEWLINK, sizeof (struct ifinfomsg));
+	struct ifinfomsg *ifi = NLMSG_DATA(n);
+	struct rtattr *nest;
+	uint32_t m = master;
+
+	ifi->ifi_family = AF_UNSPEC;
+	ifi->ifi_index = ifindex;
+	ifi->ifi_flags = IFF_UP | IFF_RUNNING;
+	bench_attr(n, IFLA_IFNAME, name, strlen(name) + 1);
+	if (master) {
+		bench_attr(n, IFLA_MASTER, &m, sizeof (m));
+	} else {
+		nest = bench_attr(n, IFLA_LINKINFO, NULL, 0);
+		bench_attr(n, IFLA_INFO_KIND, "bridge", strlen("bridge") + 1);
+		bench_attr_end(n, nest);
+	}
+	bench.len += NLMSG_ALIGN(n->nlmsg_len);
+}
+
+/**
+ * @brief queues a RTM_NEWMDB or RTM_DELMDB for a station and channel
+ * @author tim.hayes@smartrg.com
+ */
+static void
+bench_mdb(int type, struct bench_station_t *st, int channel)
+{
+	struct nlmsghdr *n = bench_msg(type, sizeof (struct br_port_msg));
+	struct br_port_msg *bpm = NLMSG_DATA(n);
+	struct rtattr *mdb;
+	struct rtattr *entry;
+	struct br_mdb_entry e;
+
+	bpm->family = AF_BRIDGE;
+	bpm->ifindex = st->br_ifindex;
+
+	memset(&e, 0, sizeof (e));
+	e.ifindex = st->ifindex;
+	e.state = MDB_TEMPORARY;
+	if (bench.ipv6) {
+		e.addr.proto = htons(ETH_P_IPV6);
+		e.addr.u.ip6.s6_addr[0] = 0xff;
+		e.addr.u.ip6.s6_addr[1] = 0x3e;
+		e.addr.u.ip6.s6_addr[14] = channel >> 8;
+		e.addr.u.ip6.s6_addr[15] = channel & 0xff;
+	} else {
+		e.addr.proto = htons(ETH_P_IP);
+		e.addr.u.ip4 = htonl(0xef010000 | (channel & 0xffff));
+	}
+	memcpy(e.src_addr.eth_addr, st->mac, ETH_ALEN);
+
+	mdb = bench_attr(n, MDBA_MDB, NULL, 0);
+	entry = bench_attr(n, MDBA_MDB_ENTRY, NULL, 0);
+	bench_attr(n, MDBA_MDB_ENTRY_INFO, &e, sizeof (e));
+	bench_attr_end(n, entry);
+	bench_attr_end(n, mdb);
+	bench.len += NLMSG_ALIGN(n->nlmsg_len);
+}
+
+/**
+ * @brief moves a station to another channel
+ * @details leave of the old channel and join of the new one back to back as a set top box does
+ * @author tim.hayes@smartrg.com
+ */
+static void
+bench_zap(struct bench_station_t *st)
+{
+	int channel;
+
+	channel = lrand48() % bench.channels;
+	if ((channel == st->channel) && (bench.channels > 1))
+		channel = (channel + 1) % bench.channels;
+	if (st->channel >= 0)
+		bench_mdb(RTM_DELMDB, st, st->channel);
+	bench_mdb(RTM_NEWMDB, st, channel);
+	st->channel = channel;
+	bench.zaps++;
+}
+
+static void
+bench_heap_swap(int a, int b)
+{
+	int t = bench.heap[a];
+
+	bench.heap[a] = bench.heap[b];
+	bench.heap[b] = t;
+}
+
+/**
+ * @brief restores the heap order after the due time of the root grew
+ * @author tim.hayes@smartrg.com
+ */
+static void
+bench_heap_down(int i)
+{
+	int c;
+
+	for (;;) {
+		c = 2 * i + 1;
+		if (c >= bench.stations)
+			return;
+		if ((c + 1 < bench.stations) && (bench.st[bench.heap[c + 1]].due_ns < bench.st[bench.heap[c]].due_ns))
+			c++;
+		if (bench.st[bench.heap[i]].due_ns <= bench.st[bench.heap[c]].due_ns)
+			return;
+		bench_heap_swap(i, c);
+		i = c;
+	}
+}
+
+/**
+ * @brief reads a field of /proc/self/status
+ * @returns kB
+ * @author tim.hayes@smartrg.com
+ */
+static long
+bench_status_kb(const char *field)
+{
+	char line[128];
+	long kb = 0;
+	FILE *f = fopen("/proc/self/status", "r");
+
+	if (f == NULL)
+		return (0);
+	while (fgets(line, sizeof (line), f)) {
+		if (strncmp(line, field, strlen(field)) == 0) {
+			kb = strtol(line + strlen(field) + 1, NULL, 10);
+			break;
+		}
+	}
+	fclose(f);
+	return (kb);
+}
+
+/**
+ * @brief sleeps until the next station is due, the engine has work or the run ends
+ * @author tim.hayes@smartrg.com
+ */
+static void
+bench_wait(uint64_t until)
+{
+	struct timespec ts;
+	uint64_t now = bench_now();
+	int timeout = mcastpa_bench_timeout();
+
+	if ((timeout >= 0) && (now + (uint64_t) timeout * 1000000 < until))
+		until = now + (uint64_t) timeout * 1000000;
+	if (until <= now)
+		return;
+	ts.tv_sec = (until - now) / 1000000000;
+	ts.tv_nsec = (until - now) % 1000000000;
+	nanosleep(&ts, NULL);
+}
+
+static void
+usage(void)
+{
+	printf("mcast-pa-bench [options]\n");
+	printf(" -b bridges         (1)\n");
+	printf(" -p ports per bridge (4)\n");
+	printf(" -s stations        (16)\n");
+	printf(" -g channels        (200)\n");
+	printf(" -d mean dwell ms   (5000)\n");
+	printf(" -z zaps per second overall - sets the mean dwell\n");
+	printf(" -D fixed|uniform|exp dwell distribution (exp)\n");
+	printf(" -K burst interval ms - every station in the burst zaps at once (0)\n");
+	printf(" -k percent of stations in a burst (100)\n");
+	printf(" -t seconds         (10)\n");
+	printf(" -Z zap window ms   (10)\n");
+	printf(" -R driver requests per second - 0 is unlimited (0)\n");
+	printf(" -B driver burst    (16)\n");
+	printf(" -c us per driver call (0)\n");
+	printf(" -P backend         (null) one of: ");
+	mcast_pa_ops_list(stdout);
+	printf(" -r file - record backend writing every driver call to file\n");
+	printf(" -6 ipv6 groups\n");
+	printf(" -S random seed\n");
+	printf(" -v log engine messages to syslog\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct mcastpa_bench_params_t bp;
+	struct bench_station_t *st;
+	struct rusage ru;
+	char name[IFNAMSIZ];
+	uint64_t start;
+	uint64_t end;
+	uint64_t now;
+	uint64_t next_burst = 0;
+	uint64_t run_ns;
+	double zap_rate = 0;
+	double cpu;
+	long seed = 1;
+	const char *backend = "null";
+	int verbose = 0;
+	int opt;
+	int i;
+	int b;
+
+	memset(&bp, 0, sizeof (bp));
+	bp.zap_window = 10;
+	bp.pa_burst = 16;
+	bench.bridges = 1;
+	bench.ports = 4;
+	bench.stations = 16;
+	bench.channels = 200;
+	bench.dwell_ms = 5000;
+	bench.dist = BENCH_DIST_EXP;
+	bench.burst_pct = 100;
+	bench.seconds = 10;
+
+	while ((opt = getopt(argc, argv, "b:p:s:g:d:z:D:K:k:t:Z:R:B:c:P:r:6S:vh")) != -1) {
+		switch (opt) {
+		case 'b':
+			bench.bridges = atoi(optarg);
+			break;
+		case 'p':
+			bench.ports = atoi(optarg);
+			break;
+		case 's':
+			bench.stations = atoi(optarg);
+			break;
+		case 'g':
+			bench.channels = atoi(optarg);
+			break;
+		case 'd':
+			bench.dwell_ms = atof(optarg);
+			break;
+		case 'z':
+			zap_rate = atof(optarg);
+			break;
+		case 'D':
+			if (strcmp(optarg, "fixed") == 0)
+				bench.dist = BENCH_DIST_FIXED;
+			else if (strcmp(optarg, "uniform") == 0)
+				bench.dist = BENCH_DIST_UNIFORM;
+			else
+				bench.dist = BENCH_DIST_EXP;
+			break;
+		case 'K':
+			bench.burst_ms = atoi(optarg);
+			break;
+		case 'k':
+			bench.burst_pct = atoi(optarg);
+			break;
+		case 't':
+			bench.seconds = atoi(optarg);
+			break;
+		case 'Z':
+			bp.zap_window = atoi(optarg);
+			break;
+		case 'R':
+			bp.pa_rate = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			bp.pa_burst = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			bench.cost_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			backend = optarg;
+			break;
+		case 'r':
+			mcast_pa_record_path(optarg);
+			backend = "record";
+			break;
+		case '6':
+			bench.ipv6 = 1;
+			break;
+		case 'S':
+			seed = atol(optarg);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage();
+			exit(0);
+		}
+	}
+	if ((bench.bridges < 1) || (bench.ports < 1) || (bench.stations < 1) || (bench.channels < 1) ||
+	    (bench.channels > 0xffff)) {
+		usage();
+		exit(-1);
+	}
+	bench.pa = mcast_pa_ops_get(backend);
+	if (bench.pa == NULL) {
+		usage();
+		exit(-1);
+	}
+	bench.ops = *bench.pa;
+	bench.ops.join = bench_pa_join;
+	bench.ops.leave = bench_pa_leave;
+	if (zap_rate > 0)
+		bench.dwell_ms = bench.stations * 1000.0 / zap_rate;
+
+	openlog("mcast-pa-bench", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_LOCAL1);
+	setlogmask(verbose ? LOG_UPTO(LOG_INFO) : LOG_UPTO(LOG_ERR));
+	srand48(seed);
+
+	bp.src.family = bench.ipv6 ? AF_INET6 : AF_INET;
+	inet_pton(bp.src.family, bench.ipv6 ? "2001:db8::1" : "192.0.2.1", &bp.src.u);
+	bp.max_groups = bench.channels + 16;
+	bp.max_members = bench.stations + 1024;
+	bp.pa = &bench.ops;
+	if (mcastpa_bench_init(&bp) < 0) {
+		printf("cannot start the engine\n");
+		exit(-1);
+	}
+
+	bench.st = calloc(bench.stations, sizeof (struct bench_station_t));
+	bench.heap = calloc(bench.stations, sizeof (int));
+	if ((bench.st == NULL) || (bench.heap == NULL)) {
+		printf("cannot allocate %d stations\n", bench.stations);
+		exit(-1);
+	}
+
+	/* bridges then their ports */
+	for (b = 0; b < bench.bridges; b++) {
+		snprintf(name, sizeof (name), "bench-br%d", b);
+		bench_link(BENCH_IFINDEX_BASE + b, name, 0);
+		for (i = 0; i < bench.ports; i++) {
+			snprintf(name, sizeof (name), "bench-p%d.%d", b, i);
+			bench_link(BENCH_IFINDEX_BASE + bench.bridges + b * bench.ports + i, name,
+				   BENCH_IFINDEX_BASE + b);
+		}
+	}
+	bench_flush();
+
+	start = bench_now();
+	for (i = 0; i < bench.stations; i++) {
+		st = &bench.st[i];
+		b = i % bench.bridges;
+		st->br_ifindex = BENCH_IFINDEX_BASE + b;
+		st->ifindex = BENCH_IFINDEX_BASE + bench.bridges + b * bench.ports + (i / bench.bridges) % bench.ports;
+		st->channel = -1;
+		st->mac[0] = 0x02;
+		st->mac[2] = i >> 24;
+		st->mac[3] = i >> 16;
+		st->mac[4] = i >> 8;
+		st->mac[5] = i;
+		/* first join spread over one dwell time */
+		st->due_ns = start + (uint64_t) (drand48() * bench.dwell_ms * 1000000.0);
+		bench.heap[i] = i;
+	}
+	for (i = bench.stations / 2 - 1; i >= 0; i--)
+		bench_heap_down(i);
+
+	end = start + (uint64_t) bench.seconds * 1000000000ULL;
+	if (bench.burst_ms)
+		next_burst = start + (uint64_t) bench.burst_ms * 1000000;
+
+	printf("backend %s cost %u us\n", bench.pa->name, bench.cost_us);
+	printf("bridges %d ports %d stations %d channels %d dwell %.0f ms %s bursts %d ms %d%% for %d s\n",
+	       bench.bridges, bench.ports, bench.stations, bench.channels, bench.dwell_ms,
+	       bench.dist == BENCH_DIST_FIXED ? "fixed" : bench.dist == BENCH_DIST_UNIFORM ? "uniform" : "exp",
+	       bench.burst_ms, bench.burst_pct, bench.seconds);
+
+	while ((now = bench_now()) < end) {
+		while (bench.st[bench.heap[0]].due_ns <= now) {
+			st = &bench.st[bench.heap[0]];
+			bench_zap(st);
+			st->due_ns = now + bench_dwell();
+			bench_heap_down(0);
+		}
+		if (next_burst && (now >= next_burst)) {
+			for (i = 0; i < bench.stations; i++) {
+				if (lrand48() % 100 < bench.burst_pct)
+					bench_zap(&bench.st[i]);
+			}
+			bench.bursts++;
+			next_burst += (uint64_t) bench.burst_ms * 1000000;
+		}
+		bench_flush();
+		bench_wait(next_burst && next_burst < bench.st[bench.heap[0]].due_ns ?
+			   next_burst : bench.st[bench.heap[0]].due_ns < end ? bench.st[bench.heap[0]].due_ns : end);
+	}
+
+	/* let the coalescing window and the driver queue run empty */
+	while (mcastpa_bench_timeout() >= 0) {
+		bench_wait(end);
+		bench_flush();
+	}
+	run_ns = bench_now() - start;
+	mcastpa_bench_deinit();
+
+	getrusage(RUSAGE_SELF, &ru);
+	cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000000.0;
+	printf("netlink events %llu zaps %llu bursts %llu driver calls %llu in %.3f s\n",
+	       (unsigned long long) bench.msgs, (unsigned long long) bench.zaps, (unsigned long long) bench.bursts,
+	       (unsigned long long) __atomic_load_n(&bench.calls, __ATOMIC_RELAXED), run_ns / 1e9);
+	printf("events/s %.0f events per cpu s %.0f cpu %.3f s\n", bench.msgs / (run_ns / 1e9),
+	       cpu > 0 ? bench.msgs / cpu : 0, cpu);
+	printf("rss %ld kB peak %ld kB\n", bench_status_kb("VmRSS:"), bench_status_kb("VmHWM:"));
+	mcastpa_bench_show(stdout);
+
+	closelog();
+	return (0);
+}
@@ -0,0 +1,56 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: channel zap storm load generator                                 */
+/*                                                                           */
+/*****************************************************************************/
+#ifndef MCAST_BENCH_H
+#define MCAST_BENCH_H
+
+#include <stdio.h>
+#include <mcast-pa.h>
+
+/**
+ * engine settings for a benchmark run
+ */
+struct mcastpa_bench_params_t {
+	int zap_window;				/**< mdb coalescing window in ms */
+	unsigned int pa_rate;			/**< cap on driver requests per second - 0 is none */
+	unsigned int pa_burst;			/**< token bucket depth */
+	unsigned int max_groups;		/**< group pool size */
+	unsigned int max_members;		/**< member pool size */
+	struct mcastpa_addr_t src;		/**< video source used for every group */
+	struct mcast_pa_ops_t *pa;		/**< accelerator backend */
+	unsigned int pq_size;			/**< driver queue size - 0 for the default */
+};
+
+struct br_mdb_entry;
+
+/* mcast-pa.c built with MCAST_PA_BENCH */
+int mcastpa_bench_init(struct mcastpa_bench_params_t *bp);
+void mcastpa_bench_input(char *buf, int len);
+int mcastpa_bench_timeout(void);
+void mcastpa_bench_show(FILE * f);
+void mcastpa_bench_deinit(void);
+
+/* group table microbenchmark - mcast-tbench.c */
+int mcastpa_bench_table_add(int br_ifindex, struct br_mdb_entry *e);
+int mcastpa_bench_table_del(struct br_mdb_entry *e);
+void mcastpa_bench_table_teardown(void);
+unsigned long long mcastpa_bench_allocs(void);
+
+#endif
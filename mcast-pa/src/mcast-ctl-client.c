@@ -0,0 +1,198 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: control socket client                                            */
+/*                                                                           */
+/*****************************************************************************/
+
+
+/**
+
+  @file mcast-ctl-client.c
+  @author tim.hayes@smartrg.com
+  @brief mcastpa-ctl - sends requests to the mcast-pa control socket
+  @details The words on the command line make one request, without any the requests are
+  read from stdin one per line so a whole batch goes in one connection.  Replies are
+  printed as they come, the exit status is 1 if any request failed.
+
+      mcastpa-ctl join 239.1.1.1 eth0.1
+      mcastpa-ctl query
+      printf 'join 239.1.1.1 eth0.1\njoin 239.1.1.2 eth0.2\n' | mcastpa-ctl
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <mcast-ctl.h>
+
+static void
+usage(void)
+{
+	printf("mcastpa-ctl [-s socket] [request]\n");
+	printf(" -s control socket (%s)\n", MCAST_CTL_PATH);
+	printf(" requests - one per line on stdin when none is given:\n");
+	printf("  join <group> <device> [srcmac]\n");
+	printf("  leave <group> <device> [srcmac]\n");
+	printf("  query [group]\n");
+	printf("  stats\n");
+}
+
+/**
+ * @brief prints a reply line and notes a failed request
+ * @returns 1 if the line is an error status line 0 otherwise
+ * @author tim.hayes@smartrg.com
+ */
+static int
+reply_line(const char *line)
+{
+	char word[16];
+	unsigned int seq;
+
+	fputs(line, stdout);
+	return ((sscanf(line, "%u %15s", &seq, word) == 2) && (strcmp(word, "error") == 0));
+}
+
+/**
+ * @brief reads all of stdin
+ * @returns buffer or NULL
+ * @author tim.hayes@smartrg.com
+ */
+static char *
+read_all(FILE * f, size_t *len)
+{
+	size_t size = 4096;
+	char *buf = malloc(size);
+	char *p;
+	size_t n;
+
+	*len = 0;
+	while (buf && ((n = fread(buf + *len, 1, size - *len, f)) > 0)) {
+		*len += n;
+		if (*len == size) {
+			size *= 2;
+			p = realloc(buf, size);
+			if (p == NULL)
+				free(buf);
+			buf = p;
+		}
+	}
+	return (buf);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *path = MCAST_CTL_PATH;
+	struct sockaddr_un sun;
+	struct pollfd pfd;
+	char rbuf[4096];
+	char line[MCAST_CTL_LINE_MAX + 1];
+	int line_len = 0;
+	char *req;
+	size_t len = 0;
+	size_t sent = 0;
+	ssize_t n;
+	int failed = 0;
+	int fd;
+	int opt;
+	int i;
+	int j;
+
+	while ((opt = getopt(argc, argv, "s:h")) != -1) {
+		switch (opt) {
+		case 's':
+			path = optarg;
+			break;
+		default:
+			usage();
+			exit(0);
+		}
+	}
+
+	if (optind < argc) {
+		for (i = optind; i < argc; i++)
+			len += strlen(argv[i]) + 1;
+		req = malloc(len + 1);
+		if (req == NULL)
+			exit(2);
+		req[0] = '\0';
+		for (i = optind; i < argc; i++) {
+			strcat(req, argv[i]);
+			strcat(req, (i + 1 < argc) ? " " : "\n");
+		}
+	} else {
+		req = read_all(stdin, &len);
+		if (req == NULL)
+			exit(2);
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	memset(&sun, 0, sizeof (sun));
+	sun.sun_family = AF_UNIX;
+	snprintf(sun.sun_path, sizeof (sun.sun_path), "%s", path);
+	if ((fd < 0) || (connect(fd, (struct sockaddr *) &sun, sizeof (sun)) < 0)) {
+		fprintf(stderr, "cannot connect to %s: %s\n", path, strerror(errno));
+		exit(2);
+	}
+	if (len == 0)
+		shutdown(fd, SHUT_WR);
+
+	/* send and receive together - the daemon stops reading while its replies are not read */
+	while (1) {
+		pfd.fd = fd;
+		pfd.events = POLLIN | ((sent < len) ? POLLOUT : 0);
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if ((pfd.revents & POLLOUT) && (sent < len)) {
+			n = send(fd, req + sent, len - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+			if ((n < 0) && (errno != EAGAIN) && (errno != EINTR))
+				break;
+			if (n > 0)
+				sent += n;
+			if (sent == len)
+				shutdown(fd, SHUT_WR);
+		}
+		if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+			n = recv(fd, rbuf, sizeof (rbuf), 0);
+			if (n <= 0)
+				break;
+			for (j = 0; j < n; j++) {
+				if (line_len < MCAST_CTL_LINE_MAX - 1)
+					line[line_len++] = rbuf[j];
+				if (rbuf[j] != '\n')
+					continue;
+				if (line[line_len - 1] != '\n')
+					line[line_len++] = '\n';
+				line[line_len] = '\0';
+				failed |= reply_line(line);
+				line_len = 0;
+			}
+		}
+	}
+	close(fd);
+	free(req);
+	return (failed);
+}
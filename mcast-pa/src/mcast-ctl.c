@@ -0,0 +1,394 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: local control socket                                             */
+/*                                                                           */
+/*****************************************************************************/
+
+
+/**
+
+  @file mcast-ctl.c
+  @author tim.hayes@smartrg.com
+  @brief Unix stream socket for local control requests
+  @details A client sends any number of newline terminated requests, one per line, and
+  shuts down its side when done.  Every request gets a status line, in order, prefixed by
+  its number within the connection:
+
+      <n> ok [result]
+      <n> error <errno> <text>
+
+  A request may produce data lines before its status line, with the same prefix.  The
+  sockets are non blocking and watched by the main loop, replies are buffered until the
+  client reads them, so a slow client never holds up netlink processing.
+
+ */
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <mcast-ctl.h>
+
+/**
+ * @brief appends bytes to the reply buffer of a connection
+ * @returns 0 if OK -1 if out of memory
+ * @author tim.hayes@smartrg.com
+ */
+static int
+mcast_ctl_out(struct mcast_ctl_conn_t *c, const char *buf, size_t len)
+{
+	size_t size;
+	char *out;
+
+	if (c->out_len + len > c->out_size) {
+		size = c->out_size ? c->out_size : 4096;
+		while (size < c->out_len + len)
+			size *= 2;
+		out = realloc(c->out, size);
+		if (out == NULL)
+			return (-1);
+		c->out = out;
+		c->out_size = size;
+	}
+	memcpy(c->out + c->out_len, buf, len);
+	c->out_len += len;
+	return (0);
+}
+
+/**
+ * @brief closes a connection and frees its slot
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_ctl_close(struct mcast_ctl_conn_t *c)
+{
+	mcast_loop_del(c->ctl->loop, c->fd);
+	close(c->fd);
+	free(c->out);
+	c->out = NULL;
+	c->out_len = 0;
+	c->out_size = 0;
+	c->fd = -1;
+}
+
+/**
+ * @brief writes as much of the pending replies as the socket takes
+ * @returns 0 if OK -1 if the connection was closed
+ * @note watches for EPOLLOUT instead of EPOLLIN while replies are pending so a client that
+ * @note does not read stops being read
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcast_ctl_flush(struct mcast_ctl_conn_t *c)
+{
+	ssize_t n;
+
+	while (c->out_len > 0) {
+		n = send(c->fd, c->out, c->out_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				break;
+			mcast_ctl_close(c);
+			return (-1);
+		}
+		memmove(c->out, c->out + n, c->out_len - n);
+		c->out_len -= n;
+	}
+	if (c->out_len > 0)
+		return (mcast_loop_mod(c->ctl->loop, c->fd, EPOLLOUT));
+	if (c->eof) {
+		mcast_ctl_close(c);
+		return (-1);
+	}
+	return (mcast_loop_mod(c->ctl->loop, c->fd, EPOLLIN));
+}
+
+/**
+ * @brief adds a data line to the reply of a request
+ * @details the request number is prepended and the newline appended
+ * @returns 0 if OK -1 if out of memory
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_ctl_printf(struct mcast_ctl_req_t *req, const char *fmt, ...)
+{
+	char buf[MCAST_CTL_LINE_MAX];
+	va_list ap;
+	int len;
+	int n;
+
+	len = snprintf(buf, sizeof (buf), "%u ", req->seq);
+	va_start(ap, fmt);
+	n = vsnprintf(buf + len, sizeof (buf) - len - 1, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return (-1);
+	len += (n < (int) sizeof (buf) - len - 1) ? n : (int) sizeof (buf) - len - 2;
+	buf[len++] = '\n';
+	return (mcast_ctl_out(req->conn, buf, len));
+}
+
+/**
+ * @brief runs one request line and queues its status line
+ * @details blank lines and lines starting with # are not requests
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_ctl_request(struct mcast_ctl_conn_t *c, char *line)
+{
+	struct mcast_ctl_req_t req;
+	char *save = NULL;
+	char *tok;
+	int res;
+
+	memset(&req, 0, sizeof (req));
+	for (tok = strtok_r(line, " \t\r", &save); tok && (req.argc < MCAST_CTL_ARGS);
+	     tok = strtok_r(NULL, " \t\r", &save))
+		req.argv[req.argc++] = tok;
+	if ((req.argc == 0) || (req.argv[0][0] == '#'))
+		return;
+	req.seq = ++c->seq;
+	req.conn = c;
+	c->ctl->requests++;
+	res = (tok != NULL) ? -E2BIG : c->ctl->fn(&req);
+	if (res == 0) {
+		mcast_ctl_printf(&req, "ok%s%s", req.res[0] ? " " : "", req.res);
+	} else {
+		c->ctl->errors++;
+		mcast_ctl_printf(&req, "error %d %s", -res, strerror(-res));
+	}
+}
+
+/**
+ * @brief splits what was read into request lines
+ * @details a line longer than MCAST_CTL_LINE_MAX is answered with an error and skipped
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_ctl_input(struct mcast_ctl_conn_t *c, const char *buf, size_t len)
+{
+	struct mcast_ctl_req_t req;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] != '\n') {
+			if (c->line_len < MCAST_CTL_LINE_MAX - 1)
+				c->line[c->line_len++] = buf[i];
+			else
+				c->overlong = 1;
+			continue;
+		}
+		c->line[c->line_len] = '\0';
+		if (c->overlong) {
+			memset(&req, 0, sizeof (req));
+			req.seq = ++c->seq;
+			req.conn = c;
+			c->ctl->requests++;
+			c->ctl->errors++;
+			mcast_ctl_printf(&req, "error %d %s", ENAMETOOLONG, strerror(ENAMETOOLONG));
+		} else {
+			mcast_ctl_request(c, c->line);
+		}
+		c->line_len = 0;
+		c->overlong = 0;
+	}
+}
+
+/**
+ * @brief connection readable, writable or closed
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_ctl_event(int fd, uint32_t events, void *arg)
+{
+	static char buf[MCAST_CTL_IN_SIZE];
+	struct mcast_ctl_conn_t *c = (struct mcast_ctl_conn_t *) arg;
+	ssize_t n;
+
+	if (c->out_len == 0) {
+		n = recv(fd, buf, sizeof (buf), MSG_DONTWAIT);
+		if (n < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				return;
+			mcast_ctl_close(c);
+			return;
+		}
+		if (n == 0) {
+			/* a last line without newline still counts */
+			if (c->line_len > 0)
+				mcast_ctl_input(c, "\n", 1);
+			c->eof = 1;
+		} else {
+			mcast_ctl_input(c, buf, n);
+		}
+	}
+	mcast_ctl_flush(c);
+}
+
+/**
+ * @brief new client on the listening socket
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_ctl_accept(int fd, uint32_t events, void *arg)
+{
+	struct mcast_ctl_t *ctl = (struct mcast_ctl_t *) arg;
+	struct mcast_ctl_conn_t *c = NULL;
+	int cfd;
+	int i;
+
+	cfd = accept(fd, NULL, NULL);
+	if (cfd < 0)
+		return;
+	fcntl(cfd, F_SETFL, O_NONBLOCK);
+	fcntl(cfd, F_SETFD, FD_CLOEXEC);
+	for (i = 0; i < MCAST_CTL_CLIENTS; i++) {
+		if (ctl->conn[i].fd < 0) {
+			c = &ctl->conn[i];
+			break;
+		}
+	}
+	if ((c == NULL) || (mcast_loop_add(ctl->loop, cfd, mcast_ctl_event, c) < 0)) {
+		if (ctl->refused++ == 0)
+			syslog(LOG_NOTICE, "%s:%d control connection refused - %d busy\n", __FUNCTION__, __LINE__,
+			       MCAST_CTL_CLIENTS);
+		close(cfd);
+		return;
+	}
+	memset(c, 0, sizeof (struct mcast_ctl_conn_t));
+	c->fd = cfd;
+	c->ctl = ctl;
+}
+
+/**
+ * @brief opens the control socket
+ * @details only root may connect
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_ctl_init(struct mcast_ctl_t *ctl, struct mcast_loop_t *loop, const char *path, mcast_ctl_fn_t fn)
+{
+	struct sockaddr_un sun;
+	int i;
+
+	memset(ctl, 0, sizeof (struct mcast_ctl_t));
+	for (i = 0; i < MCAST_CTL_CLIENTS; i++)
+		ctl->conn[i].fd = -1;
+	ctl->path = path;
+	ctl->fn = fn;
+	ctl->loop = loop;
+	if (strlen(path) >= sizeof (sun.sun_path)) {
+		ctl->fd = -1;
+		return (-1);
+	}
+
+	ctl->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (ctl->fd < 0) {
+		syslog(LOG_ERR, "%s:%d socket %s\n", __FUNCTION__, __LINE__, strerror(errno));
+		return (-1);
+	}
+	memset(&sun, 0, sizeof (sun));
+	sun.sun_family = AF_UNIX;
+	strcpy(sun.sun_path, path);
+	unlink(path);
+	if ((bind(ctl->fd, (struct sockaddr *) &sun, sizeof (sun)) < 0) || (chmod(path, 0600) < 0) ||
+	    (listen(ctl->fd, MCAST_CTL_CLIENTS) < 0) || (mcast_loop_add(loop, ctl->fd, mcast_ctl_accept, ctl) < 0)) {
+		syslog(LOG_ERR, "%s:%d cannot listen on %s %s\n", __FUNCTION__, __LINE__, path, strerror(errno));
+		close(ctl->fd);
+		ctl->fd = -1;
+		return (-1);
+	}
+	return (0);
+}
+
+/**
+ * @brief closes every connection and the control socket
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_ctl_deinit(struct mcast_ctl_t *ctl)
+{
+	int i;
+
+	if (ctl->fd < 0)
+		return;
+	for (i = 0; i < MCAST_CTL_CLIENTS; i++) {
+		if (ctl->conn[i].fd >= 0)
+			mcast_ctl_close(&ctl->conn[i]);
+	}
+	mcast_loop_del(ctl->loop, ctl->fd);
+	close(ctl->fd);
+	unlink(ctl->path);
+	ctl->fd = -1;
+}
+
+/**
+ * @brief shows the control socket counters
+ * @author tim.hayes@smartrg.com
+ */
+void
+mcast_ctl_show(FILE * f, struct mcast_ctl_t *ctl)
+{
+	int clients = 0;
+	int i;
+
+	for (i = 0; i < MCAST_CTL_CLIENTS; i++) {
+		if (ctl->conn[i].fd >= 0)
+			clients++;
+	}
+	fprintf(f, "control: clients %d requests %llu errors %llu refused %llu\n", clients,
+		(unsigned long long) ctl->requests, (unsigned long long) ctl->errors,
+		(unsigned long long) ctl->refused);
+}
@@ -0,0 +1,83 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: local control socket                                             */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifndef MCAST_CTL_H
+#define MCAST_CTL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <mcast-loop.h>
+
+#define MCAST_CTL_PATH "/var/run/mcast-pa.sock"
+#define MCAST_CTL_CLIENTS 4			/* connections served at once */
+#define MCAST_CTL_LINE_MAX 256			/* longest request line */
+#define MCAST_CTL_ARGS 8			/* words in a request line */
+#define MCAST_CTL_IN_SIZE 16384			/* request bytes taken per read */
+
+/**
+ * one request line - the handler fills res and may add data lines with mcast_ctl_printf()
+ */
+struct mcast_ctl_req_t {
+	unsigned int seq;			/**< request number within the connection - starts at 1 */
+	int argc;				/**< words in argv */
+	char *argv[MCAST_CTL_ARGS];		/**< request words - argv[0] is the operation */
+	char res[64];				/**< text after "ok" in the status line */
+	struct mcast_ctl_conn_t *conn;		/**< connection the reply goes to */
+};
+
+typedef int (*mcast_ctl_fn_t) (struct mcast_ctl_req_t *req);
+
+/**
+ * one client connection
+ */
+struct mcast_ctl_conn_t {
+	int fd;					/**< accepted socket - -1 if the slot is free */
+	struct mcast_ctl_t *ctl;		/**< server the connection belongs to */
+	unsigned int seq;			/**< requests seen */
+	char line[MCAST_CTL_LINE_MAX];		/**< partial request line carried between reads */
+	int line_len;				/**< bytes in line */
+	int overlong;				/**< rest of a too long line is being skipped */
+	int eof;				/**< client shut down its side - close once the replies are out */
+	char *out;				/**< replies not yet written */
+	size_t out_len;				/**< bytes in out */
+	size_t out_size;			/**< allocated size of out */
+};
+
+/**
+ * control socket server
+ */
+struct mcast_ctl_t {
+	int fd;					/**< listening socket - -1 if not open */
+	const char *path;			/**< socket path */
+	mcast_ctl_fn_t fn;			/**< request handler */
+	struct mcast_loop_t *loop;		/**< loop the sockets are watched by */
+	struct mcast_ctl_conn_t conn[MCAST_CTL_CLIENTS];	/**< connections */
+	uint64_t requests;			/**< requests handled */
+	uint64_t errors;			/**< requests that failed */
+	uint64_t refused;			/**< connections refused because all slots were busy */
+};
+
+int mcast_ctl_init(struct mcast_ctl_t *ctl, struct mcast_loop_t *loop, const char *path, mcast_ctl_fn_t fn);
+int mcast_ctl_printf(struct mcast_ctl_req_t *req, const char *fmt, ...) __attribute__ ((format(printf, 2, 3)));
+void mcast_ctl_deinit(struct mcast_ctl_t *ctl);
+void mcast_ctl_show(FILE * f, struct mcast_ctl_t *ctl);
+
+#endif
@@ -0,0 +1,161 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: join and leave latency histograms                                */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-hist.c
+  @author tim.hayes@smartrg.com
+  @brief Latency histograms per stage, request kind and driver
+  @details Samples are sorted into log2 microsecond buckets with one add, so they cost nothing
+  on the netlink thread or the driver worker.  The netlink thread writes the receive to update
+  stage, the worker the other two.  mcast_hist_show() reads them without locking - a count may
+  be one sample ahead of its bucket.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <mcast-hist.h>
+
+static struct mcast_hist_backend_t hist_backends[MCAST_HIST_BACKENDS];
+static const char *stage_names[MH_STAGES] = { "rx-update", "update-dispatch", "driver" };
+static const char *kind_names[MH_KINDS] = { "join", "update", "leave" };
+
+/**
+ * @brief finds or creates the histograms of a driver
+ * @details
+ * @returns pointer to the histograms - the last slot is shared once all are used
+ * @note called before the worker is started
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+struct mcast_hist_backend_t *
+mcast_hist_backend(const char *name)
+{
+	int i;
+
+	for (i = 0; i < MCAST_HIST_BACKENDS; i++) {
+		if (hist_backends[i].name == NULL) {
+			hist_backends[i].name = name;
+			return (&hist_backends[i]);
+		}
+		if (strcmp(hist_backends[i].name, name) == 0)
+			return (&hist_backends[i]);
+	}
+	return (&hist_backends[MCAST_HIST_BACKENDS - 1]);
+}
+
+/**
+ * @brief adds a sample
+ * @details
+ * @note single writer per histogram
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_hist_add(struct mcast_hist_t *h, uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	int b = 0;
+
+	if (us)
+		b = 64 - __builtin_clzll(us);
+	if (b >= MCAST_HIST_BUCKETS)
+		b = MCAST_HIST_BUCKETS - 1;
+	__atomic_store_n(&h->bucket[b], h->bucket[b] + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&h->sum_us, h->sum_us + us, __ATOMIC_RELAXED);
+	if (us > h->max_us)
+		__atomic_store_n(&h->max_us, us, __ATOMIC_RELAXED);
+	__atomic_store_n(&h->count, h->count + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief upper bound of the bucket holding a percentile
+ * @returns us
+ * @author tim.hayes@smartrg.com
+ */
+static uint64_t
+mcast_hist_pct(struct mcast_hist_t *h, uint64_t count, int pct)
+{
+	uint64_t want = (count * pct + 99) / 100;
+	uint64_t seen = 0;
+	int b;
+
+	for (b = 0; b < MCAST_HIST_BUCKETS - 1; b++) {
+		seen += __atomic_load_n(&h->bucket[b], __ATOMIC_RELAXED);
+		if (seen >= want)
+			return (1ULL << b);
+	}
+	return (__atomic_load_n(&h->max_us, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief shows all histograms with samples
+ * @details one summary line per histogram followed by its non empty buckets
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_hist_show(FILE * f)
+{
+	struct mcast_hist_t *h;
+	uint64_t count;
+	uint64_t n;
+	int i;
+	int s;
+	int k;
+	int b;
+
+	if (f == NULL)
+		return;
+	for (i = 0; i < MCAST_HIST_BACKENDS && hist_backends[i].name; i++) {
+		for (s = 0; s < MH_STAGES; s++) {
+			for (k = 0; k < MH_KINDS; k++) {
+				h = &hist_backends[i].h[s][k];
+				count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+				if (count == 0)
+					continue;
+				fprintf(f,
+					"latency %s %s %s: count %llu avg %llu us p50 <%llu us p90 <%llu us p99 <%llu us max %llu us\n",
+					hist_backends[i].name, stage_names[s], kind_names[k], (unsigned long long) count,
+					(unsigned long long) (__atomic_load_n(&h->sum_us, __ATOMIC_RELAXED) / count),
+					(unsigned long long) mcast_hist_pct(h, count, 50),
+					(unsigned long long) mcast_hist_pct(h, count, 90),
+					(unsigned long long) mcast_hist_pct(h, count, 99),
+					(unsigned long long) __atomic_load_n(&h->max_us, __ATOMIC_RELAXED));
+				fprintf(f, "   ");
+				for (b = 0; b < MCAST_HIST_BUCKETS; b++) {
+					n = __atomic_load_n(&h->bucket[b], __ATOMIC_RELAXED);
+					if (n && (b == MCAST_HIST_BUCKETS - 1))
+						fprintf(f, " >=%llu:%llu", 1ULL << (b - 1), (unsigned long long) n);
+					else if (n)
+						fprintf(f, " <%llu:%llu", 1ULL << b, (unsigned long long) n);
+				}
+				fprintf(f, "\n");
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: join and leave latency histograms                                */
+/*                                                                           */
+/*****************************************************************************/
+#ifndef MCAST_HIST_H
+#define MCAST_HIST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define MCAST_HIST_BUCKETS 24			/* log2 us buckets - the last one holds everything from 4 s up */
+#define MCAST_HIST_BACKENDS 4			/* drivers that can have their own histograms */
+
+enum mcast_hist_stage_t {
+	MH_RX_UPDATE,				/**< netlink receive to group table update */
+	MH_UPDATE_DISPATCH,			/**< table update to driver call - queue, rate limit and backoff */
+	MH_DRIVER,				/**< backend join or leave duration */
+	MH_STAGES
+};
+
+enum mcast_hist_kind_t {
+	MH_JOIN,				/**< first member of a group */
+	MH_UPDATE,				/**< member added to a joined group */
+	MH_LEAVE,				/**< member removed */
+	MH_KINDS
+};
+
+/**
+ * one latency histogram - written by one thread only, read at any time
+ */
+struct mcast_hist_t {
+	uint64_t count;				/**< samples */
+	uint64_t sum_us;			/**< total of all samples */
+	uint64_t max_us;			/**< largest sample */
+	uint64_t bucket[MCAST_HIST_BUCKETS];	/**< bucket i holds samples below 2^i us */
+};
+
+/**
+ * all histograms of one driver
+ */
+struct mcast_hist_backend_t {
+	const char *name;			/**< backend name */
+	struct mcast_hist_t h[MH_STAGES][MH_KINDS];
+};
+
+struct mcast_hist_backend_t *mcast_hist_backend(const char *name);
+void mcast_hist_add(struct mcast_hist_t *h, uint64_t ns);
+void mcast_hist_show(FILE * f);
+
+/**
+ * @brief monotonic time in ns for latency stamps
+ * @author tim.hayes@smartrg.com
+ */
+static inline uint64_t
+mcast_hist_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+#endif
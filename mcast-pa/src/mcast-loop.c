@@ -0,0 +1,339 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: epoll event loop                                                 */
+/*                                                                           */
+/*****************************************************************************/
+
+
+/**
+
+  @file mcast-loop.c
+  @author tim.hayes@smartrg.com
+  @brief epoll main loop of the netlink thread
+  @details The netlink sockets, the programming queue results, timers and signals are all
+  fds on one epoll instance.  Timers are timerfds on CLOCK_MONOTONIC and signals arrive on a
+  signalfd, so every handler runs in the loop and not in signal context.  A wakeup costs one
+  epoll_wait, a read of each ready fd and one pass of the service function.
+
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <mcast-loop.h>
+
+/**
+ * @brief creates the epoll instance
+ * @details service may be NULL
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_loop_init(struct mcast_loop_t *loop, void (*service) (void))
+{
+	int i;
+
+	memset(loop, 0, sizeof (struct mcast_loop_t));
+	for (i = 0; i < MCAST_LOOP_SRC_MAX; i++)
+		loop->src[i].fd = -1;
+	loop->service = service;
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0) {
+		syslog(LOG_ERR, "%s:%d epoll_create1 %s\n", __FUNCTION__, __LINE__, strerror(errno));
+		return (-1);
+	}
+	return (0);
+}
+
+/**
+ * @brief watches fd for input
+ * @details fn is called from mcast_loop_run() as long as fd stays readable
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_loop_add(struct mcast_loop_t *loop, int fd, mcast_loop_fn_t fn, void *arg)
+{
+	struct epoll_event ev;
+	int i;
+
+	for (i = 0; i < MCAST_LOOP_SRC_MAX; i++) {
+		if (loop->src[i].fd < 0)
+			break;
+	}
+	if (i == MCAST_LOOP_SRC_MAX) {
+		syslog(LOG_ERR, "%s:%d no room for fd %d\n", __FUNCTION__, __LINE__, fd);
+		return (-1);
+	}
+	memset(&ev, 0, sizeof (ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = &loop->src[i];
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		syslog(LOG_ERR, "%s:%d epoll_ctl add %d %s\n", __FUNCTION__, __LINE__, fd, strerror(errno));
+		return (-1);
+	}
+	loop->src[i].fd = fd;
+	loop->src[i].fn = fn;
+	loop->src[i].arg = arg;
+	return (0);
+}
+
+/**
+ * @brief stops watching fd
+ * @details the caller closes fd - safe from a handler of the same wakeup
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_loop_del(struct mcast_loop_t *loop, int fd)
+{
+	int i;
+
+	for (i = 0; i < MCAST_LOOP_SRC_MAX; i++) {
+		if (loop->src[i].fd == fd) {
+			epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+			loop->src[i].fd = -1;
+			return;
+		}
+	}
+}
+
+/**
+ * @brief changes the epoll events fd is watched for
+ * @details e.g. EPOLLOUT while replies are pending
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_loop_mod(struct mcast_loop_t *loop, int fd, uint32_t events)
+{
+	struct epoll_event ev;
+	int i;
+
+	for (i = 0; i < MCAST_LOOP_SRC_MAX; i++) {
+		if (loop->src[i].fd == fd)
+			break;
+	}
+	if (i == MCAST_LOOP_SRC_MAX)
+		return (-1);
+	memset(&ev, 0, sizeof (ev));
+	ev.events = events;
+	ev.data.ptr = &loop->src[i];
+	return (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev));
+}
+
+/**
+ * @brief creates a disarmed timer
+ * @details fn must call mcast_loop_timer_read()
+ * @returns timerfd or -1
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_loop_timer(struct mcast_loop_t *loop, mcast_loop_fn_t fn, void *arg)
+{
+	int fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		syslog(LOG_ERR, "%s:%d timerfd_create %s\n", __FUNCTION__, __LINE__, strerror(errno));
+		return (-1);
+	}
+	if (mcast_loop_add(loop, fd, fn, arg) < 0) {
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+/**
+ * @brief arms a timer
+ * @details due_ns is CLOCK_MONOTONIC - 0 disarms, interval_ms 0 for a one shot
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_loop_timer_set(struct mcast_loop_t *loop, int fd, uint64_t due_ns, unsigned int interval_ms)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof (its));
+	its.it_value.tv_sec = due_ns / 1000000000ULL;
+	its.it_value.tv_nsec = due_ns % 1000000000ULL;
+	its.it_interval.tv_sec = interval_ms / 1000;
+	its.it_interval.tv_nsec = (interval_ms % 1000) * 1000000;
+	loop->timer_sets++;
+	return (timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL));
+}
+
+/**
+ * @brief consumes the expirations of a timer
+ * @returns expirations since the last read - 0 if none
+ * @author tim.hayes@smartrg.com
+ */
+int
+mcast_loop_timer_read(int fd)
+{
+	uint64_t count;
+
+	if (read(fd, &count, sizeof (count)) != sizeof (count))
+		return (0);
+	return ((int) count);
+}
+
+/**
+ * @brief takes the signals in set through a signalfd
+ * @details blocks them first - call before any thread is started so all threads inherit the mask
+ * @returns signalfd or -1
+ * @note fn reads struct signalfd_siginfo from fd
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_loop_signals(struct mcast_loop_t *loop, const sigset_t * set, mcast_loop_fn_t fn, void *arg)
+{
+	int fd;
+
+	if (sigprocmask(SIG_BLOCK, set, NULL) < 0)
+		return (-1);
+	fd = signalfd(-1, set, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		syslog(LOG_ERR, "%s:%d signalfd %s\n", __FUNCTION__, __LINE__, strerror(errno));
+		return (-1);
+	}
+	if (mcast_loop_add(loop, fd, fn, arg) < 0) {
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+/**
+ * @brief dispatches ready sources until mcast_loop_stop()
+ * @details
+ * @returns the result given to mcast_loop_stop() or -1 if epoll fails
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_loop_run(struct mcast_loop_t *loop)
+{
+	struct epoll_event ev[MCAST_LOOP_EVENTS];
+	struct mcast_loop_src_t *src;
+	int n;
+	int i;
+
+	loop->running = 1;
+	loop->res = 0;
+	if (loop->service)
+		loop->service();
+	while (loop->running) {
+		n = epoll_wait(loop->epfd, ev, MCAST_LOOP_EVENTS, -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			syslog(LOG_ERR, "%s:%d epoll_wait %s\n", __FUNCTION__, __LINE__, strerror(errno));
+			return (-1);
+		}
+		loop->wakeups++;
+		for (i = 0; i < n; i++) {
+			src = (struct mcast_loop_src_t *) ev[i].data.ptr;
+			/* removed by an earlier handler of this wakeup */
+			if (src->fd < 0)
+				continue;
+			loop->events++;
+			src->fn(src->fd, ev[i].events, src->arg);
+		}
+		if (loop->running && loop->service)
+			loop->service();
+	}
+	return (loop->res);
+}
+
+/**
+ * @brief makes mcast_loop_run() return after the current wakeup
+ * @author tim.hayes@smartrg.com
+ */
+void
+mcast_loop_stop(struct mcast_loop_t *loop, int res)
+{
+	loop->running = 0;
+	loop->res = res;
+}
+
+/**
+ * @brief closes the epoll instance
+ * @details the watched fds stay open
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_loop_deinit(struct mcast_loop_t *loop)
+{
+	if (loop->epfd < 0)
+		return;
+	close(loop->epfd);
+	loop->epfd = -1;
+}
+
+/**
+ * @brief shows the loop counters
+ * @author tim.hayes@smartrg.com
+ */
+void
+mcast_loop_show(FILE * f, struct mcast_loop_t *loop)
+{
+	int sources = 0;
+	int i;
+
+	for (i = 0; i < MCAST_LOOP_SRC_MAX; i++) {
+		if (loop->src[i].fd >= 0)
+			sources++;
+	}
+	fprintf(f, "loop: sources %d wakeups %llu events %llu timer sets %llu\n", sources,
+		(unsigned long long) loop->wakeups, (unsigned long long) loop->events,
+		(unsigned long long) loop->timer_sets);
+}
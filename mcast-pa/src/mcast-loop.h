@@ -0,0 +1,71 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: epoll event loop                                                 */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifndef MCAST_LOOP_H
+#define MCAST_LOOP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+
+#define MCAST_LOOP_SRC_MAX 16			/* fds the loop can watch */
+#define MCAST_LOOP_EVENTS 16			/* events taken per epoll_wait */
+
+typedef void (*mcast_loop_fn_t) (int fd, uint32_t events, void *arg);
+
+/**
+ * one watched fd
+ */
+struct mcast_loop_src_t {
+	int fd;					/**< watched fd - -1 if the slot is free */
+	mcast_loop_fn_t fn;			/**< called when fd is ready */
+	void *arg;				/**< passed to fn */
+};
+
+/**
+ * epoll main loop - every source is level triggered, after each wakeup the service
+ * function runs once for the work that is not tied to an fd
+ */
+struct mcast_loop_t {
+	int epfd;				/**< epoll instance - -1 if not initialized */
+	int running;				/**< cleared by mcast_loop_stop() */
+	int res;				/**< mcast_loop_run() result */
+	void (*service) (void);			/**< runs after the ready sources of each wakeup */
+	struct mcast_loop_src_t src[MCAST_LOOP_SRC_MAX];	/**< watched fds */
+	uint64_t wakeups;			/**< epoll_wait returns with events */
+	uint64_t events;			/**< ready sources dispatched */
+	uint64_t timer_sets;			/**< timerfd_settime calls */
+};
+
+int mcast_loop_init(struct mcast_loop_t *loop, void (*service) (void));
+int mcast_loop_add(struct mcast_loop_t *loop, int fd, mcast_loop_fn_t fn, void *arg);
+void mcast_loop_del(struct mcast_loop_t *loop, int fd);
+int mcast_loop_mod(struct mcast_loop_t *loop, int fd, uint32_t events);
+int mcast_loop_timer(struct mcast_loop_t *loop, mcast_loop_fn_t fn, void *arg);
+int mcast_loop_timer_set(struct mcast_loop_t *loop, int fd, uint64_t due_ns, unsigned int interval_ms);
+int mcast_loop_timer_read(int fd);
+int mcast_loop_signals(struct mcast_loop_t *loop, const sigset_t * set, mcast_loop_fn_t fn, void *arg);
+int mcast_loop_run(struct mcast_loop_t *loop);
+void mcast_loop_stop(struct mcast_loop_t *loop, int res);
+void mcast_loop_deinit(struct mcast_loop_t *loop);
+void mcast_loop_show(FILE * f, struct mcast_loop_t *loop);
+
+#endif
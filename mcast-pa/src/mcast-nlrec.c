@@ -0,0 +1,191 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: netlink event record and replay files                            */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-nlrec.c
+  @author tim.hayes@smartrg.com
+  @brief Netlink record files
+  @details With --nl-record every netlink message the daemon receives, dump replies included,
+  is appended raw to a file with its receive time.  --nl-replay feeds such a file back through
+  do_monitor_msg() so a field problem can be reproduced, or a production trace used as a
+  performance regression run, on any box.  The format is a small header and then a
+  struct mcast_nlrec_t plus the message bytes per message, native byte order.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <syslog.h>
+#include <mcast-nlrec.h>
+
+static FILE *nlrec_file;
+static uint64_t nlrec_start;
+
+/**
+ * @brief creates a record file
+ * @details
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_nlrec_open(const char *path)
+{
+	struct mcast_nlrec_file_t hdr;
+	struct timespec ts;
+
+	nlrec_file = fopen(path, "w");
+	if (nlrec_file == NULL) {
+		syslog(LOG_ERR, "%s:%d cannot create %s\n", __FUNCTION__, __LINE__, path);
+		return (-1);
+	}
+	memset(&hdr, 0, sizeof (hdr));
+	hdr.magic = MCAST_NLREC_MAGIC;
+	hdr.version = MCAST_NLREC_VERSION;
+	hdr.rec_size = sizeof (struct mcast_nlrec_t);
+	fwrite(&hdr, sizeof (hdr), 1, nlrec_file);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	nlrec_start = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	syslog(LOG_NOTICE, "%s:%d recording netlink to %s\n", __FUNCTION__, __LINE__, path);
+	return (0);
+}
+
+/**
+ * @brief checks if netlink messages are recorded
+ * @returns 1 if recording 0 otherwise
+ * @author tim.hayes@smartrg.com
+ */
+int
+mcast_nlrec_enabled(void)
+{
+	return (nlrec_file != NULL);
+}
+
+/**
+ * @brief appends a message or a marker
+ * @details n may be NULL for a marker, ns 0 takes the current time
+ * @note netlink thread only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_nlrec_write(struct nlmsghdr *n, int flags, uint64_t ns)
+{
+	struct mcast_nlrec_t rec;
+	struct timespec ts;
+
+	if (nlrec_file == NULL)
+		return;
+	if (ns == 0) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+	memset(&rec, 0, sizeof (rec));
+	rec.ns = ns - nlrec_start;
+	rec.flags = flags;
+	rec.len = n ? n->nlmsg_len : 0;
+	fwrite(&rec, sizeof (rec), 1, nlrec_file);
+	if (rec.len)
+		fwrite(n, rec.len, 1, nlrec_file);
+}
+
+/**
+ * @brief writes out what is buffered
+ * @details called after each netlink read so a crash loses little
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_nlrec_flush(void)
+{
+	if (nlrec_file != NULL)
+		fflush(nlrec_file);
+}
+
+/**
+ * @brief closes the record file
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_nlrec_close(void)
+{
+	if (nlrec_file != NULL)
+		fclose(nlrec_file);
+	nlrec_file = NULL;
+}
+
+/**
+ * @brief opens a record file for replay
+ * @details checks the header
+ * @returns file positioned at the first record or null
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+FILE *
+mcast_nlrec_open_read(const char *path)
+{
+	struct mcast_nlrec_file_t hdr;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+		return (NULL);
+	if ((fread(&hdr, sizeof (hdr), 1, f) != 1) || (hdr.magic != MCAST_NLREC_MAGIC) ||
+	    (hdr.version != MCAST_NLREC_VERSION) || (hdr.rec_size != sizeof (struct mcast_nlrec_t))) {
+		fclose(f);
+		return (NULL);
+	}
+	return (f);
+}
+
+/**
+ * @brief reads the next record
+ * @details the message is copied to buf
+ * @returns 1 if a record was read 0 at the end or on a damaged record
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_nlrec_read(FILE * f, struct mcast_nlrec_t *rec, char *buf, size_t size)
+{
+	if (fread(rec, sizeof (struct mcast_nlrec_t), 1, f) != 1)
+		return (0);
+	if (rec->len == 0)
+		return (1);
+	if ((rec->len > size) || (rec->len < sizeof (struct nlmsghdr)))
+		return (0);
+	if (fread(buf, rec->len, 1, f) != 1)
+		return (0);
+	return (1);
+}
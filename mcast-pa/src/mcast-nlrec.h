@@ -0,0 +1,64 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: netlink event record and replay files                            */
+/*                                                                           */
+/*****************************************************************************/
+#ifndef MCAST_NLREC_H
+#define MCAST_NLREC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <linux/netlink.h>
+
+#define MCAST_NLREC_MAGIC 0x4d434e4c		/* "MCNL" */
+#define MCAST_NLREC_VERSION 1
+#define MCAST_NLREC_MSG_MAX 16384		/* largest message kept - one netlink read */
+
+/**
+ * file header
+ */
+struct mcast_nlrec_file_t {
+	uint32_t magic;				/**< MCAST_NLREC_MAGIC */
+	uint16_t version;			/**< MCAST_NLREC_VERSION */
+	uint16_t rec_size;			/**< sizeof (struct mcast_nlrec_t) */
+};
+
+/**
+ * record header - followed by len bytes of netlink message
+ * messages of one netlink read share the same ns
+ */
+struct mcast_nlrec_t {
+	uint64_t ns;				/**< CLOCK_MONOTONIC ns since recording started */
+	uint32_t len;				/**< message bytes that follow - 0 for markers */
+#define MCAST_NLREC_DUMP	1<<0		/**<  reply to a dump request, not an event */
+#define MCAST_NLREC_OVERFLOW	1<<1		/**<  marker - the socket lost messages here */
+#define MCAST_NLREC_RESYNC	1<<2		/**<  marker - an mdb resync dump follows */
+#define MCAST_NLREC_REDUMP	1<<3		/**<  marker - a periodic mdb redump follows */
+	uint16_t flags;
+	uint16_t pad;
+};
+
+int mcast_nlrec_open(const char *path);
+int mcast_nlrec_enabled(void);
+void mcast_nlrec_write(struct nlmsghdr *n, int flags, uint64_t ns);
+void mcast_nlrec_flush(void);
+void mcast_nlrec_close(void);
+FILE *mcast_nlrec_open_read(const char *path);
+int mcast_nlrec_read(FILE * f, struct mcast_nlrec_t *rec, char *buf, size_t size);
+
+#endif
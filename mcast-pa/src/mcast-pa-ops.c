@@ -0,0 +1,224 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: accelerator backend table, null and record backends              */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-pa-ops.c
+  @author tim.hayes@smartrg.com
+  @brief Accelerator backends
+  @details The daemon talks to the accelerator through a struct mcast_pa_ops_t chosen at startup.
+  Besides the intel driver (when built with MCAST_PA_INTEL) there are two backends that need no
+  hardware - null accepts every request and does nothing, record accepts every request and
+  writes it to a file.  With either the daemon's own cost can be measured and it can be built
+  and run off target.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <syslog.h>
+#include <arpa/inet.h>
+#include <mcast-pa.h>
+
+#define MCAST_PA_RECORD_PATH "/tmp/mcastpa-record"
+
+static const char *record_path = MCAST_PA_RECORD_PATH;
+static FILE *record_file;
+
+static int
+null_init(struct mcastpa_system_init_t *msi)
+{
+	return (0);
+}
+
+static int
+null_request(struct mcastpa_join_leave_t *mjl)
+{
+	return (0);
+}
+
+static int
+null_deinit(struct mcastpa_system_init_t *msi)
+{
+	return (0);
+}
+
+static struct mcast_pa_ops_t mcast_pa_null_ops = {
+	.name = "null",
+	.caps = MCAST_PA_CAP_UPDATE | MCAST_PA_CAP_BATCH,
+	.capacity = 0,
+	.init = null_init,
+	.join = null_request,
+	.leave = null_request,
+	.deinit = null_deinit,
+};
+
+/**
+ * @brief sets the file of the record backend
+ * @details must be called before the backend is initialized
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_pa_record_path(const char *path)
+{
+	record_path = path;
+}
+
+/**
+ * @brief opens the record file
+ * @details
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+record_init(struct mcastpa_system_init_t *msi)
+{
+	record_file = fopen(record_path, "w");
+	if (record_file == NULL) {
+		syslog(LOG_ERR, "%s:%d cannot open %s\n", __FUNCTION__, __LINE__, record_path);
+		return (-1);
+	}
+	syslog(LOG_NOTICE, "%s:%d recording driver requests to %s\n", __FUNCTION__, __LINE__, record_path);
+	return (0);
+}
+
+/**
+ * @brief writes one request
+ * @details monotonic time, op, group, source, port, member ports, flags and subscriber
+ * @returns 0
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+record_request(const char *op, struct mcastpa_join_leave_t *mjl)
+{
+	char gbuf[INET6_ADDRSTRLEN];
+	char sbuf[INET6_ADDRSTRLEN] = "-";
+	const unsigned char *m = mjl->srcmac;
+	struct timespec ts;
+	int port;
+
+	if (record_file == NULL)
+		return (0);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	inet_ntop(mjl->group.family, &mjl->group.u, gbuf, sizeof (gbuf));
+	if (mjl->flags & MJL_FLAG_SRCIP)
+		inet_ntop(mjl->srcip.family, &mjl->srcip.u, sbuf, sizeof (sbuf));
+	fprintf(record_file, "%ld.%06ld %s %s src %s wan %s port %s flags 0x%x srcmac %02x:%02x:%02x:%02x:%02x:%02x ports",
+		(long) ts.tv_sec, ts.tv_nsec / 1000, op, gbuf, sbuf, mcast_if_name(mjl->wan_ifindex),
+		mcast_if_name(mjl->lan_ifindex), mjl->flags, m[0], m[1], m[2], m[3], m[4], m[5]);
+	mcastpa_portmap_for_each(port, &mjl->lan)
+		fprintf(record_file, " %s", mcast_if_name(mcast_port_ifindex(mjl->br_ifindex, port)));
+	fprintf(record_file, "\n");
+	return (0);
+}
+
+static int
+record_join(struct mcastpa_join_leave_t *mjl)
+{
+	return (record_request("join", mjl));
+}
+
+static int
+record_leave(struct mcastpa_join_leave_t *mjl)
+{
+	return (record_request("leave", mjl));
+}
+
+static int
+record_deinit(struct mcastpa_system_init_t *msi)
+{
+	if (record_file != NULL)
+		fclose(record_file);
+	record_file = NULL;
+	return (0);
+}
+
+static struct mcast_pa_ops_t mcast_pa_record_ops = {
+	.name = "record",
+	.caps = MCAST_PA_CAP_UPDATE | MCAST_PA_CAP_BATCH,
+	.capacity = 0,
+	.init = record_init,
+	.join = record_join,
+	.leave = record_leave,
+	.deinit = record_deinit,
+};
+
+/* the first one is the default */
+static struct mcast_pa_ops_t *mcast_pa_backends[] = {
+#ifdef MCAST_PA_INTEL
+	&mcast_pa_intel_ops,
+#endif
+	&mcast_pa_null_ops,
+	&mcast_pa_record_ops,
+	NULL
+};
+
+/**
+ * @brief finds a backend
+ * @details NULL selects the default
+ * @returns pointer to the backend or null if unknown
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+struct mcast_pa_ops_t *
+mcast_pa_ops_get(const char *name)
+{
+	int i;
+
+	if ((name == NULL) || (name[0] == 0))
+		return (mcast_pa_backends[0]);
+	for (i = 0; mcast_pa_backends[i] != NULL; i++) {
+		if (strcmp(mcast_pa_backends[i]->name, name) == 0)
+			return (mcast_pa_backends[i]);
+	}
+	return (NULL);
+}
+
+/**
+ * @brief lists the backends built in
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_pa_ops_list(FILE * f)
+{
+	int i;
+
+	for (i = 0; mcast_pa_backends[i] != NULL; i++)
+		fprintf(f, "%s%s", i ? " " : "", mcast_pa_backends[i]->name);
+	fprintf(f, "\n");
+}
@@ -48,7 +48,8 @@
   The RTNETLINK callbacks consist of two components - bridge MDB callbacks and router ROUTE callbacks.
   The bridge MDB callbacks consist of NEWMDB and DELMDB messages that result in join and leave 
   operations respectively.   The ROUTE callbacks consist of NEWROUTE and DELROUTE messages of type
-  RTN_MULTICAST. 
+  RTN_MULTICAST.  Our own addresses are tracked from NEWADDR and DELADDR so multicast routes
+  sourced locally can be ignored - unicast routes are not monitored.
 
   The following diagram illustrates the basic operation of the model.
 
@@ -60,7 +61,9 @@
   multicast group there is a list of group members.  When a NEWMDB message is received for a 
   new group, a group head and group member are created.  When a multicast route is received 
   for that group, the group member(s) are pushed to the accelerator via pa_join(). When a NEWMDB
-  message is received for an existing route the pa_join() is executed immediately.
+  message is received for an existing route the pa_join() is queued immediately.  Driver calls
+  run on a programming worker thread (mcast-pq.c) in the order they were queued so a slow driver
+  never holds up the netlink socket.
 
   The following diagram illustrates the list management component.
 
@@ -212,6 +215,8 @@
 #include <sys/time.h>
 #include <time.h>
 #include <signal.h>
+#include <poll.h>
+#include <sys/signalfd.h>
 #include <asm/types.h>
 // we must local src this because it is patched (struct mdb_entry) and STAGING_DIR does not have the patch result
 #include "if_bridge.h"
@@ -219,36 +224,52 @@
 #include <libnetlink.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
-#include <linux/in_route.h>
 #include <linux/mroute.h>
+#include <linux/neighbour.h>
 #include <kernel-list.h>
 #include <mcast-pa.h>
-
-char *_SL_ = "\n";
+#include <mcast-pool.h>
+#include <mcast-pq.h>
+#include <mcast-trace.h>
+#include <mcast-nlrec.h>
+#include <mcast-loop.h>
+#include <mcast-ctl.h>
+#include <mcast-snap.h>
+#ifdef MCAST_PA_BENCH
+#include <mcast-bench.h>
+#endif
 
 #define INET_ADDR_SIZE 128
 #define CMD_BUF_SIZE 256
+#define MCG_HASH_BITS 8
+#define MCG_HASH_SIZE (1 << MCG_HASH_BITS)	/* group hash buckets - must be a power of 2 */
+#define MBR_HASH_BITS 10
+#define MBR_HASH_SIZE (1 << MBR_HASH_BITS)	/* group member hash buckets - must be a power of 2 */
+#define PORT_HASH_SIZE 64			/* members by bridge port ifindex buckets - must be a power of 2 */
+#define MCAST_BR_PORTS_MIN 64			/* port numbers of a bridge - doubled on demand up to MCASTPA_PORTMAP_BITS */
+#define MCAST_PORT_NONE 0xffff			/* member port without a port number */
+#define MAC_HASH_SIZE 256			/* members by subscriber srcmac buckets - must be a power of 2 */
+#define MCG_MAX_GROUPS_DEFAULT 1024
+#define MCAST_IF_TABLE_MIN 64			/* initial size of the ifindex table - grows on demand */
+#define ZAP_HASH_SIZE 64			/* pending mdb event buckets - must be a power of 2 */
+#define ZAP_MAX_PENDING 256			/* pending mdb events before a forced flush */
+#define ZAP_WINDOW_DEFAULT 10			/* ms an mdb event may wait to be coalesced */
+#define NL_RCVBUF_DEFAULT (1024 * 1024)	/* netlink receive buffer - bursts overflow the libnetlink default */
+#define SHADOW_HASH_SIZE 1024			/* programmed flow buckets - must be a power of 2 */
+#define RECONCILE_DEFAULT 60			/* seconds between reconciliation passes */
+#define REDUMP_DEFAULT 900			/* seconds between periodic kernel mdb redumps */
+#define RETRY_MAX_PENDING 256			/* failed driver requests waiting for a retry */
+#define RETRY_ATTEMPTS 8			/* failed driver requests before a member is left in software */
+#define RETRY_BASE_MS 50			/* first retry delay - doubles on each failure */
+#define RETRY_MAX_MS 30000			/* cap on the retry delay */
+#define MCG_MAX_MEMBERS_DEFAULT 4096
+#define IP_HASH_SIZE 32				/* local address buckets - must be a power of 2 */
+#define SNAP_INTERVAL_DEFAULT 200		/* ms between snapshot publishes while the tables change */
 
 extern const char *ll_index_to_name(unsigned idx);
 extern unsigned ll_name_to_index(const char *name);
 extern void ll_init_map(struct rtnl_handle *rth);
 
-static const char *mx_names[RTAX_MAX + 1] = {
-	[RTAX_MTU] = "mtu",
-	[RTAX_WINDOW] = "window",
-	[RTAX_RTT] = "rtt",
-	[RTAX_RTTVAR] = "rttvar",
-	[RTAX_SSTHRESH] = "ssthresh",
-	[RTAX_CWND] = "cwnd",
-	[RTAX_ADVMSS] = "advmss",
-	[RTAX_REORDERING] = "reordering",
-	[RTAX_HOPLIMIT] = "hoplimit",
-	[RTAX_INITCWND] = "initcwnd",
-	[RTAX_FEATURES] = "features",
-	[RTAX_RTO_MIN] = "rto_min",
-	[RTAX_INITRWND] = "initrwnd",
-};
-
 #define SPRINT_BSIZE 64
 #define SPRINT_BUF(x)   static char x[SPRINT_BSIZE]
 
@@ -260,12 +281,12 @@ static const char *mx_names[RTAX_MAX + 1] = {
 static struct mcastpa_t mcastpa;
 
 struct rtnl_handle rth = {.fd = -1 };
+struct rtnl_handle rth_dump = {.fd = -1 };	/* unsubscribed - resync dumps must not swallow events */
 
 struct mcast_ip_entry_t {
-	struct list_head head;		/**< prev next pointers for ip address list */
+	struct list_head head;		/**< prev next pointers for local address hash bucket */
 	int ifindex;				/**< ifindex of device which has address */
-	char address[INET_ADDR_SIZE];	/**< ip address of device */
-	char name[IFNAMSIZ];			/**< name of device */
+	struct mcastpa_addr_t addr;		/**< local address from RTM_NEWADDR */
 };
 
 struct mcast_wan_entry_t {
@@ -275,21 +296,98 @@ struct mcast_wan_entry_t {
 	char name[IFNAMSIZ];			/**< name of device */
 };
 
-struct mcg_br_mdb_entry_t {
+struct mcg_br_addr_t {
+	union {
+		__be32 ip4;
+		struct in6_addr ip6;
+	} u;					/**< mc group address as in struct br_mdb_entry */
+	__be16 proto;				/**< ETH_P_IP or ETH_P_IPV6 in network order */
+};
+
+struct mcg_br_head_t {
 	struct list_head mcg_head;		/**< prev next pointers for mc group header list mgmt (list of groups) */
-	struct list_head mcg_entry;		/**< prev next pointers for mc group interface members (list of ifindexes via br_mdb_entry struct - head use only */
-	struct br_mdb_entry e;		/**< copy of mdb entry from bridge table with mc group and ifindex of joined interfaces */
-	int joined;				/**< set to 1 if pa_join() called */
-	int wan_ifindex;			/**< ifindex of wan interface - head use only */
-	int br_ifindex;			/**< ifindex of bridge interface - head use only */
-	char src[INET_ADDR_SIZE];		/**< ip address of video source - head use only */
+	struct list_head mcg_entry;		/**< list header for mc group interface members (struct mcg_br_mdb_entry_t) */
+	struct list_head mcg_hash;		/**< prev next pointers for mc group hash bucket */
+	struct mcg_br_addr_t addr;		/**< mc group */
+	int ifindex;				/**< ifindex of the bridge port that first joined */
+	int wan_ifindex;			/**< ifindex of wan interface */
+	int br_ifindex;			/**< ifindex of bridge interface */
+	struct mcastpa_addr_t src;		/**< ip address of video source - AF_UNSPEC until a route is seen */
+	int sw_members;			/**< members the accelerator refused - group is software bridged while nonzero */
+	struct timespec sw_since;		/**< when sw_members went nonzero */
+	uint64_t sw_ms;			/**< total ms this group ran in software */
+	int joined_members;			/**< members with joined set - an update and not a new group if nonzero */
+	struct mcast_br_ports_t *brp;		/**< numbering of the lan set - of the bridge of the first member */
+	uint64_t ports;				/**< port numbers 0 to 63 with at least one member - the lan set of every request */
+	uint64_t *ports_ext;			/**< port numbers from 64 up - NULL until a member has one */
+	unsigned int ports_ext_words;		/**< words allocated in ports_ext */
+};
+
+struct mcg_br_mdb_entry_t {
+	struct list_head mcg_entry;		/**< prev next pointers for mc group interface members */
+	struct list_head mbr_hash;		/**< prev next pointers for (group, ifindex) hash bucket */
+	struct list_head port_hash;		/**< prev next pointers for members by ifindex bucket */
+	struct list_head mac_hash;		/**< prev next pointers for members by srcmac bucket */
+	struct list_head cap_wait;		/**< prev next pointers for members waiting for backend capacity */
+	struct mcg_br_head_t *head;		/**< group head this member belongs to */
+	int ifindex;				/**< ifindex of the joined bridge port */
+	unsigned char srcmac[ETH_ALEN];	/**< source mac address of group subscriber */
+	unsigned char joined;			/**< set to 1 if pa_join() called */
+	unsigned char retries;			/**< consecutive failed joins - nonzero while in software */
+	unsigned char local;			/**< added by a vsa request - never in the kernel mdb */
+	unsigned char parked;			/**< station left the fdb - out of the accelerator until seen again */
+	unsigned short port;			/**< port number of ifindex in its bridge - MCAST_PORT_NONE if none */
+	unsigned int gen;			/**< mdb generation the member was last reported in */
+	unsigned int seq;			/**< sequence number of the last request queued for the member */
+};
+
+struct mcast_if_t {
+#define MCAST_IF_WAN		1<<0		/**<  one of the --wan interfaces */
+#define MCAST_IF_VIDEO2LAN	1<<1		/**<  the --video2lan interface */
+#define MCAST_IF_LANPORT	1<<2		/**<  enslaved to a bridge */
+#define MCAST_IF_WIFI		1<<3		/**<  wireless device */
+#define MCAST_IF_BRIDGE	1<<4		/**<  bridge master */
+#define MCAST_IF_VIDEO_BRIDGE	1<<5		/**<  the --bridge video bridge */
+	int valid;				/**< set while the kernel has this ifindex */
+	int role;				/**< MCAST_IF_ role and capability flags */
+	int master;				/**< ifindex of the bridge if a lan port */
+	unsigned int flags;			/**< IFF_ link flags */
+	unsigned short port;			/**< port number + 1 last given to the port - 0 if none */
+	char name[IFNAMSIZ];			/**< current name of device */
+};
+
+/**
+ * port numbering of one bridge - numbers index the bits of a struct mcastpa_portmap_t
+ * the arrays only grow and are reallocated under iftab_lock, the worker reads them under it
+ */
+struct mcast_br_ports_t {
+	struct list_head list;		/**< prev next pointers for the bridge list */
+	int br_ifindex;			/**< ifindex of the bridge */
+	unsigned int size;			/**< port numbers allocated */
+	int *ifindex;				/**< ifindex of each port number - 0 if never given out */
+	unsigned int *members;		/**< members of all groups per port number */
+};
+
+struct mcg_zap_t {
+	struct list_head list;		/**< prev next pointers for pending events in arrival order */
+	struct list_head hash;		/**< prev next pointers for pending events by (group, port, srcmac) */
+	int type;				/**< RTM_NEWMDB or RTM_DELMDB - last event for the key wins */
+	int br_ifindex;			/**< ifindex of bridge that sent the event */
+	struct br_mdb_entry e;		/**< copy of the mdb entry */
+	uint64_t rx_ns;				/**< netlink receive time of the last event for the key */
+};
+
+struct mcg_shadow_t {
+	struct list_head hash;		/**< prev next pointers for the shadow hash bucket */
+	struct mcastpa_join_leave_t mjl;	/**< last request the driver accepted for (group, port, srcmac) */
 };
 
-struct vsa_t {
-	char op[128];				/**< vsa join or leave */
-	char group[128];			/**< vsa mc group */
-	char device[128];			/**< vsa device - like a lan bridge port */
-	int valid;				/**< valid data in this struct */
+struct mcg_retry_t {
+	struct list_head list;		/**< prev next pointers for the retry list */
+	int op;				/**< MCAST_PQ_JOIN or MCAST_PQ_LEAVE */
+	unsigned int attempt;			/**< failed tries so far */
+	struct timespec due;			/**< when to send again */
+	struct mcastpa_join_leave_t mjl;	/**< failed request */
 };
 
 struct params_t {
@@ -305,9 +403,23 @@ struct params_t {
 	char video2lan_name[IFNAMSIZ];	/**< name of video ip interface */
 	int use_src;				/**< use ip address of video source from command line */
 	int nowifi;				/**< don't push wifi ifaces to packet accelerator */
+	unsigned int max_groups;		/**< capacity of the group head pool */
+	unsigned int max_members;		/**< capacity of the group member pool */
+	int zap_window;			/**< ms to coalesce mdb events - 0 applies every event at once */
+	unsigned int pa_rate;			/**< cap on driver requests per second - 0 is none */
+	unsigned int pa_burst;			/**< driver requests sent back to back once paced */
+	int rcvbuf;				/**< netlink socket receive buffer in bytes */
+	int reconcile;				/**< seconds between reconciliation passes - 0 disables them */
+	int redump;				/**< seconds between periodic mdb redumps - 0 redumps only after overflow */
+	const char *backend;			/**< --backend name - NULL for the default */
+	const char *nl_record;			/**< --nl-record file - NULL when not recording */
+	const char *nl_replay;			/**< --nl-replay file - NULL when running live */
+	double replay_speed;			/**< replay time scale - 1 is real time, 0 as fast as possible */
+	const char *ctl_path;			/**< control socket path */
+	int snap_interval;			/**< ms between snapshot publishes - 0 disables the snapshot */
 	char src[INET_ADDR_SIZE];		/**< ip address of video source from command line */
+	struct mcastpa_addr_t src_addr;	/**< binary ip address of video source from command line */
 	int exp;				/**< experimental code segment testing */
-	struct vsa_t vsa;			/**< for vsa join and leave operations */
 };
 
 struct mcastpa_t {
@@ -322,11 +434,67 @@ struct mcastpa_t {
 	time_t start_ctime;			/**< start time in local time format when we started */
 	time_t error_ctime;			/**< error detected time in local time format when we started */
 	struct list_head mcg_head;		/**< global list header for mc groups */
-	struct list_head ip_head;		/**< global list header for our host ip addresses */
+	struct list_head mcg_hash[MCG_HASH_SIZE];	/**< mc group heads hashed by binary group address */
+	struct list_head mbr_hash[MBR_HASH_SIZE];	/**< mc group members hashed by group, ifindex and srcmac */
+	struct list_head port_hash[PORT_HASH_SIZE];	/**< reverse index - mc group members hashed by bridge port ifindex */
+	struct list_head mac_hash[MAC_HASH_SIZE];	/**< reverse index - mc group members hashed by subscriber srcmac */
+	struct mcast_pool_t head_pool;	/**< preallocated group heads */
+	struct mcast_pool_t mbr_pool;		/**< preallocated group members */
+	struct mcast_if_t *iftab;		/**< interface table indexed by ifindex - maintained from RTM_NEWLINK/RTM_DELLINK */
+	int iftab_size;			/**< number of entries in iftab */
+	pthread_rwlock_t iftab_lock;		/**< held by the netlink thread to change iftab and by the worker to read it */
+	struct mcast_pa_ops_t *pa;		/**< accelerator backend */
+	uint64_t capacity_full;			/**< joins kept in software because the backend was full */
+	struct list_head capacity_wait;		/**< members refused for backend capacity in refusal order */
+	unsigned int capacity_waiting;		/**< members on capacity_wait */
+	struct mcast_pq_t pq;			/**< driver requests for the programming worker */
+	int zap_enabled;			/**< set once the initial dumps are done and coalescing may start */
+	struct list_head zap_list;		/**< pending mdb events in arrival order */
+	struct list_head zap_hash[ZAP_HASH_SIZE];	/**< pending mdb events by (group, port, srcmac) */
+	struct mcast_pool_t zap_pool;		/**< preallocated pending mdb events */
+	struct timespec zap_start;		/**< arrival time of the oldest pending event */
+	uint64_t zap_events;			/**< mdb events queued for coalescing */
+	uint64_t zap_merged;			/**< mdb events merged with or cancelling a pending event */
+	uint64_t zap_flushes;			/**< coalescing windows flushed */
+	struct list_head retry_list;		/**< failed driver requests waiting for a retry */
+	struct mcast_pool_t retry_pool;	/**< preallocated retry entries */
+	uint64_t retry_joins;			/**< joins sent again */
+	uint64_t retry_leaves;			/**< leaves sent again */
+	uint64_t retry_given_up;		/**< requests given up after RETRY_ATTEMPTS */
+	unsigned int req_seq;			/**< last sequence number given to a member request */
+	uint64_t stale_results;			/**< results overtaken by a newer request for the member */
+	uint64_t sw_ms_total;			/**< ms summed over all groups that ran in software */
+	unsigned int mdb_gen;			/**< bumped by each resync or redump - members not restamped are stale */
+	int resync;				/**< set when netlink messages were lost and state must be redumped */
+	uint64_t nl_overflows;			/**< ENOBUFS seen on the netlink socket */
+	uint64_t resyncs;			/**< resyncs done after netlink overflows */
+	uint64_t redumps;			/**< periodic redumps done */
+	struct timespec redump_due;		/**< next periodic redump */
+	uint64_t resync_added;			/**< members found by a resync or redump that events had missed */
+	uint64_t resync_removed;		/**< stale members removed by a resync or redump */
+	struct list_head shadow_hash[SHADOW_HASH_SIZE];	/**< flows the driver accepted - what the accelerator holds */
+	struct mcast_pool_t shadow_pool;	/**< preallocated shadow entries */
+	struct timespec reconcile_due;		/**< next reconciliation pass */
+	uint64_t reconciles;			/**< reconciliation passes done */
+	uint64_t reconcile_deferred;		/**< shadow checks skipped because requests were in flight */
+	uint64_t reconcile_joins;		/**< members joined again because the shadow lacked them */
+	uint64_t reconcile_leaves;		/**< stale flows left because no member wanted them */
+	struct list_head ip_hash[IP_HASH_SIZE];	/**< our host ip addresses from RTM_NEWADDR and RTM_DELADDR */
 	struct list_head wan_head;		/**< global list header for our host interfaces */
+	struct mcast_loop_t loop;		/**< epoll main loop of the netlink thread */
+	int timer_fd;				/**< timerfd for the earliest zap, retry, reconcile or snapshot deadline */
+	uint64_t timer_due;			/**< ns timer_fd is armed for - 0 if not armed */
+	int tick_fd;				/**< 1 s timerfd driving timer_tick */
+	struct mcast_ctl_t ctl;			/**< local control socket */
+	struct list_head br_ports;		/**< port numbering of each bridge - struct mcast_br_ports_t */
+	uint64_t port_full;			/**< members added with all port numbers of their bridge taken */
+	int snap;				/**< set while the shared memory snapshot is mapped */
+	int snap_dirty;				/**< set when the tables changed since the last publish */
+	struct timespec snap_due;		/**< earliest time of the next publish */
 };
 
-int mcg_br_entry_leave(struct mcg_br_mdb_entry_t *head, struct br_mdb_entry *e);
+int mcg_br_entry_leave(struct mcg_br_head_t *head, struct br_mdb_entry *e);
+void mcast_sig_handler(int signo);
 
 static inline __u32
 nl_mgrp(__u32 group)
@@ -338,31 +506,6 @@ nl_mgrp(__u32 group)
 	return group ? (1 << (group - 1)) : 0;
 }
 
-/**
- * @brief read a file and look for a vsa operation
- * @details join or leave channel device
- * @returns 0 if OK
- * @note
- * @author tim.hayes@smartrg.com
- * @callgraph
- * @callergraph
- */
-int
-mcast_vsa_get(void)
-{
-	FILE *fp;
-	if ((fp = fopen("/tmp/vsapa.cfg", "r")) == NULL) {
-		mcastpa.params.vsa.valid = 0;
-		return (0);
-	}
-	fscanf(fp, "%s %s %s", mcastpa.params.vsa.op, mcastpa.params.vsa.group, mcastpa.params.vsa.device);
-	fclose(fp);
-	syslog(LOG_INFO, "%s:%d op: %s group: %s device: %s\n", __FUNCTION__, __LINE__,
-	       mcastpa.params.vsa.op, mcastpa.params.vsa.group, mcastpa.params.vsa.device);
-	mcastpa.params.vsa.valid = 1;
-	return (0);
-}
-
 /**
  * @brief add a wan iface to our host list
  * @details 
@@ -423,7 +566,7 @@ mcast_wan_entry_del(char *name)
  * @callergraph
  */
 struct mcast_wan_entry_t *
-mcast_wan_entry_get(char *name)
+mcast_wan_entry_get(const char *name)
 {
 	struct list_head *pos;
 	struct list_head *q;
@@ -494,7 +637,7 @@ mcast_wan_entry_list(void)
  * @callergraph
  */
 int
-iswan(char *name)
+iswan(const char *name)
 {
 	struct mcast_wan_entry_t *p_mcast_wan_entry;
 
@@ -520,7 +663,7 @@ iswan(char *name)
  * @callergraph
  */
 int
-iswifi(char *name)
+iswifi(const char *name)
 {
 	if (strncmp(name, "wifi", strlen("wifi")) == 0)
 		return (1);
@@ -528,575 +671,497 @@ iswifi(char *name)
 }
 
 /**
- * @brief add a ip address to our host list
- * @details 
- * @returns pointer to entry or null
+ * @brief checks for a sysfs attribute of a network device
+ * @details e.g. wireless, phy80211 or bridge
+ * @returns 1 if present 0 otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-struct mcast_ip_entry_t *
-mcast_ip_entry_add(char *address)
+static int
+mcast_if_sysfs_has(const char *name, const char *attr)
 {
-	struct mcast_ip_entry_t *p_mcast_ip_entry;
-	p_mcast_ip_entry = (struct mcast_ip_entry_t *) malloc(sizeof (struct mcast_ip_entry_t));
-	if (p_mcast_ip_entry == NULL) {
-		return (NULL);
-	}
-	memset(p_mcast_ip_entry, 0, sizeof (struct mcast_ip_entry_t));
-	INIT_LIST_HEAD(&p_mcast_ip_entry->head);
-	list_add(&p_mcast_ip_entry->head, &mcastpa.ip_head);
-	sprintf(p_mcast_ip_entry->address, "%s", address);
-	return (p_mcast_ip_entry);
+	char path[CMD_BUF_SIZE];
+	struct stat st;
+
+	snprintf(path, sizeof (path), "/sys/class/net/%s/%s", name, attr);
+	return (stat(path, &st) == 0);
 }
 
 /**
- * @brief delete a ip address if found on list
- * @details 
+ * @brief returns the interface table entry of an ifindex
+ * @details
+ * @returns entry or NULL if unknown
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-int
-mcast_ip_entry_del(char *address)
+static inline struct mcast_if_t *
+mcast_if_get(int ifindex)
 {
-	struct list_head *pos;
-	struct list_head *q;
-	struct mcast_ip_entry_t *p_mcast_ip_entry;
-
-	list_for_each_safe(pos, q, &mcastpa.ip_head) {
-		p_mcast_ip_entry = (struct mcast_ip_entry_t *) list_entry(pos, struct mcast_ip_entry_t, head);
-		if (strcmp(p_mcast_ip_entry->address, address) == 0) {
-			list_del(pos);
-			free(p_mcast_ip_entry);
-			return (0);
-		}
-	}
-	return (-ENOENT);
+	if ((ifindex <= 0) || (ifindex >= mcastpa.iftab_size))
+		return (NULL);
+	if (!mcastpa.iftab[ifindex].valid)
+		return (NULL);
+	return (&mcastpa.iftab[ifindex]);
 }
 
 /**
- * @brief returns a list entry of the ip address
- * @details removes instance of a group as a sub of the group head
+ * @brief returns the role and capability flags of an ifindex
+ * @details
+ * @returns MCAST_IF_ flags - 0 if unknown
  * @note
- * @returns entry if address found null otherwise
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-struct mcast_ip_entry_t *
-mcast_ip_entry_get(char *address)
+int
+mcast_if_role(int ifindex)
 {
-	struct list_head *pos;
-	struct list_head *q;
-	struct mcast_ip_entry_t *p_mcast_ip_entry;
-
-	list_for_each_safe(pos, q, &mcastpa.ip_head) {
-		p_mcast_ip_entry = (struct mcast_ip_entry_t *) list_entry(pos, struct mcast_ip_entry_t, head);
-		if (strcmp(p_mcast_ip_entry->address, address) == 0) {
-			return (p_mcast_ip_entry);
-		}
-	}
-	return (NULL);
+	struct mcast_if_t *ift = mcast_if_get(ifindex);
+	if (ift == NULL)
+		return (0);
+	return (ift->role);
 }
 
 /**
- * @brief determines if an address is one of our own local
- * @details this is a temp hack need a list of adresses
- * @returns 1 if ours 0 otherwise
- * @note
+ * @brief returns the port numbering of a bridge
+ * @details
+ * @returns numbering or NULL if the bridge has none yet
+ * @note the caller holds iftab_lock or is the netlink thread
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-int
-islocaladdr(char *address)
+static struct mcast_br_ports_t *
+mcast_br_ports_lookup(int br_ifindex)
 {
-	struct mcast_ip_entry_t *p_mcast_ip_entry = mcast_ip_entry_get(address);
-	if (p_mcast_ip_entry != NULL)
-		return (1);
-	return (0);
+	struct list_head *pos;
+	struct mcast_br_ports_t *brp;
+
+	list_for_each(pos, &mcastpa.br_ports) {
+		brp = (struct mcast_br_ports_t *) list_entry(pos, struct mcast_br_ports_t, list);
+		if (brp->br_ifindex == br_ifindex)
+			return (brp);
+	}
+	return (NULL);
 }
 
 /**
- * @brief list all host ip addresses
- * @details 
- * @note
+ * @brief returns the ifindex of a port number of a bridge
+ * @details for backends turning the lan port set of a request into devices
+ * @returns ifindex or 0 if the number was never given out
+ * @note safe from the programming worker - a number is only given to another port once its
+ * @note interface is gone and no request is in flight
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
 int
-mcast_ip_entry_list(void)
+mcast_port_ifindex(int br_ifindex, int port)
 {
-	struct list_head *pos;
-	struct list_head *q;
-	struct mcast_ip_entry_t *p_mcast_ip_entry;
+	struct mcast_br_ports_t *brp;
+	int ifindex = 0;
 
-	list_for_each_safe(pos, q, &mcastpa.ip_head) {
-		p_mcast_ip_entry = (struct mcast_ip_entry_t *) list_entry(pos, struct mcast_ip_entry_t, head);
-		syslog(LOG_NOTICE, "ip address %s\n", p_mcast_ip_entry->address);
-	}
-	return (-ENOENT);
+	pthread_rwlock_rdlock(&mcastpa.iftab_lock);
+	brp = mcast_br_ports_lookup(br_ifindex);
+	if ((brp != NULL) && (port >= 0) && (port < brp->size))
+		ifindex = brp->ifindex[port];
+	pthread_rwlock_unlock(&mcastpa.iftab_lock);
+	return (ifindex);
 }
 
 /**
- * @brief show an instance of a mc group entry head
- * @details 
- * @note
+ * @brief returns the current name of an ifindex
+ * @details falls back to the libnetlink map for interfaces not yet seen - on the worker, whose
+ * @details copy must not race the netlink thread, to an if<ifindex> placeholder
+ * @returns name
+ * @note the worker gets one of four thread local slots
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-void
-mcg_br_entry_head_show(FILE * f, struct mcg_br_mdb_entry_t *head)
+const char *
+mcast_if_name(int ifindex)
 {
-	SPRINT_BUF(abuf);
-	if (f == NULL)
-		return;
-	if (inet_ntop(AF_INET, &head->e.addr.u.ip4, abuf, sizeof (abuf))) {
-		fprintf(f, "wandev: %s brdev: %s first port: %s grp: %s ",
-			(char *) ll_index_to_name(head->wan_ifindex),
-			(char *) ll_index_to_name(head->br_ifindex), (char *) ll_index_to_name(head->e.ifindex), abuf);
-		fprintf(f, "video src: %s\n", head->src);
+	static __thread char names[4][IFNAMSIZ];
+	static __thread unsigned int slot;
+	struct mcast_if_t *ift;
+	char *name;
+
+	if (!mcast_pq_is_worker(&mcastpa.pq)) {
+		ift = mcast_if_get(ifindex);
+		if (ift == NULL)
+			return (ll_index_to_name(ifindex));
+		return (ift->name);
 	}
-	return;
+
+	/* worker thread - copy the name while the netlink thread cannot move or rename it */
+	name = names[slot++ & 3];
+	pthread_rwlock_rdlock(&mcastpa.iftab_lock);
+	ift = mcast_if_get(ifindex);
+	/* not ll_index_to_name() - its static buffer is filled by the netlink thread unlocked */
+	if (ift != NULL)
+		snprintf(name, IFNAMSIZ, "%s", ift->name);
+	else
+		snprintf(name, IFNAMSIZ, "if%d", ifindex);
+	pthread_rwlock_unlock(&mcastpa.iftab_lock);
+	return (name);
 }
 
 /**
- * @brief show an instance of a mc group entry
- * @details 
+ * @brief determines if an ifindex is a wan interface
+ * @details wan or video2lan role
+ * @returns 1 if wan 0 otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-void
-mcg_br_entry_show(FILE * f, struct mcg_br_mdb_entry_t *mcge)
+int
+mcast_if_iswan(int ifindex)
 {
-	SPRINT_BUF(abuf);
-	if (f == NULL)
-		return;
-	if (inet_ntop(AF_INET, &mcge->e.addr.u.ip4, abuf, sizeof (abuf))) {
-		fprintf(f, "brdev %s port %s grp %s \n", (char *) ll_index_to_name(mcge->br_ifindex),
-			(char *) ll_index_to_name(mcge->e.ifindex), abuf);
-	}
-	return;
+	return ((mcast_if_role(ifindex) & (MCAST_IF_WAN | MCAST_IF_VIDEO2LAN)) != 0);
 }
 
 /**
- * @brief compare bridge entries
- * @details return 1 if equal 0 otherwise
+ * @brief determines if an ifindex is a wifi interface
+ * @details
+ * @returns 1 if wifi 0 otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
 int
-mcg_br_entry_equal(struct br_mdb_entry *ex, struct br_mdb_entry *ey)
+mcast_if_iswifi(int ifindex)
 {
-	if (ex->ifindex == ey->ifindex) {
-		if (ex->addr.u.ip4 == ey->addr.u.ip4) {
-			if (memcmp(&ex->src_addr.eth_addr, &ey->src_addr.eth_addr, ETH_ALEN) == 0) {
-				return (1);
-			}
-		}
-	}
-	return (0);
+	return ((mcast_if_role(ifindex) & MCAST_IF_WIFI) != 0);
 }
 
 /**
- * @brief gets a head instance of mc group
- * @details just compares mcgroup
- * @returns pointer to entry or null
+ * @brief computes the role of an interface from its name and capabilities
+ * @details sysfs is only consulted when an interface is new or renamed
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-struct mcg_br_mdb_entry_t *
-mcg_br_entry_head_get(struct br_mdb_entry *e)
+static void
+mcast_if_classify(int ifindex, struct mcast_if_t *ift, const char *kind)
 {
-	struct list_head *pos;
-	struct mcg_br_mdb_entry_t *mcge;
+	int role = 0;
 
-	list_for_each(pos, &mcastpa.mcg_head) {
-		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_head);
-		if (e->addr.proto == htons(ETH_P_IP)) {
-			if (memcmp(&e->addr.u.ip4, &mcge->e.addr.u.ip4, sizeof (__be32)) == 0) {
-				return (mcge);
-			}
+	if (iswan(ift->name)) {
+		if (mcast_wan_entry_get(ift->name) != NULL) {
+			role |= MCAST_IF_WAN;
+			if (strcmp(ift->name, mcast_wan_entry_default()) == 0)
+				mcastpa.params.wan_ifindex = ifindex;
 		} else {
-			if (memcmp(&e->addr.u.ip6, &mcge->e.addr.u.ip6, sizeof (struct in6_addr)) == 0) {
-				return (mcge);
-			}
+			role |= MCAST_IF_VIDEO2LAN;
 		}
 	}
-	return (NULL);
+	if (iswifi(ift->name) || mcast_if_sysfs_has(ift->name, "wireless")
+	    || mcast_if_sysfs_has(ift->name, "phy80211"))
+		role |= MCAST_IF_WIFI;
+	if ((kind && (strcmp(kind, "bridge") == 0)) || mcast_if_sysfs_has(ift->name, "bridge")) {
+		role |= MCAST_IF_BRIDGE;
+		if (mcastpa.params.bridged && (strcmp(ift->name, mcastpa.params.bridge_name) == 0))
+			role |= MCAST_IF_VIDEO_BRIDGE;
+	}
+	ift->role = role | (ift->role & MCAST_IF_LANPORT);
 }
 
 /**
- * @brief get a mdb entry from the mc group list head list of attached group entries
- * @details compares br_mdb_entries 
- * @returns pointer to entry or null
+ * @brief updates the interface table from a RTM_NEWLINK or RTM_DELLINK
+ * @details handles creation, rename, enslave and delete
+ * @returns 0 if OK
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-struct mcg_br_mdb_entry_t *
-mcg_br_entry_get(struct mcg_br_mdb_entry_t *head, struct br_mdb_entry *e)
+static int
+mcast_if_update_locked(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
 {
-	struct list_head *pos;
-	struct mcg_br_mdb_entry_t *mcge;
+	struct ifinfomsg *ifi = NLMSG_DATA(n);
+	int len = n->nlmsg_len;
+	struct rtattr *tb[IFLA_MAX + 1];
+	struct rtattr *linkinfo[IFLA_INFO_MAX + 1];
+	struct mcast_if_t *ift;
+	const char *kind = NULL;
+	int size;
+	int renamed;
+
+	if (n->nlmsg_type != RTM_NEWLINK && n->nlmsg_type != RTM_DELLINK)
+		return 0;
 
-	list_for_each(pos, &head->mcg_entry) {
-		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
-		if (mcg_br_entry_equal(e, &mcge->e)) {
-			return (mcge);
+	len -= NLMSG_LENGTH(sizeof (*ifi));
+	if (len < 0) {
+		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
+		return -1;
+	}
+	if (ifi->ifi_index <= 0)
+		return 0;
+
+	if (ifi->ifi_index >= mcastpa.iftab_size) {
+		if (n->nlmsg_type == RTM_DELLINK)
+			return 0;
+		size = mcastpa.iftab_size ? mcastpa.iftab_size : MCAST_IF_TABLE_MIN;
+		while (size <= ifi->ifi_index)
+			size *= 2;
+		ift = (struct mcast_if_t *) realloc(mcastpa.iftab, size * sizeof (struct mcast_if_t));
+		if (ift == NULL)
+			return -1;
+		memset(ift + mcastpa.iftab_size, 0, (size - mcastpa.iftab_size) * sizeof (struct mcast_if_t));
+		mcastpa.iftab = ift;
+		mcastpa.iftab_size = size;
+	}
+	ift = &mcastpa.iftab[ifi->ifi_index];
+
+	/* bridge port messages (AF_BRIDGE) are deleted when the port leaves the bridge - not the device */
+	if (n->nlmsg_type == RTM_DELLINK) {
+		if (ifi->ifi_family == AF_BRIDGE) {
+			ift->role &= ~MCAST_IF_LANPORT;
+			ift->master = 0;
+		} else {
+			memset(ift, 0, sizeof (struct mcast_if_t));
+		}
+		return 0;
+	}
+
+	parse_rtattr(tb, IFLA_MAX, IFLA_RTA(ifi), len);
+
+	ift->flags = ifi->ifi_flags;
+	if (tb[IFLA_MASTER]) {
+		ift->master = rta_getattr_u32(tb[IFLA_MASTER]);
+		ift->role |= MCAST_IF_LANPORT;
+	} else if (ifi->ifi_family != AF_BRIDGE) {
+		ift->master = 0;
+		ift->role &= ~MCAST_IF_LANPORT;
+	}
+	if (tb[IFLA_LINKINFO]) {
+		parse_rtattr(linkinfo, IFLA_INFO_MAX, RTA_DATA(tb[IFLA_LINKINFO]), RTA_PAYLOAD(tb[IFLA_LINKINFO]));
+		if (linkinfo[IFLA_INFO_KIND])
+			kind = rta_getattr_str(linkinfo[IFLA_INFO_KIND]);
+	}
+
+	renamed = 0;
+	if (tb[IFLA_IFNAME]) {
+		if (!ift->valid || strncmp(ift->name, rta_getattr_str(tb[IFLA_IFNAME]), IFNAMSIZ) != 0) {
+			snprintf(ift->name, sizeof (ift->name), "%s", rta_getattr_str(tb[IFLA_IFNAME]));
+			renamed = 1;
 		}
 	}
-	return (NULL);
+	if (!ift->valid && !renamed)
+		return 0;	/* never learned a name */
+	ift->valid = 1;
+	if (renamed) {
+		mcast_if_classify(ifi->ifi_index, ift, kind);
+		syslog(LOG_INFO, "%s:%d ifindex %d name %s role 0x%x master %d\n", __FUNCTION__, __LINE__,
+		       ifi->ifi_index, ift->name, ift->role, ift->master);
+	}
+	return 0;
 }
 
 /**
- * @brief add a bridge mdb entry to the mc group list head list
- * @details subordinate members of group
- * @returns pointer to entry or null
+ * @brief updates the interface table from an RTM_NEWLINK or RTM_DELLINK
+ * @details serialized against interface name lookups from the programming worker
+ * @returns 0 if OK -1 otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-struct mcg_br_mdb_entry_t *
-mcg_br_entry_add(struct mcg_br_mdb_entry_t *head, struct br_mdb_entry *e)
+int
+mcast_if_update(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
 {
-	struct mcg_br_mdb_entry_t *p_mcg_br_mdb_entry;
-	p_mcg_br_mdb_entry = (struct mcg_br_mdb_entry_t *) malloc(sizeof (struct mcg_br_mdb_entry_t));
-	if (p_mcg_br_mdb_entry == NULL) {
-		return (NULL);
-	}
-	memset(p_mcg_br_mdb_entry, 0, sizeof (struct mcg_br_mdb_entry_t));
-	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->mcg_entry);
-	memcpy(&p_mcg_br_mdb_entry->e, e, sizeof (struct br_mdb_entry));
-	list_add(&p_mcg_br_mdb_entry->mcg_entry, &head->mcg_entry);
-	return (p_mcg_br_mdb_entry);
+	int res;
+
+	pthread_rwlock_wrlock(&mcastpa.iftab_lock);
+	res = mcast_if_update_locked(who, n, arg);
+	pthread_rwlock_unlock(&mcastpa.iftab_lock);
+	return (res);
 }
 
 /**
- * @brief add a bridge mdb entry to the mc group list head
- * @details initial instance of a group
- * @returns pointer to entry or null
+ * @brief passes one dump reply to its handler
+ * @details records it first when --nl-record is set
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-struct mcg_br_mdb_entry_t *
-mcg_br_entry_head_add(struct br_mdb_entry *e)
+static int
+mcast_nl_dump_msg(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
 {
-	struct mcg_br_mdb_entry_t *p_mcg_br_mdb_entry;
-	p_mcg_br_mdb_entry = (struct mcg_br_mdb_entry_t *) malloc(sizeof (struct mcg_br_mdb_entry_t));
-	if (p_mcg_br_mdb_entry == NULL) {
-		return (NULL);
-	}
+	rtnl_filter_t filter = (rtnl_filter_t) arg;
 
-	memset(p_mcg_br_mdb_entry, 0, sizeof (struct mcg_br_mdb_entry_t));
-	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->mcg_head);
-	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->mcg_entry);
-	memcpy(&p_mcg_br_mdb_entry->e, e, sizeof (struct br_mdb_entry));
-	list_add(&p_mcg_br_mdb_entry->mcg_head, &mcastpa.mcg_head);
-	return (p_mcg_br_mdb_entry);
+	mcast_nlrec_write(n, MCAST_NLREC_DUMP, 0);
+	return (filter(who, n, NULL));
 }
 
 /**
- * @brief delete a bridge mdb entry from the mc group list head
- * @details removes instance of a group
+ * @brief reads the replies of a dump request
+ * @details
+ * @returns libnetlink rtnl_dump_filter() result
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-int
-mcg_br_entry_head_del(struct mcg_br_mdb_entry_t *head)
+static int
+mcast_nl_dump(struct rtnl_handle *h, rtnl_filter_t filter)
 {
-	struct list_head *pos;
-	struct list_head *q;
-	struct mcg_br_mdb_entry_t *mcge;
+	int res;
 
-	list_for_each_safe(pos, q, &mcastpa.mcg_head) {
-		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_head);
-		if (mcge->e.addr.u.ip4 == head->e.addr.u.ip4) {
-			list_del(pos);
-			free(mcge);
-			return (0);
-		}
-	}
-	return (-ENOENT);
+	res = rtnl_dump_filter(h, mcast_nl_dump_msg, (void *) filter);
+	mcast_nlrec_flush();
+	return (res);
 }
 
 /**
- * @brief delete a bridge mdb entry from the mc group list head list
- * @details removes instance of a group as a sub of the group head
+ * @brief initialize the interface table from a link dump
+ * @details
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-int
-mcg_br_entry_del(struct mcg_br_mdb_entry_t *head, struct br_mdb_entry *e)
+static int
+mcast_if_parse_init(void)
 {
-	struct list_head *pos;
-	struct list_head *q;
-	struct mcg_br_mdb_entry_t *mcge;
+	if (rtnl_wilddump_request(&rth, AF_UNSPEC, RTM_GETLINK) < 0) {
+		syslog(LOG_INFO, "Cannot send RTM_GETLINK dump request\n");
+		return 1;
+	}
 
-	list_for_each_safe(pos, q, &head->mcg_entry) {
-		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
-		if (mcg_br_entry_equal(e, &mcge->e)) {
-			list_del(pos);
-			free(mcge);
-			return (0);
-		}
+	if (mcast_nl_dump(&rth, mcast_if_update) < 0) {
+		syslog(LOG_INFO, "Dump terminated\n");
+		return 1;
 	}
-	return (-ENOENT);
+	return 0;
 }
 
 /**
- * @brief delete a bridge mdb entry from the mc group list head
- * @details removes instance of a group
- * @note
+ * @brief hashes a local address to its bucket
+ * @returns bucket index
  * @author tim.hayes@smartrg.com
- * @callgraph
- * @callergraph
  */
-void
-mcg_br_entry_head_del_all(struct mcg_br_mdb_entry_t *head)
+static inline unsigned int
+mcast_ip_hash(int family, const void *addr)
 {
-	struct list_head *pos;
-	struct list_head *q;
-	struct mcg_br_mdb_entry_t *mcge;
+	const uint32_t *w = (const uint32_t *) addr;
+	uint32_t key;
 
-	list_for_each_safe(pos, q, &mcastpa.mcg_head) {
-		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_head);
-		mcg_br_entry_del(head, &mcge->e);
-	}
+	key = (family == AF_INET) ? w[0] : (w[0] ^ w[1] ^ w[2] ^ w[3]);
+	return ((key * 0x9E3779B1U) >> 27) & (IP_HASH_SIZE - 1);
 }
 
 /**
- * @brief traverses all head groups, removes all sub entries issues leave and deletes head
- * @details calls leave for head group
- * @note
+ * @brief compares a local address
+ * @returns 1 if equal 0 otherwise
  * @author tim.hayes@smartrg.com
- * @callgraph
- * @callergraph
  */
-int
-mcg_br_entry_head_list_del_all(void)
+static inline int
+mcast_ip_equal(struct mcast_ip_entry_t *ip, int family, const void *addr)
 {
-	struct list_head *pos;
-	struct list_head *q;
-	struct mcg_br_mdb_entry_t *head;
-	list_for_each_safe(pos, q, &mcastpa.mcg_head) {
-		head = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_head);
-		mcg_br_entry_leave(head, NULL);
-		mcg_br_entry_head_del(head);
-	}
-	return (0);
+	if (ip->addr.family != family)
+		return (0);
+	return (memcmp(&ip->addr.u, addr, family == AF_INET ? sizeof (struct in_addr) : sizeof (struct in6_addr)) ==
+		0);
 }
 
 /**
- * @brief lists instances of a mc group entires tied to a mc group head entry
+ * @brief add a ip address to our host set
  * @details 
- * @note
+ * @returns pointer to entry or null
+ * @note the same address on two devices is two entries
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-void
-mcg_br_entry_list_show(FILE * f, struct mcg_br_mdb_entry_t *head)
+struct mcast_ip_entry_t *
+mcast_ip_entry_add(int family, const void *addr, int ifindex)
 {
-	struct list_head *pos;
-	struct mcg_br_mdb_entry_t *mcge;
-	if (f == NULL)
-		return;
-	list_for_each(pos, &head->mcg_entry) {
-		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
-		mcg_br_entry_show(f, mcge);
+	struct mcast_ip_entry_t *p_mcast_ip_entry;
+	p_mcast_ip_entry = (struct mcast_ip_entry_t *) malloc(sizeof (struct mcast_ip_entry_t));
+	if (p_mcast_ip_entry == NULL) {
+		return (NULL);
 	}
-	return;
+	memset(p_mcast_ip_entry, 0, sizeof (struct mcast_ip_entry_t));
+	INIT_LIST_HEAD(&p_mcast_ip_entry->head);
+	p_mcast_ip_entry->ifindex = ifindex;
+	p_mcast_ip_entry->addr.family = family;
+	memcpy(&p_mcast_ip_entry->addr.u, addr, family == AF_INET ? sizeof (struct in_addr) : sizeof (struct in6_addr));
+	list_add(&p_mcast_ip_entry->head, &mcastpa.ip_hash[mcast_ip_hash(family, addr)]);
+	return (p_mcast_ip_entry);
 }
 
 /**
- * @brief sets src mac in mjl struct
- * @details uses part of ipv6 union - this is supported by a bridge patch
- * @todo someday get a really clean way of doing this
- * @note done to support Intel wifi mc which requires source of video subscriber
+ * @brief returns the entry of an ip address on a device
+ * @details ifindex 0 matches any device
+ * @note
+ * @returns entry if address found null otherwise
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-void
-mcg_br_entry_srcmac_set(struct mcg_br_mdb_entry_t *mcge, struct mcastpa_join_leave_t *mjl)
+struct mcast_ip_entry_t *
+mcast_ip_entry_get(int family, const void *addr, int ifindex)
 {
-	memcpy(mjl->srcmac, &mcge->e.src_addr.eth_addr, ETH_ALEN);
+	struct list_head *pos;
+	struct mcast_ip_entry_t *p_mcast_ip_entry;
+
+	list_for_each(pos, &mcastpa.ip_hash[mcast_ip_hash(family, addr)]) {
+		p_mcast_ip_entry = (struct mcast_ip_entry_t *) list_entry(pos, struct mcast_ip_entry_t, head);
+		if (((ifindex == 0) || (p_mcast_ip_entry->ifindex == ifindex)) &&
+		    mcast_ip_equal(p_mcast_ip_entry, family, addr)) {
+			return (p_mcast_ip_entry);
+		}
+	}
+	return (NULL);
 }
 
 /**
- * @brief joins a new group
- * @details calls hw specific pa_join()
- * @todo IPV6
+ * @brief delete an ip address of a device if found
+ * @details 
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
 int
-mcg_br_entry_join(struct mcg_br_mdb_entry_t *head)
+mcast_ip_entry_del(int family, const void *addr, int ifindex)
 {
-	SPRINT_BUF(group);
-	struct list_head *pos;
-	struct mcg_br_mdb_entry_t *mcge;
-	int len = 0;
-	char src[INET_ADDR_SIZE] = { 0 };
-					/**< ip address of video source - head use only */
-	struct mcastpa_join_leave_t mjl;
-	int res = 0;
-
-	if (inet_ntop(AF_INET, &head->e.addr.u.ip4, group, sizeof (group))) {
-		syslog(LOG_INFO, "%s:%d join request group %s\n", __FUNCTION__, __LINE__, group);
-	} else {
-		syslog(LOG_NOTICE, "%s:%d BUG join request no IPV4 Group\n", __FUNCTION__, __LINE__);
-		return (-ENOENT);	/* not ready to join - no video src */
-	}
-
-	if (!mcastpa.params.bridged) {
-		if (mcastpa.params.use_src == 0) {
-			if (head->src[0] == 0) {
-				return (-ENOENT);	/* not ready to join - no video src */
-			}
-			strcpy(src, head->src);
-		} else {
-			strcpy(src, mcastpa.params.src);
-		}
-	}
-
-	memset(&mjl, 0, sizeof (struct mcastpa_join_leave_t));
-	if (inet_ntop(AF_INET, &head->e.addr.u.ip4, group, sizeof (group))) {
-		if (mcastpa.params.bridged) {
-			mjl.flags |= MJL_FLAG_BRIDGE;
-		}
-		sprintf((char *) &mjl.group, "%s", group);
-		mjl.flags |= MJL_FLAG_SRCIP;
-		sprintf((char *) &mjl.srcip, "%s", src);
-		sprintf((char *) &mjl.wan, "%s", mcast_wan_entry_default());
-		list_for_each(pos, &head->mcg_entry) {
-			mjl.flags |= MJL_FLAG_LAN;
-			mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
-			len += sprintf((char *) (&mjl.lan + len), " %s ", (char *) ll_index_to_name(mcge->e.ifindex));
-			if (mcge->joined == 1) {
-				/* at least one group has been joined already */
-				mjl.flags |= MJL_FLAG_UPDATE;
-			}
-		}
-		list_for_each(pos, &head->mcg_entry) {
-			mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
-			mcg_br_entry_srcmac_set(mcge, &mjl);
-			if (mcge->joined == 0) {
-				sprintf((char *) (&mjl.lan_dev), "%s", (char *) ll_index_to_name(mcge->e.ifindex));
-				res = pa_join(&mjl);
-				if (res == 0)
-					mcge->joined = 1;
-				syslog(LOG_INFO, "%s:%d join request sent group %s res: %d\n", __FUNCTION__, __LINE__,
-				       group, res);
-			}
-		}
-	}
+	struct mcast_ip_entry_t *p_mcast_ip_entry = mcast_ip_entry_get(family, addr, ifindex);
 
+	if (p_mcast_ip_entry == NULL)
+		return (-ENOENT);
+	list_del(&p_mcast_ip_entry->head);
+	free(p_mcast_ip_entry);
 	return (0);
 }
 
 /**
- * @brief leaves with no groups or joins with smaller group list
- * @details calls hw specific pa_leave()
+ * @brief determines if an address is one of our own local
+ * @details binary address as found in a netlink attribute
+ * @returns 1 if ours 0 otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
 int
-mcg_br_entry_leave(struct mcg_br_mdb_entry_t *head, struct br_mdb_entry *e)
+islocaladdr(int family, const void *addr)
 {
-	SPRINT_BUF(group);
-	struct list_head *pos;
-	struct mcg_br_mdb_entry_t *mcge;
-	int len = 0;
-	char src[INET_ADDR_SIZE];		/**< ip address of video source - head use only */
-	struct mcastpa_join_leave_t mjl;
-
-	syslog(LOG_INFO, "%s:%d leave request \n", __FUNCTION__, __LINE__);
-	if (!mcastpa.params.bridged) {
-		if (mcastpa.params.use_src == 0) {
-			if (head->src[0] == 0) {
-				return (-ENOENT);	/* not ready to join - no video src */
-			}
-			strcpy(src, head->src);
-		} else {
-			strcpy(src, mcastpa.params.src);
-		}
-	}
-
-	memset(&mjl, 0, sizeof (struct mcastpa_join_leave_t));
-	if (inet_ntop(AF_INET, &head->e.addr.u.ip4, group, sizeof (group))) {
-		if (mcastpa.params.bridged) {
-			mjl.flags |= MJL_FLAG_BRIDGE;
-		}
-		sprintf((char *) &mjl.group, "%s", group);
-		mjl.flags |= MJL_FLAG_SRCIP;
-		sprintf((char *) &mjl.srcip, "%s", src);
-		sprintf((char *) &mjl.wan, "%s", mcast_wan_entry_default());
-		list_for_each(pos, &head->mcg_entry) {
-			mjl.flags |= MJL_FLAG_LAN;
-			mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
-			len += sprintf((char *) (&mjl.lan + len), " %s ", (char *) ll_index_to_name(mcge->e.ifindex));
-		}
-		list_for_each(pos, &head->mcg_entry) {
-			mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
-			mcg_br_entry_srcmac_set(mcge, &mjl);
-			if (e != NULL) {
-				if (mcg_br_entry_equal(e, &mcge->e)) {
-					if (mcge->joined == 1) {
-						sprintf((char *) (&mjl.lan_dev), "%s",
-							(char *) ll_index_to_name(mcge->e.ifindex));
-						pa_leave(&mjl);
-						mcge->joined = 0;
-					}
-				}
-			} else {
-				if (mcge->joined == 1) {
-					sprintf((char *) (&mjl.lan_dev), "%s",
-						(char *) ll_index_to_name(mcge->e.ifindex));
-					pa_leave(&mjl);
-					mcge->joined = 0;
-					syslog(LOG_INFO, "%s:%d leave request sent group %s\n", __FUNCTION__,
-					       __LINE__, group);
-				}
-			}
-		}
-	}
-
-	if (e != NULL) {
-		mcg_br_entry_del(head, e);
-	} else {
-		mcg_br_entry_head_del_all(head);
-	}
-
-	return (0);
+	return (mcast_ip_entry_get(family, addr, 0) != NULL);
 }
 
 /**
- * @brief lists instances of head a mc group entires 
+ * @brief show all host ip addresses
  * @details 
  * @note
  * @author tim.hayes@smartrg.com
@@ -1104,987 +1169,3063 @@ mcg_br_entry_leave(struct mcg_br_mdb_entry_t *head, struct br_mdb_entry *e)
  * @callergraph
  */
 void
-mcg_br_entry_head_list_show(void)
+mcast_ip_entry_show(FILE * f)
 {
 	struct list_head *pos;
-	struct mcg_br_mdb_entry_t *head;
-	FILE *f = fopen("/tmp/mcastpa-dump", "w");
+	struct mcast_ip_entry_t *p_mcast_ip_entry;
+	char abuf[INET6_ADDRSTRLEN];
+	int i;
+
 	if (f == NULL)
 		return;
-	list_for_each(pos, &mcastpa.mcg_head) {
-		head = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_head);
-		fprintf(f, "%s\n", "==== head list ====\n");
-		mcg_br_entry_head_show(f, head);
-		fprintf(f, "%s\n", "==== entry list ====\n");
-		mcg_br_entry_list_show(f, head);
+	for (i = 0; i < IP_HASH_SIZE; i++) {
+		list_for_each(pos, &mcastpa.ip_hash[i]) {
+			p_mcast_ip_entry = (struct mcast_ip_entry_t *) list_entry(pos, struct mcast_ip_entry_t, head);
+			inet_ntop(p_mcast_ip_entry->addr.family, &p_mcast_ip_entry->addr.u, abuf, sizeof (abuf));
+			fprintf(f, "ip address %s dev %s\n", abuf, mcast_if_name(p_mcast_ip_entry->ifindex));
+		}
 	}
-	fclose(f);
-	return;
 }
 
 /**
- * @brief joins a vsa requested group on a device
- * @details emulates a bridge device joining
+ * @brief formats the group address of a head
+ * @details ipv4 or ipv6 from the mdb protocol
+ * @returns buf
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-void
-vsa_entry_join(void)
+static const char *
+mcg_head_addr_str(struct mcg_br_head_t *head, char *buf, size_t len)
 {
-	struct br_mdb_entry _e;
-	struct br_mdb_entry *e;
-	struct mcg_br_mdb_entry_t *head;
-	struct mcg_br_mdb_entry_t *mcge;
+	int family = (head->addr.proto == htons(ETH_P_IP)) ? AF_INET : AF_INET6;
 
-	e = &_e;
-	inet_pton(AF_INET, mcastpa.params.vsa.group, &(e->addr.u.ip4));
-	e->ifindex = ll_name_to_index(mcastpa.params.vsa.device);
-	e->addr.proto = ETH_P_IP;
-	head = mcg_br_entry_head_get(e);
-	if (head == NULL) {
-		head = mcg_br_entry_head_add(e);
-		if (head != NULL) {
-			head->br_ifindex = 0;
-		}
-	}
-	if (head != NULL) {
-		mcge = mcg_br_entry_get(head, e);
-		if (mcge == NULL) {
-			mcge = mcg_br_entry_add(head, e);
-		}
-		mcg_br_entry_join(head);
-	}
+	if (inet_ntop(family, &head->addr.u, buf, len) == NULL)
+		buf[0] = 0;
+	return (buf);
 }
 
 /**
- * @brief leave a vsa requested group on a device
- * @details emulates a bridge device joining
+ * @brief writes a trace record for a group and optionally one of its members
+ * @details every group table change is traced so this also marks the snapshot stale
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-void
-vsa_entry_leave(void)
+static inline void
+mcg_trace(int ev, struct mcg_br_head_t *head, int ifindex, const unsigned char *mac, uint32_t arg)
 {
-	struct br_mdb_entry _e;
-	struct br_mdb_entry *e;
-	struct mcg_br_mdb_entry_t *head;
-	struct mcg_br_mdb_entry_t *mcge;
+	mcastpa.snap_dirty = 1;
+	mcast_trace(ev, (head->addr.proto == htons(ETH_P_IP)) ? AF_INET : AF_INET6, &head->addr.u, ifindex, mac, 0,
+		    arg);
+}
 
-	e = &_e;
-	inet_pton(AF_INET, mcastpa.params.vsa.group, &(e->addr.u.ip4));
-	e->ifindex = ll_name_to_index(mcastpa.params.vsa.device);
-	e->addr.proto = ETH_P_IP;
-	head = mcg_br_entry_head_get(e);
-	if (head == NULL) {
-		return;
-	}
+/**
+ * @brief folds a group address to 32 bits for hashing
+ * @details proto is ETH_P_IP or ETH_P_IPV6 in network order as found in br_mdb_entry
+ * @returns host order ipv4 address or the xor of the four ipv6 words
+ * @author tim.hayes@smartrg.com
+ */
+static inline uint32_t
+mcg_addr_fold(__be16 proto, const void *addr)
+{
+	const uint32_t *w = (const uint32_t *) addr;
 
-	mcge = mcg_br_entry_get(head, e);
-	if (mcge == NULL) {
-		syslog(LOG_INFO, "vsa mcge is NULL\n");
-		return;
-	}
+	if (proto == htons(ETH_P_IP))
+		return (ntohl(w[0]));
+	return (ntohl(w[0] ^ w[1] ^ w[2] ^ w[3]));
+}
 
-	mcg_br_entry_leave(head, e);
+/**
+ * @brief hashes a binary mc group address to a group hash bucket
+ * @details proto is ETH_P_IP or ETH_P_IPV6 in network order as found in br_mdb_entry
+ * @returns bucket index
+ * @note ipv6 groups are folded to 32 bits first
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline unsigned int
+mcg_hash_addr(__be16 proto, const void *addr)
+{
+	return ((mcg_addr_fold(proto, addr) * 0x9E3779B1U) >> (32 - MCG_HASH_BITS));
+}
 
-	if (list_empty(&head->mcg_entry)) {
-		mcg_br_entry_head_del(head);
-	}
+/**
+ * @brief hashes a group member to a member hash bucket
+ * @details key is the group of the head plus ifindex of the bridge port - not the srcmac, so
+ * @details all members of a group on one port share a bucket
+ * @returns bucket index
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline unsigned int
+mcg_hash_member(struct mcg_br_head_t *head, int ifindex)
+{
+	uint32_t key;
 
+	key = mcg_addr_fold(head->addr.proto, &head->addr.u);
+	key ^= (uint32_t) ifindex * 0x85EBCA6BU;
+	return ((key * 0x9E3779B1U) >> (32 - MBR_HASH_BITS));
 }
 
 /**
- * @brief process a vsa request
- * @details 
+ * @brief hashes a bridge port ifindex to a reverse index bucket
+ * @returns bucket index
+ * @author tim.hayes@smartrg.com
+ */
+static inline unsigned int
+mcg_hash_port(int ifindex)
+{
+	return ((unsigned int) ifindex & (PORT_HASH_SIZE - 1));
+}
+
+/**
+ * @brief hashes a subscriber srcmac to a reverse index bucket
+ * @details nic specific low bytes only - the oui does not spread
+ * @returns bucket index
+ * @author tim.hayes@smartrg.com
+ */
+static inline unsigned int
+mcg_hash_mac(const unsigned char *mac)
+{
+	uint32_t key = ((uint32_t) mac[3] << 16 | (uint32_t) mac[4] << 8 | mac[5]);
+	return ((key * 0x9E3779B1U) >> 24) & (MAC_HASH_SIZE - 1);
+}
+
+/**
+ * @brief compares a binary mc group address with the group of a head
+ * @returns 1 if equal 0 otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-void
-vsa_entry_process(void)
+static inline int
+mcg_head_addr_equal(struct mcg_br_head_t *head, __be16 proto, const void *addr)
 {
-	if (strcmp(mcastpa.params.vsa.op, "join") == 0) {
-		vsa_entry_join();
-	}
-	if (strcmp(mcastpa.params.vsa.op, "leave") == 0) {
-		vsa_entry_leave();
-	}
+	if (head->addr.proto != proto)
+		return (0);
+	if (proto == htons(ETH_P_IP))
+		return (memcmp(addr, &head->addr.u.ip4, sizeof (__be32)) == 0);
+	return (memcmp(addr, &head->addr.u.ip6, sizeof (struct in6_addr)) == 0);
 }
 
 /**
- * @brief finds a head entry from a specific mc group
- * @details 
- * @returns pointer if group found NULL otherwise 
+ * @brief gets a head instance of mc group from a binary group address
+ * @details single hash bucket walk
+ * @returns pointer to entry or null
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-struct mcg_br_mdb_entry_t *
-mcg_br_entry_head_get_from_group(char *group)
+struct mcg_br_head_t *
+mcg_br_entry_head_lookup(__be16 proto, const void *addr)
 {
-	SPRINT_BUF(headgroup);
 	struct list_head *pos;
-	struct mcg_br_mdb_entry_t *mcge;
-	list_for_each(pos, &mcastpa.mcg_head) {
-		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_head);
-		if (inet_ntop(AF_INET, &mcge->e.addr.u.ip4, headgroup, sizeof (headgroup))) {
-			if (strcmp(headgroup, group) == 0)
-				return (mcge);
+	struct list_head *bucket;
+	struct mcg_br_head_t *head;
+
+	bucket = &mcastpa.mcg_hash[mcg_hash_addr(proto, addr)];
+	list_for_each(pos, bucket) {
+		head = (struct mcg_br_head_t *) list_entry(pos, struct mcg_br_head_t, mcg_hash);
+		if (mcg_head_addr_equal(head, proto, addr)) {
+			return (head);
 		}
 	}
 	return (NULL);
 }
 
 /**
- * @brief  exit handler
- * @details
+ * @brief gets a head instance of mc group
+ * @details just compares mcgroup
+ * @returns pointer to entry or null
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-#define MDB_FORK_EXIT 69
-static void
-mdb_exit_handler(int ev, void *arg)
+struct mcg_br_head_t *
+mcg_br_entry_head_get(struct br_mdb_entry *e)
 {
-	struct mcastpa_system_init_t msi;
-	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
-	if (ev == MDB_FORK_EXIT)
-		return;
-	syslog(LOG_INFO, "%s:%d removing head lists\n", __FUNCTION__, __LINE__);
-	mcg_br_entry_head_list_del_all();
-	memset(&msi, 0, sizeof (struct mcastpa_system_init_t));
-	pa_deinit(&msi);
-	closelog();
+	return (mcg_br_entry_head_lookup(e->addr.proto, &e->addr.u));
 }
 
 /**
- * @brief  misc parse_route support function
+ * @brief returns the port numbering of a bridge - creates it with the first member
  * @details
+ * @returns numbering or NULL if out of memory
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-const char *
-rt_addr_n2a(int af, const void *addr, char *buf, int buflen)
+static struct mcast_br_ports_t *
+mcast_br_ports_get(int br_ifindex)
 {
-	switch (af) {
-	case AF_INET:
-	case AF_INET6:
-		return inet_ntop(af, addr, buf, buflen);
-	default:
-		return "???";
-	}
+	struct mcast_br_ports_t *brp;
+
+	brp = mcast_br_ports_lookup(br_ifindex);
+	if (brp != NULL)
+		return (brp);
+	brp = (struct mcast_br_ports_t *) calloc(1, sizeof (struct mcast_br_ports_t));
+	if (brp == NULL)
+		return (NULL);
+	brp->br_ifindex = br_ifindex;
+	pthread_rwlock_wrlock(&mcastpa.iftab_lock);
+	list_add_tail(&brp->list, &mcastpa.br_ports);
+	pthread_rwlock_unlock(&mcastpa.iftab_lock);
+	return (brp);
 }
 
 /**
- * @brief  misc parse_route support function
+ * @brief releases the port numbering of all bridges
  * @details
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-char *
-format_host(int af, int len, const void *addr, char *buf, int buflen)
+static void
+mcast_br_ports_free_all(void)
 {
-	return (char *) rt_addr_n2a(af, addr, buf, buflen);
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcast_br_ports_t *brp;
+
+	list_for_each_safe(pos, q, &mcastpa.br_ports) {
+		brp = (struct mcast_br_ports_t *) list_entry(pos, struct mcast_br_ports_t, list);
+		list_del(&brp->list);
+		free(brp->ifindex);
+		free(brp->members);
+		free(brp);
+	}
 }
 
 /**
- * @brief  misc parse_route support function
- * @details
+ * @brief doubles the port numbers of a bridge
+ * @returns first new number or -1 if at MCASTPA_PORTMAP_BITS or out of memory
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-int
-af_bit_len(int af)
+static int
+mcast_br_ports_grow(struct mcast_br_ports_t *brp)
 {
-	switch (af) {
-	case AF_INET6:
-		return 128;
-	case AF_INET:
-		return 32;
-	case AF_DECnet:
-		return 16;
-	case AF_IPX:
-		return 80;
+	unsigned int size = brp->size ? brp->size * 2 : MCAST_BR_PORTS_MIN;
+	unsigned int old = brp->size;
+	int *ifindex;
+	unsigned int *members;
+
+	if (size > MCASTPA_PORTMAP_BITS)
+		size = MCASTPA_PORTMAP_BITS;
+	if (size <= old)
+		return (-1);
+	pthread_rwlock_wrlock(&mcastpa.iftab_lock);
+	ifindex = (int *) realloc(brp->ifindex, size * sizeof (int));
+	if (ifindex != NULL)
+		brp->ifindex = ifindex;
+	members = (unsigned int *) realloc(brp->members, size * sizeof (unsigned int));
+	if (members != NULL)
+		brp->members = members;
+	if ((ifindex != NULL) && (members != NULL)) {
+		memset(brp->ifindex + old, 0, (size - old) * sizeof (int));
+		memset(brp->members + old, 0, (size - old) * sizeof (unsigned int));
+		brp->size = size;
 	}
-
-	return 0;
+	pthread_rwlock_unlock(&mcastpa.iftab_lock);
+	return ((brp->size == size) ? (int) old : -1);
 }
 
 /**
- * @brief  misc parse_route support function
- * @details
+ * @brief determines if a port number of a bridge may be given to another port
+ * @details never given out, or its port is gone from the bridge with no members left and
+ * @details no request in flight or waiting for a retry can still carry the number
+ * @returns 1 if free 0 otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-static inline int
-rtm_get_table(struct rtmsg *r, struct rtattr **tb)
+static int
+mcast_br_ports_unused(struct mcast_br_ports_t *brp, int port)
 {
-	__u32 table = r->rtm_table;
-	if (tb[RTA_TABLE])
-		table = rta_getattr_u32(tb[RTA_TABLE]);
-	return table;
+	struct mcast_if_t *ift;
+
+	if (brp->ifindex[port] == 0)
+		return (1);
+	if (brp->members[port] || mcast_pq_depth(&mcastpa.pq) || !list_empty(&mcastpa.retry_list))
+		return (0);
+	ift = mcast_if_get(brp->ifindex[port]);
+	return ((ift == NULL) || (ift->master != brp->br_ifindex));
 }
 
 /**
- * @brief  misc parse_route support function
- * @details
+ * @brief takes the port number of a member port in its bridge
+ * @details the number last given to the port is remembered in the interface table, so only
+ * @details the first member of a port searches the numbering - it grows when all are taken
+ * @returns port number or MCAST_PORT_NONE if the bridge has MCASTPA_PORTMAP_BITS ports in use
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-static void
-print_rtax_features(FILE * fp, unsigned int features)
+static unsigned short
+mcg_port_get(struct mcast_br_ports_t *brp, int ifindex)
 {
-	unsigned int of = features;
+	struct mcast_if_t *ift = mcast_if_get(ifindex);
+	int free = -1;
+	int i;
 
-	if (features & RTAX_FEATURE_ECN) {
-		syslog(LOG_INFO, " ecn");
-		features &= ~RTAX_FEATURE_ECN;
+	if ((ift != NULL) && ift->port && (ift->port <= brp->size) && (brp->ifindex[ift->port - 1] == ifindex)) {
+		i = ift->port - 1;
+	} else {
+		for (i = 0; i < brp->size; i++) {
+			if (brp->ifindex[i] == ifindex)
+				break;
+			if ((free < 0) && mcast_br_ports_unused(brp, i))
+				free = i;
+		}
+		if (i == brp->size) {
+			if (free < 0)
+				free = mcast_br_ports_grow(brp);
+			if (free < 0) {
+				if (mcastpa.port_full++ == 0)
+					syslog(LOG_NOTICE, "%s:%d all %u port numbers of bridge %s taken - %s left out of "
+					       "lan sets\n", __FUNCTION__, __LINE__, brp->size,
+					       mcast_if_name(brp->br_ifindex), mcast_if_name(ifindex));
+				return (MCAST_PORT_NONE);
+			}
+			i = free;
+			__atomic_store_n(&brp->ifindex[i], ifindex, __ATOMIC_RELAXED);
+		}
+		if (ift != NULL)
+			ift->port = i + 1;
 	}
-
-	if (features)
-		syslog(LOG_INFO, " 0x%x", of);
+	brp->members[i]++;
+	return (i);
 }
 
 /**
- * @brief parses route update and gets our host ip address
- * @todo support for multihoming and review
- * @details
+ * @brief adds a port number to the port set of a group
+ * @details numbers from 64 up go to words allocated on demand - most groups never need them
+ * @returns 0 if OK -ENOMEM otherwise
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-int
-parse_route(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+static int
+mcg_head_port_set(struct mcg_br_head_t *head, unsigned short port)
 {
-	struct rtmsg *r = NLMSG_DATA(n);
-	int len = n->nlmsg_len;
-	struct rtattr *tb[RTA_MAX + 1];
-	char abuf[256];
-	int host_len;
-	static int hz;
+	unsigned int word = port / 64;
+	uint64_t *ext;
 
-	if (n->nlmsg_type != RTM_NEWROUTE && n->nlmsg_type != RTM_DELROUTE) {
-		syslog(LOG_INFO, "Not a route: %08x %08x %08x\n", n->nlmsg_len, n->nlmsg_type, n->nlmsg_flags);
-		return 0;
+	if (word == 0) {
+		head->ports |= 1ULL << port;
+		return (0);
 	}
-
-	len -= NLMSG_LENGTH(sizeof (*r));
-	if (len < 0) {
-		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
-		return -1;
+	if (word > head->ports_ext_words) {
+		ext = (uint64_t *) realloc(head->ports_ext, word * sizeof (uint64_t));
+		if (ext == NULL)
+			return (-ENOMEM);
+		memset(ext + head->ports_ext_words, 0, (word - head->ports_ext_words) * sizeof (uint64_t));
+		head->ports_ext = ext;
+		head->ports_ext_words = word;
 	}
+	head->ports_ext[word - 1] |= 1ULL << (port % 64);
+	return (0);
+}
 
-	host_len = af_bit_len(r->rtm_family);
-
-	parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+/**
+ * @brief removes a port number from the port set of a group
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline void
+mcg_head_port_clear(struct mcg_br_head_t *head, unsigned short port)
+{
+	unsigned int word = port / 64;
 
-	if (tb[RTA_OIF]) {
-		if (iswan(ll_index_to_name(*(int *) RTA_DATA(tb[RTA_OIF])))) {
-		} else {
-			return 0;
-		}
-	}
+	if (word == 0)
+		head->ports &= ~(1ULL << port);
+	else if (word <= head->ports_ext_words)
+		head->ports_ext[word - 1] &= ~(1ULL << (port % 64));
+}
 
-	if (tb[RTA_DST]) {
-		if (r->rtm_dst_len != host_len) {
-			syslog(LOG_INFO, "%s/%u ", rt_addr_n2a(r->rtm_family,
-							       RTA_DATA(tb[RTA_DST]), abuf, sizeof (abuf)),
-			       r->rtm_dst_len);
-		} else {
-			syslog(LOG_INFO, "%s ", (char *) format_host(r->rtm_family,
-								     RTA_PAYLOAD(tb[RTA_DST]),
-								     RTA_DATA(tb[RTA_DST]), abuf, sizeof (abuf))
-			    );
-		}
-	} else if (r->rtm_dst_len) {
-		syslog(LOG_INFO, "0/%d ", r->rtm_dst_len);
-	} else {
-		syslog(LOG_INFO, "default ");
-	}
+/**
+ * @brief determines if another member of the group is on the port of a member
+ * @details members are hashed by group and port, so the other members of the group on
+ * @details the port are in the same bucket - no per group port counters are kept
+ * @returns 1 if so 0 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcg_port_shared(struct mcg_br_head_t *head, struct mcg_br_mdb_entry_t *mcge)
+{
+	struct list_head *pos;
+	struct mcg_br_mdb_entry_t *other;
 
-	if (tb[RTA_SRC]) {
-		if (r->rtm_src_len != host_len) {
-			syslog(LOG_INFO, "from %s/%u ", rt_addr_n2a(r->rtm_family,
-								    RTA_DATA(tb[RTA_SRC]),
-								    abuf, sizeof (abuf)), r->rtm_src_len);
-		} else {
-			syslog(LOG_INFO, "from %s ", (char *) format_host(r->rtm_family,
-									  RTA_PAYLOAD(tb[RTA_SRC]),
-									  RTA_DATA(tb[RTA_SRC]), abuf, sizeof (abuf))
-			    );
-		}
-	} else if (r->rtm_src_len) {
-		syslog(LOG_INFO, "from 0/%u ", r->rtm_src_len);
+	list_for_each(pos, &mcastpa.mbr_hash[mcg_hash_member(head, mcge->ifindex)]) {
+		other = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mbr_hash);
+		if ((other != mcge) && (other->head == head) && (other->ifindex == mcge->ifindex))
+			return (1);
 	}
+	return (0);
+}
 
-	if (tb[RTA_GATEWAY]) {
-		syslog(LOG_INFO, "via %s ",
-		       (char *) format_host(r->rtm_family,
-					    RTA_PAYLOAD(tb[RTA_GATEWAY]),
-					    RTA_DATA(tb[RTA_GATEWAY]), abuf, sizeof (abuf)));
+/**
+ * @brief adds a member to the port set of its group
+ * @details the group keeps the numbering of the bridge it had with its first member, so
+ * @details the set stays valid if later events for the group come from another bridge
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline void
+mcg_port_add(struct mcg_br_head_t *head, struct mcg_br_mdb_entry_t *mcge)
+{
+	if (head->brp == NULL)
+		head->brp = mcast_br_ports_get(head->br_ifindex);
+	mcge->port = (head->brp != NULL) ? mcg_port_get(head->brp, mcge->ifindex) : MCAST_PORT_NONE;
+	if ((mcge->port != MCAST_PORT_NONE) && (mcg_head_port_set(head, mcge->port) < 0)) {
+		head->brp->members[mcge->port]--;
+		mcge->port = MCAST_PORT_NONE;
+		mcastpa.port_full++;
 	}
+}
 
-	if (tb[RTA_OIF]) {
-		syslog(LOG_INFO, "dev %s ", ll_index_to_name(*(int *) RTA_DATA(tb[RTA_OIF])));
-	}
+/**
+ * @brief removes a member from the port set of its group
+ * @details the port leaves the set with its last member in the group
+ * @note called before the member leaves the member hash
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline void
+mcg_port_del(struct mcg_br_head_t *head, struct mcg_br_mdb_entry_t *mcge)
+{
+	if (mcge->port == MCAST_PORT_NONE)
+		return;
+	head->brp->members[mcge->port]--;
+	if (!mcg_port_shared(head, mcge))
+		mcg_head_port_clear(head, mcge->port);
+}
 
-	if (tb[RTA_PREFSRC]) {
-		char address[INET_ADDR_SIZE] = { 0 };
-		struct mcast_ip_entry_t *p_mcast_ip_entry = NULL;
-		/* Do not use format_host(). It is our local addr
-		   and symbolic name will not be useful.
-		 */
-		syslog(LOG_INFO, " src %s ",
-		       (char *) rt_addr_n2a(r->rtm_family, RTA_DATA(tb[RTA_PREFSRC]), abuf, sizeof (abuf)));
-		sprintf(address, (char *) rt_addr_n2a(r->rtm_family, RTA_DATA(tb[RTA_PREFSRC]), abuf, sizeof (abuf)));
+/**
+ * @brief get a mdb entry from the mc group list head list of attached group entries
+ * @details compares br_mdb_entries 
+ * @returns pointer to entry or null
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+struct mcg_br_mdb_entry_t *
+mcg_br_entry_get(struct mcg_br_head_t *head, struct br_mdb_entry *e)
+{
+	struct list_head *pos;
+	struct list_head *bucket;
+	struct mcg_br_mdb_entry_t *mcge;
 
-		p_mcast_ip_entry = mcast_ip_entry_get(address);
-		if (p_mcast_ip_entry == NULL) {
-			mcast_ip_entry_add(address);
-		}
-	}
-	if (tb[RTA_PRIORITY])
-		syslog(LOG_INFO, " metric %u ", rta_getattr_u32(tb[RTA_PRIORITY]));
-	if (r->rtm_flags & RTNH_F_DEAD)
-		syslog(LOG_INFO, "dead ");
-	if (r->rtm_flags & RTNH_F_ONLINK)
-		syslog(LOG_INFO, "onlink ");
-	if (r->rtm_flags & RTNH_F_PERVASIVE)
-		syslog(LOG_INFO, "pervasive ");
-	if (r->rtm_flags & RTM_F_NOTIFY)
-		syslog(LOG_INFO, "notify ");
-	if (tb[RTA_MARK]) {
-		unsigned int mark = *(unsigned int *) RTA_DATA(tb[RTA_MARK]);
-		if (mark) {
-			if (mark >= 16)
-				syslog(LOG_INFO, " mark 0x%x", mark);
-			else
-				syslog(LOG_INFO, " mark %u", mark);
+	bucket = &mcastpa.mbr_hash[mcg_hash_member(head, e->ifindex)];
+	list_for_each(pos, bucket) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mbr_hash);
+		if (mcge->head != head)
+			continue;
+		if (mcge->ifindex != e->ifindex)
+			continue;
+		if (memcmp(mcge->srcmac, e->src_addr.eth_addr, ETH_ALEN) == 0) {
+			return (mcge);
 		}
 	}
+	return (NULL);
+}
 
-	if ((r->rtm_flags & RTM_F_CLONED) && r->rtm_family == AF_INET) {
-		__u32 flags = r->rtm_flags & ~0xFFFF;
-		int first = 1;
-
-		syslog(LOG_INFO, "%s    cache ", _SL_);
-
-#define PRTFL(fl,flname) if (flags&RTCF_##fl) { \
-  flags &= ~RTCF_##fl; \
-  syslog (LOG_INFO,"%s" flname "%s", first ? "<" : "", flags ? "," : "> "); \
-  first = 0; }
-		PRTFL(LOCAL, "local");
-		PRTFL(REJECT, "reject");
-		PRTFL(MULTICAST, "mc");
-		PRTFL(BROADCAST, "brd");
-		PRTFL(DNAT, "dst-nat");
-		PRTFL(SNAT, "src-nat");
-		PRTFL(MASQ, "masq");
-		PRTFL(DIRECTDST, "dst-direct");
-		PRTFL(DIRECTSRC, "src-direct");
-		PRTFL(REDIRECTED, "redirected");
-		PRTFL(DOREDIRECT, "redirect");
-		PRTFL(FAST, "fastroute");
-		PRTFL(NOTIFY, "notify");
-		PRTFL(TPROXY, "proxy");
-
-		if (flags)
-			syslog(LOG_INFO, "%s%x> ", first ? "<" : "", flags);
-		if (tb[RTA_CACHEINFO]) {
-			struct rta_cacheinfo *ci = RTA_DATA(tb[RTA_CACHEINFO]);
-			if (ci->rta_expires != 0)
-				syslog(LOG_INFO, " expires %dsec", ci->rta_expires / hz);
-			if (ci->rta_error != 0)
-				syslog(LOG_INFO, " error %d", ci->rta_error);
-			if (ci->rta_id)
-				syslog(LOG_INFO, " ipid 0x%04x", ci->rta_id);
-			if (ci->rta_ts || ci->rta_tsage)
-				syslog(LOG_INFO, " ts 0x%x tsage %dsec", ci->rta_ts, ci->rta_tsage);
-		}
-	} else if (r->rtm_family == AF_INET6) {
-		struct rta_cacheinfo *ci = NULL;
-		if (tb[RTA_CACHEINFO])
-			ci = RTA_DATA(tb[RTA_CACHEINFO]);
-		if ((r->rtm_flags & RTM_F_CLONED) || (ci && ci->rta_expires)) {
-			if (r->rtm_flags & RTM_F_CLONED)
-				syslog(LOG_INFO, "%s    cache ", _SL_);
-			if (ci->rta_expires)
-				syslog(LOG_INFO, " expires %dsec", ci->rta_expires / hz);
-			if (ci->rta_error != 0)
-				syslog(LOG_INFO, " error %d", ci->rta_error);
-		} else if (ci) {
-			if (ci->rta_error != 0)
-				syslog(LOG_INFO, " error %d", ci->rta_error);
-		}
+/**
+ * @brief add a bridge mdb entry to the mc group list head list
+ * @details subordinate members of group
+ * @returns pointer to entry or null
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+struct mcg_br_mdb_entry_t *
+mcg_br_entry_add(struct mcg_br_head_t *head, struct br_mdb_entry *e)
+{
+	struct mcg_br_mdb_entry_t *p_mcg_br_mdb_entry;
+	p_mcg_br_mdb_entry = (struct mcg_br_mdb_entry_t *) mcast_pool_alloc(&mcastpa.mbr_pool);
+	if (p_mcg_br_mdb_entry == NULL) {
+		return (NULL);
 	}
-	if (tb[RTA_METRICS]) {
-		int i;
-		unsigned mxlock = 0;
-		struct rtattr *mxrta[RTAX_MAX + 1];
-
-		parse_rtattr(mxrta, RTAX_MAX, RTA_DATA(tb[RTA_METRICS]), RTA_PAYLOAD(tb[RTA_METRICS]));
-		if (mxrta[RTAX_LOCK])
-			mxlock = *(unsigned *) RTA_DATA(mxrta[RTAX_LOCK]);
-
-		for (i = 2; i <= RTAX_MAX; i++) {
-			__u32 val;
-
-			if (mxrta[i] == NULL)
-				continue;
-
-			if (i < sizeof (mx_names) / sizeof (char *) && mx_names[i])
-				syslog(LOG_INFO, " %s", mx_names[i]);
-			else
-				syslog(LOG_INFO, " metric %d", i);
-
-			if (mxlock & (1 << i))
-				syslog(LOG_INFO, " lock");
-
-			val = rta_getattr_u32(mxrta[i]);
-
-			switch (i) {
-			case RTAX_FEATURES:
-				print_rtax_features(NULL, val);
-				break;
-			case RTAX_HOPLIMIT:
-				if ((int) val == -1)
-					val = 0;
-				/* fall through */
-			default:
-				syslog(LOG_INFO, " %u", val);
-				break;
+	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->mcg_entry);
+	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->mbr_hash);
+	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->port_hash);
+	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->mac_hash);
+	INIT_LIST_HEAD(&p_mcg_br_mdb_entry->cap_wait);
+	p_mcg_br_mdb_entry->ifindex = e->ifindex;
+	memcpy(p_mcg_br_mdb_entry->srcmac, e->src_addr.eth_addr, ETH_ALEN);
+	p_mcg_br_mdb_entry->head = head;
+	mcg_port_add(head, p_mcg_br_mdb_entry);
+	list_add(&p_mcg_br_mdb_entry->mcg_entry, &head->mcg_entry);
+	list_add(&p_mcg_br_mdb_entry->mbr_hash, &mcastpa.mbr_hash[mcg_hash_member(head, e->ifindex)]);
+	list_add(&p_mcg_br_mdb_entry->port_hash, &mcastpa.port_hash[mcg_hash_port(e->ifindex)]);
+	list_add(&p_mcg_br_mdb_entry->mac_hash, &mcastpa.mac_hash[mcg_hash_mac(e->src_addr.eth_addr)]);
+	mcg_trace(MT_MBR_ADD, head, e->ifindex, e->src_addr.eth_addr, 0);
+	return (p_mcg_br_mdb_entry);
+}
 
-			case RTAX_RTT:
-			case RTAX_RTTVAR:
-			case RTAX_RTO_MIN:
-				if (i == RTAX_RTT)
-					val /= 8;
-				else if (i == RTAX_RTTVAR)
-					val /= 4;
-
-				if (val >= 1000)
-					syslog(LOG_INFO, " %gs", val / 1e3);
-				else
-					syslog(LOG_INFO, " %ums", val);
-				break;
-			}
-		}
-	}
-	if (tb[RTA_IIF]) {
-		syslog(LOG_INFO, " iif %s", ll_index_to_name(*(int *) RTA_DATA(tb[RTA_IIF])));
+/**
+ * @brief add a bridge mdb entry to the mc group list head
+ * @details initial instance of a group
+ * @returns pointer to entry or null
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+struct mcg_br_head_t *
+mcg_br_entry_head_add(struct br_mdb_entry *e)
+{
+	struct mcg_br_head_t *p_mcg_br_head;
+	p_mcg_br_head = (struct mcg_br_head_t *) mcast_pool_alloc(&mcastpa.head_pool);
+	if (p_mcg_br_head == NULL) {
+		return (NULL);
 	}
-	if (tb[RTA_MULTIPATH]) {
-		struct rtnexthop *nh = RTA_DATA(tb[RTA_MULTIPATH]);
-		int first = 0;
 
-		len = RTA_PAYLOAD(tb[RTA_MULTIPATH]);
-
-		for (;;) {
-			if (len < sizeof (*nh))
-				break;
-			if (nh->rtnh_len > len)
-				break;
-			if (r->rtm_flags & RTM_F_CLONED && r->rtm_type == RTN_MULTICAST) {
-				if (first)
-					syslog(LOG_INFO, " Oifs:");
-				else
-					syslog(LOG_INFO, " ");
-			} else
-				syslog(LOG_INFO, "%s\tnexthop", _SL_);
-			if (nh->rtnh_len > sizeof (*nh)) {
-				parse_rtattr(tb, RTA_MAX, RTNH_DATA(nh), nh->rtnh_len - sizeof (*nh));
-				if (tb[RTA_GATEWAY]) {
-					syslog(LOG_INFO, " via %s ",
-					       format_host(r->rtm_family,
-							   RTA_PAYLOAD(tb[RTA_GATEWAY]),
-							   RTA_DATA(tb[RTA_GATEWAY]), abuf, sizeof (abuf)));
-				}
-			}
-			if (r->rtm_flags & RTM_F_CLONED && r->rtm_type == RTN_MULTICAST) {
-				syslog(LOG_INFO, " %s", (char *) ll_index_to_name(nh->rtnh_ifindex));
-				if (nh->rtnh_hops != 1)
-					syslog(LOG_INFO, "(ttl>%d)", nh->rtnh_hops);
-			} else {
-				syslog(LOG_INFO, " dev %s", (char *) ll_index_to_name(nh->rtnh_ifindex));
-				syslog(LOG_INFO, " weight %d", nh->rtnh_hops + 1);
-			}
-			if (nh->rtnh_flags & RTNH_F_DEAD)
-				syslog(LOG_INFO, " dead");
-			if (nh->rtnh_flags & RTNH_F_ONLINK)
-				syslog(LOG_INFO, " onlink");
-			if (nh->rtnh_flags & RTNH_F_PERVASIVE)
-				syslog(LOG_INFO, " pervasive");
-			len -= NLMSG_ALIGN(nh->rtnh_len);
-			nh = RTNH_NEXT(nh);
-		}
-	}
-	syslog(LOG_INFO, "\n");
-	return 0;
+	INIT_LIST_HEAD(&p_mcg_br_head->mcg_head);
+	INIT_LIST_HEAD(&p_mcg_br_head->mcg_entry);
+	INIT_LIST_HEAD(&p_mcg_br_head->mcg_hash);
+	memcpy(&p_mcg_br_head->addr.u, &e->addr.u, sizeof (p_mcg_br_head->addr.u));
+	p_mcg_br_head->addr.proto = e->addr.proto;
+	p_mcg_br_head->ifindex = e->ifindex;
+	list_add(&p_mcg_br_head->mcg_head, &mcastpa.mcg_head);
+	list_add(&p_mcg_br_head->mcg_hash, &mcastpa.mcg_hash[mcg_hash_addr(e->addr.proto, &e->addr.u)]);
+	mcg_trace(MT_HEAD_ADD, p_mcg_br_head, e->ifindex, NULL, 0);
+	return (p_mcg_br_head);
 }
 
 /**
- * @brief  initialize our wan route knowledge
- * @details
+ * @brief delete a bridge mdb entry from the mc group list head
+ * @details removes instance of a group from the group list and its hash bucket
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-static int
-iproute_parse_init(void)
+int
+mcg_br_entry_head_del(struct mcg_br_head_t *head)
 {
+	if (head == NULL)
+		return (-ENOENT);
+	mcg_trace(MT_HEAD_DEL, head, head->ifindex, NULL, 0);
+	list_del(&head->mcg_head);
+	list_del(&head->mcg_hash);
+	free(head->ports_ext);
+	mcast_pool_free(&mcastpa.head_pool, head);
+	return (0);
+}
 
-	if (rtnl_wilddump_request(&rth, AF_INET, RTM_GETROUTE) < 0) {
-		syslog(LOG_INFO, "Cannot send dump request\n");
-		return 1;
-	}
-
-	if (rtnl_dump_filter(&rth, parse_route, stdout) < 0) {
-		syslog(LOG_INFO, "Dump terminated\n");
-		return 1;
-	}
-	return 0;
+/**
+ * @brief determines if the backend has room for another join
+ * @details flows it accepted plus requests on their way to it
+ * @returns 1 if room 0 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline int
+mcg_capacity_room(void)
+{
+	return ((mcastpa.pa->capacity == 0) ||
+		(mcastpa.shadow_pool.used + mcast_pq_depth(&mcastpa.pq) < mcastpa.pa->capacity));
 }
 
-static inline char *
-cache_mdb_entry_srcmac(struct br_mdb_entry *e)
+/**
+ * @brief takes a member off the capacity wait list
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline void
+mcg_capacity_unwait(struct mcg_br_mdb_entry_t *mcge)
 {
-	SPRINT_BUF(abuf);
-	int i;
-	int len = 0;
-	for (i = 0; i < ETH_ALEN; i++) {
-		if (i < (ETH_ALEN - 1)) {
-			len += sprintf(abuf + len, "%02X:", e->src_addr.eth_addr[i]);
-		} else {
-			len += sprintf(abuf + len, "%02X", e->src_addr.eth_addr[i]);
-		}
-	}
-	return (abuf);
+	if (list_empty(&mcge->cap_wait))
+		return;
+	list_del_init(&mcge->cap_wait);
+	mcastpa.capacity_waiting--;
 }
 
+/**
+ * @brief marks a member as refused by the accelerator
+ * @details starts the software time of its group with the first such member
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
 static void
-cache_mdb_entry(struct nlmsghdr *n, int ifindex, struct br_mdb_entry *e)
+mcg_sw_enter(struct mcg_br_mdb_entry_t *mcge)
 {
-	SPRINT_BUF(abuf);
-	struct mcg_br_mdb_entry_t *head;
-	struct mcg_br_mdb_entry_t *mcge;
-
-	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
-
-	if (e->state & MDB_PERMANENT)
+	if (mcge->retries)
 		return;
-
-	if (iswifi((char *) ll_index_to_name(e->ifindex))) {
-		if (mcastpa.params.nowifi) {
-			return;
-		}
-	}
-
-	if (e->addr.proto == htons(ETH_P_IP)) {
-		if (inet_ntop(AF_INET, &e->addr.u.ip4, abuf, sizeof (abuf))) {
-
-			if ((n->nlmsg_type == RTM_NEWMDB) || (n->nlmsg_type == RTM_GETMDB)) {
-
-				syslog(LOG_NOTICE, "RTM_NEWMDB dev %s port %s grp %s srcmac %s\n",
-				       (char *) ll_index_to_name(ifindex), (char *) ll_index_to_name(e->ifindex), abuf,
-				       cache_mdb_entry_srcmac(e));
-
-				head = mcg_br_entry_head_get(e);
-				if (head == NULL) {
-					head = mcg_br_entry_head_add(e);
-				}
-				if (head != NULL) {
-					head->br_ifindex = ifindex;
-					mcge = mcg_br_entry_get(head, e);
-					if (mcge == NULL) {
-						mcge = mcg_br_entry_add(head, e);
-					}
-					if (mcge != NULL) {
-						mcge->br_ifindex = ifindex;
-					}
-					mcg_br_entry_join(head);
-				} else {
-				}
-			}
-			if (n->nlmsg_type == RTM_DELMDB) {
-
-				syslog(LOG_NOTICE, "RTM_DELMDB dev %s port %s grp %s srcmac %s\n",
-				       (char *) ll_index_to_name(ifindex), (char *) ll_index_to_name(e->ifindex), abuf,
-				       cache_mdb_entry_srcmac(e));
-
-				head = mcg_br_entry_head_get(e);
-				if (head == NULL) {
-					syslog(LOG_INFO, "RTM_DELMDB head is NULL\n");
-					return;
-				}
-				mcge = mcg_br_entry_get(head, e);
-				if (mcge == NULL) {
-					syslog(LOG_INFO, "RTM_DELMDB mcge is NULL\n");
-					return;
-				}
-				mcg_br_entry_leave(head, e);
-				if (list_empty(&head->mcg_entry)) {
-					mcg_br_entry_head_del(head);
-				}
-			}
-		}
-	} else {
-		if (inet_ntop(AF_INET, &e->addr.u.ip6, abuf, sizeof (abuf))) {
-			syslog(LOG_INFO, "dev %s port %s grp %s \n", (char *) ll_index_to_name(ifindex),
-			       (char *) ll_index_to_name(e->ifindex),
-			       inet_ntop(AF_INET6, &e->addr.u.ip6, abuf, sizeof (abuf)));
-		}
-	}
+	mcastpa.snap_dirty = 1;
+	mcge->retries = 1;
+	if (mcge->head->sw_members++ == 0)
+		clock_gettime(CLOCK_MONOTONIC, &mcge->head->sw_since);
 }
 
 /**
- * @brief parses mdb_entry - may contain mulitiples and calls cache function 
- * @details checks for bridge membership and not wan interface
- * @note We saw Cspire join on wan interface
- * @note ifindex is bridge ifindex
- * @todo we only look for one wan interface.  
- * @todo what about guest bridge -  need to check for that
+ * @brief marks a member as accelerated or gone
+ * @details stops the software time of its group with the last such member
+ * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
 static void
-parse_br_mdb_entry(struct nlmsghdr *n, int ifindex, struct rtattr *attr)
+mcg_sw_leave(struct mcg_br_mdb_entry_t *mcge)
 {
-	struct rtattr *i;
-	int rem;
-	struct br_mdb_entry *e;
-
-	syslog(LOG_INFO, "%s:%d bridge %s\n", __FUNCTION__, __LINE__, (char *) ll_index_to_name(ifindex));
+	struct mcg_br_head_t *head = mcge->head;
+	struct timespec now;
+	uint64_t ms;
 
-	rem = RTA_PAYLOAD(attr);
-	for (i = RTA_DATA(attr); RTA_OK(i, rem); i = RTA_NEXT(i, rem)) {
-		e = RTA_DATA(i);
-		if (mcastpa.params.wan_ifindex == ifindex) {
-			syslog(LOG_INFO, "%s:%d ignoring join on wan interface\n", __FUNCTION__, __LINE__);
-			continue;
-		}
-		if (mcastpa.params.bridged) {
-			if (ifindex == ll_name_to_index(mcastpa.params.bridge_name)) {
-				cache_mdb_entry(n, ifindex, e);
-			} else {
-				syslog(LOG_INFO, "%s:%d bridge %s mismatch %s\n", __FUNCTION__, __LINE__,
-				       (char *) ll_index_to_name(ifindex), mcastpa.params.bridge_name);
-			}
-		} else {
-			cache_mdb_entry(n, ifindex, e);
-		}
-	}
+	if (mcge->retries == 0)
+		return;
+	mcastpa.snap_dirty = 1;
+	mcge->retries = 0;
+	if (--head->sw_members > 0)
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (now.tv_sec - head->sw_since.tv_sec) * 1000 + (now.tv_nsec - head->sw_since.tv_nsec) / 1000000;
+	head->sw_ms += ms;
+	mcastpa.sw_ms_total += ms;
 }
 
-int
-parse_mdb(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+/**
+ * @brief sets whether a member is programmed in the accelerator
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline void
+mcg_br_entry_joined_set(struct mcg_br_mdb_entry_t *mcge, int joined)
 {
-	struct br_port_msg *r = NLMSG_DATA(n);
-	int len = n->nlmsg_len;
-	struct rtattr *tb[MDBA_MAX + 1];
-
-	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
-
-	if (n->nlmsg_type != RTM_GETMDB && n->nlmsg_type != RTM_NEWMDB && n->nlmsg_type != RTM_DELMDB) {
-		syslog(LOG_INFO, "Not RTM_GETMDB, RTM_NEWMDB or RTM_DELMDB: %08x %08x %08x\n",
-		       n->nlmsg_len, n->nlmsg_type, n->nlmsg_flags);
+	mcge->head->joined_members += joined - mcge->joined;
+	mcge->joined = joined;
+	mcastpa.snap_dirty = 1;
+}
 
-		return 0;
-	}
+/**
+ * @brief unlinks a group member from its head and all member indexes and frees it
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_br_entry_free(struct mcg_br_mdb_entry_t *mcge)
+{
+	mcg_trace(MT_MBR_DEL, mcge->head, mcge->ifindex, mcge->srcmac, 0);
+	mcg_sw_leave(mcge);
+	mcge->head->joined_members -= mcge->joined;
+	mcg_port_del(mcge->head, mcge);
+	mcg_capacity_unwait(mcge);
+	list_del(&mcge->mcg_entry);
+	list_del(&mcge->mbr_hash);
+	list_del(&mcge->port_hash);
+	list_del(&mcge->mac_hash);
+	mcast_pool_free(&mcastpa.mbr_pool, mcge);
+}
 
-	len -= NLMSG_LENGTH(sizeof (*r));
-	if (len < 0) {
-		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
-		return -1;
-	}
+/**
+ * @brief delete a bridge mdb entry from the mc group list head list
+ * @details removes instance of a group as a sub of the group head
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcg_br_entry_del(struct mcg_br_head_t *head, struct br_mdb_entry *e)
+{
+	struct mcg_br_mdb_entry_t *mcge;
 
-	parse_rtattr(tb, MDBA_MAX, MDBA_RTA(r), n->nlmsg_len - NLMSG_LENGTH(sizeof (*r)));
+	mcge = mcg_br_entry_get(head, e);
+	if (mcge == NULL)
+		return (-ENOENT);
+	mcg_br_entry_free(mcge);
+	return (0);
+}
 
-	if (tb[MDBA_MDB]) {
-		struct rtattr *i;
-		int rem = RTA_PAYLOAD(tb[MDBA_MDB]);
+/**
+ * @brief delete all bridge mdb entries from the mc group list head list
+ * @details removes all subordinate members of a group - the head itself is kept
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcg_br_entry_head_del_all(struct mcg_br_head_t *head)
+{
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcg_br_mdb_entry_t *mcge;
 
-		for (i = RTA_DATA(tb[MDBA_MDB]); RTA_OK(i, rem); i = RTA_NEXT(i, rem))
-			parse_br_mdb_entry(n, r->ifindex, i);
+	list_for_each_safe(pos, q, &head->mcg_entry) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
+		mcg_br_entry_free(mcge);
 	}
-
-	return 0;
 }
 
+/**
+ * @brief traverses all head groups, removes all sub entries issues leave and deletes head
+ * @details calls leave for head group
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
 int
-do_mroute(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+mcg_br_entry_head_list_del_all(void)
 {
-	struct rtmsg *r = NLMSG_DATA(n);
-	int len = n->nlmsg_len;
-	struct rtattr *tb[RTA_MAX + 1];
-	char abuf[256];
-	int iif = 0;
-	int family;
-	int delete = 0;
-	char this_address[128] = { 0 };
-	char group_address[128] = { 0 };
-	struct mcg_br_mdb_entry_t *head;
-
-	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
-
-	if ((n->nlmsg_type != RTM_NEWROUTE && n->nlmsg_type != RTM_DELROUTE) || !(n->nlmsg_flags & NLM_F_MULTI)) {
-//              syslog (LOG_INFO,"Not a multicast route: %08x %08x %08x\n", n->nlmsg_len, n->nlmsg_type, n->nlmsg_flags);
-//              return 0;
-	}
-	len -= NLMSG_LENGTH(sizeof (*r));
-	if (len < 0) {
-		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
-		return -1;
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcg_br_head_t *head;
+	list_for_each_safe(pos, q, &mcastpa.mcg_head) {
+		head = (struct mcg_br_head_t *) list_entry(pos, struct mcg_br_head_t, mcg_head);
+		mcg_br_entry_leave(head, NULL);
+		mcg_br_entry_head_del(head);
 	}
+	return (0);
+}
 
-	if (r->rtm_type != RTN_MULTICAST) {
-		return 0;
-	}
+/**
+ * @brief sets src mac in mjl struct
+ * @details uses part of ipv6 union - this is supported by a bridge patch
+ * @todo someday get a really clean way of doing this
+ * @note done to support Intel wifi mc which requires source of video subscriber
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcg_br_entry_srcmac_set(struct mcg_br_mdb_entry_t *mcge, struct mcastpa_join_leave_t *mjl)
+{
+	memcpy(mjl->srcmac, mcge->srcmac, ETH_ALEN);
+}
 
-	parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+/**
+ * @brief fills the binary join leave request common to all members of a group
+ * @details group, video source, wan and the set of lan ports
+ * @details O(1) - the port set and the joined count are maintained by member add, free and join
+ * @returns 0 if OK -ENOENT if not ready - no video src
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcg_br_entry_mjl_init(struct mcg_br_head_t *head, struct mcastpa_join_leave_t *mjl)
+{
+	memset(mjl, 0, sizeof (struct mcastpa_join_leave_t));
+	mjl->version = MCASTPA_JL_VERSION;
 
-	if (tb[RTA_IIF]) {
-		iif = *(int *) RTA_DATA(tb[RTA_IIF]);
-		if (!iswan((char *) ll_index_to_name(iif))) {
-			return 0;
-		}
+	if (mcastpa.params.bridged) {
+		mjl->flags |= MJL_FLAG_BRIDGE;
 	} else {
-		return 0;
-	}
-
-	family = r->rtm_family == RTNL_FAMILY_IPMR ? AF_INET : AF_INET6;
-
-	if (tb[RTA_SRC]) {
-		len =
-		    snprintf(this_address, sizeof (this_address), "%s",
-			     (char *) rt_addr_n2a(family, RTA_DATA(tb[RTA_SRC]), abuf, sizeof (abuf)));
-		if (islocaladdr(this_address)) {
-			return 0;
+		if (mcastpa.params.use_src == 0) {
+			if (head->src.family == AF_UNSPEC) {
+				return (-ENOENT);	/* not ready to join - no video src */
+			}
+			mjl->srcip = head->src;
 		} else {
+			mjl->srcip = mcastpa.params.src_addr;
 		}
-	} else {
-		return 0;
-	}
-
-	if (n->nlmsg_type == RTM_DELROUTE) {
-		delete = 1;
-	}
-
-	if (tb[RTA_DST]) {
-		len =
-		    snprintf(group_address, sizeof (group_address), "%s",
-			     (char *) rt_addr_n2a(family, RTA_DATA(tb[RTA_DST]), abuf, sizeof (abuf)));
-	} else {
-		return 0;
+		mjl->flags |= MJL_FLAG_SRCIP;
 	}
 
-	if (delete) {
-		head = mcg_br_entry_head_get_from_group(group_address);
-		if (head != NULL) {
-			syslog(LOG_INFO, "%s:%d not deleteing mc group %s from %s head not found\n", __FUNCTION__,
-			       __LINE__, group_address, this_address);
-#if 0
-
-			// routes get deleted and added every few minutes so we loose ppa flows
-
-			mcg_br_entry_head_del_all(head);
-			mcg_br_entry_leave(head, NULL);
-			mcg_br_entry_head_del(head);
-#endif
-		} else {
-			syslog(LOG_INFO, "%s:%d mc group %s from %s head not found\n", __FUNCTION__, __LINE__,
-			       group_address, this_address);
-		}
+	if (head->addr.proto == htons(ETH_P_IP)) {
+		mjl->group.family = AF_INET;
+		mjl->group.u.ip4.s_addr = head->addr.u.ip4;
 	} else {
-		syslog(LOG_INFO, "%s:%d mc group %s from %s\n", __FUNCTION__, __LINE__, group_address, this_address);
-		head = mcg_br_entry_head_get_from_group(group_address);
-		if (head != NULL) {
-			if (head->src[0] == 0) {
-				strcpy(head->src, this_address);
-				head->wan_ifindex = iif;
-				mcg_br_entry_join(head);
-				syslog(LOG_INFO, "%s:%d mc group %s from %s added to head\n", __FUNCTION__, __LINE__,
-				       group_address, head->src);
-			} else {
-				syslog(LOG_INFO, "%s:%d mc group %s from %s was not installed because %s exist \n",
-				       __FUNCTION__, __LINE__, group_address, this_address, head->src);
-			}
-		} else {
-		}
+		mjl->group.family = AF_INET6;
+		mjl->group.u.ip6 = head->addr.u.ip6;
 	}
-	return 0;
+	mjl->wan_ifindex = mcastpa.params.wan_ifindex;
+	mjl->br_ifindex = (head->brp != NULL) ? head->brp->br_ifindex : head->br_ifindex;
+
+	/* kept up to date as members come and go - no walk of the members */
+	if (!list_empty(&head->mcg_entry))
+		mjl->flags |= MJL_FLAG_LAN;
+	if (head->joined_members && (mcastpa.pa->caps & MCAST_PA_CAP_UPDATE))
+		mjl->flags |= MJL_FLAG_UPDATE;	/* at least one member has been joined already */
+	mjl->lan.bits[0] = head->ports;
+	if (head->ports_ext_words)
+		memcpy(&mjl->lan.bits[1], head->ports_ext, head->ports_ext_words * sizeof (uint64_t));
+	return (0);
 }
 
+/**
+ * @brief schedules a failed driver request to be sent again
+ * @details exponential backoff from RETRY_BASE_MS
+ * @returns 0 if OK -ENOMEM if the retry list is full
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
 static int
-do_monitor_msg(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+mcg_retry_add(int op, struct mcastpa_join_leave_t *mjl, unsigned int attempt)
 {
-	struct rtmsg *r = NLMSG_DATA(n);
-
-	switch (n->nlmsg_type) {
-	case RTM_NEWMDB:
-		syslog(LOG_INFO, "%s:%d NEWMDB\n", __FUNCTION__, __LINE__);
-		parse_mdb(who, n, arg);
-		break;
-	case RTM_DELMDB:
-		syslog(LOG_INFO, "%s:%d DELMDB\n", __FUNCTION__, __LINE__);
-		parse_mdb(who, n, arg);
-		break;
-	case RTM_NEWROUTE:
-		if (r->rtm_type == RTN_MULTICAST) {
-			syslog(LOG_INFO, "%s:%d NEWMCROUTE\n", __FUNCTION__, __LINE__);
-			do_mroute(who, n, arg);
-		} else {
-			syslog(LOG_INFO, "%s:%d NEWROUTE\n", __FUNCTION__, __LINE__);
-			parse_route(who, n, arg);
-		}
-		break;
-	case RTM_DELROUTE:
-		if (r->rtm_type == RTN_MULTICAST) {
-			syslog(LOG_INFO, "%s:%d DELMCROUTE\n", __FUNCTION__, __LINE__);
-			do_mroute(who, n, arg);
-		} else {
-			parse_route(who, n, arg);
-			syslog(LOG_INFO, "%s:%d DELROUTE\n", __FUNCTION__, __LINE__);
-		}
-		break;
-	default:
-		syslog(LOG_INFO, "do_monitor: nlmmsg_type unknown %u\n", n->nlmsg_type);
-		break;
+	struct mcg_retry_t *retry;
+	unsigned int ms;
+
+	retry = (struct mcg_retry_t *) mcast_pool_alloc(&mcastpa.retry_pool);
+	if (retry == NULL)
+		return (-ENOMEM);
+	ms = RETRY_BASE_MS << (attempt > 7 ? 7 : (attempt ? attempt - 1 : 0));
+	if (ms > RETRY_MAX_MS)
+		ms = RETRY_MAX_MS;
+	retry->op = op;
+	retry->attempt = attempt;
+	memcpy(&retry->mjl, mjl, sizeof (struct mcastpa_join_leave_t));
+	clock_gettime(CLOCK_MONOTONIC, &retry->due);
+	retry->due.tv_sec += ms / 1000;
+	retry->due.tv_nsec += (ms % 1000) * 1000000L;
+	if (retry->due.tv_nsec >= 1000000000L) {
+		retry->due.tv_sec++;
+		retry->due.tv_nsec -= 1000000000L;
 	}
+	list_add_tail(&retry->list, &mcastpa.retry_list);
 	return (0);
 }
 
 /**
- * @brief  initialize our wan mroute knowledge
- * @details
+ * @brief queues a driver request for a member
+ * @details stamps the member and the request with a new sequence number so results of older
+ * @details requests for the member are recognized - mcge may be NULL for a flow with no member
+ * @returns mcast_pq_put() result
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
 static int
-mroute_parse_init(void)
+mcg_pq_put(int op, struct mcastpa_join_leave_t *mjl, struct mcg_br_mdb_entry_t *mcge, unsigned int attempt)
 {
+	unsigned int seq = 0;
 
-	if (rtnl_wilddump_request(&rth, AF_INET, RTM_GETROUTE) < 0) {
-		syslog(LOG_INFO, "Cannot send dump request\n");
-		return 1;
-	}
-
-	if (rtnl_dump_filter(&rth, do_mroute, stdout) < 0) {
-		syslog(LOG_INFO, "Dump terminated\n");
-		return 1;
+	if (mcge != NULL) {
+		seq = ++mcastpa.req_seq;
+		mcge->seq = seq;
 	}
-	return 0;
+	return (mcast_pq_put(&mcastpa.pq, op, mjl, attempt, seq));
 }
 
 /**
- * @brief sets br-video to be a virtual router port 
- * @details
+ * @brief joins a new group
+ * @details calls hw specific pa_join() - ipv4 (IGMP) and ipv6 (MLD) groups alike
  * @note
  * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
  */
-#define MROUTE_RATE_LIMIT_ENDLESS 0
-#define MROUTE_TTL_THRESHOLD 1
-#define MROUTE_DEFAULT_TTL 1
-void
-mroute_bridge_init(void)
+int
+mcg_br_entry_join(struct mcg_br_head_t *head)
 {
+	struct list_head *pos;
+	struct mcg_br_mdb_entry_t *mcge;
+	struct mcastpa_join_leave_t mjl;
+	char abuf[INET6_ADDRSTRLEN];
+	int res = 0;
 
-	int res;
-	int sock;
-	int proto;
-	int mrt_cmd;
-	int val = 1;
-	int table = 0;
-	struct vifctl vc;
-	unsigned char flags;
-
-	syslog(LOG_INFO, "%s:%d ", __FUNCTION__, __LINE__);
-	if ((sock = socket(AF_INET, SOCK_RAW, IPPROTO_IGMP)) == -1) {
-		syslog(LOG_INFO, "%s:%d IPPROTO_IGMP faild", __FUNCTION__, __LINE__);
-		return;
+	if (mcg_br_entry_mjl_init(head, &mjl) < 0) {
+		return (-ENOENT);	/* not ready to join - no video src */
 	}
 
-	res = setsockopt(sock, IPPROTO_IP, MRT_TABLE, &table, sizeof (table));
-	syslog(LOG_INFO, "%s:%d MRT_TABLE res %d\n", __FUNCTION__, __LINE__, res);
-	proto = IPPROTO_IP;
+	list_for_each(pos, &head->mcg_entry) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
+		if ((mcge->joined == 0) && !mcge->parked) {
+			if (!mcg_capacity_room()) {
+				/* stays in software - joined by mcg_capacity_run() once the backend has room */
+				if (mcastpa.capacity_full++ == 0)
+					syslog(LOG_NOTICE, "%s:%d backend %s full at %u members\n", __FUNCTION__,
+					       __LINE__, mcastpa.pa->name, mcastpa.pa->capacity);
+				mcg_sw_enter(mcge);
+				if (list_empty(&mcge->cap_wait)) {
+					list_add_tail(&mcge->cap_wait, &mcastpa.capacity_wait);
+					mcastpa.capacity_waiting++;
+				}
+				continue;
+			}
+			mcg_capacity_unwait(mcge);
+			mcg_br_entry_srcmac_set(mcge, &mjl);
+			mjl.lan_ifindex = mcge->ifindex;
+			res = mcg_pq_put(MCAST_PQ_JOIN, &mjl, mcge, mcge->retries);
+			if (res == 0) {
+				mcg_br_entry_joined_set(mcge, 1);
+			} else if (res == -ENOMEM) {
+				/* no backlog slot - software bridged and queued again with backoff */
+				mcg_sw_enter(mcge);
+				if (mcg_retry_add(MCAST_PQ_JOIN, &mjl, mcge->retries) < 0)
+					mcge->retries = RETRY_ATTEMPTS;	/* the next reconcile pass tries again */
+			}
+			syslog(LOG_INFO, "%s:%d join request queued group %s res: %d\n", __FUNCTION__, __LINE__,
+			       mcg_head_addr_str(head, abuf, sizeof (abuf)), res);
+		}
+	}
+
+	return (0);
+}
+
+/**
+ * @brief leaves with no groups or joins with smaller group list
+ * @details calls hw specific pa_leave()
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcg_br_entry_leave(struct mcg_br_head_t *head, struct br_mdb_entry *e)
+{
+	struct list_head *pos;
+	struct mcg_br_mdb_entry_t *mcge;
+	struct mcastpa_join_leave_t mjl;
+	char abuf[INET6_ADDRSTRLEN];
+
+	syslog(LOG_INFO, "%s:%d leave request \n", __FUNCTION__, __LINE__);
+
+	/* not ready means never joined - no video src - just drop the member(s) */
+	if (mcg_br_entry_mjl_init(head, &mjl) == 0) {
+		if (e != NULL) {
+			/* single member leave - direct member index lookup */
+			mcge = mcg_br_entry_get(head, e);
+			if ((mcge != NULL) && (mcge->joined == 1)) {
+				mcg_br_entry_srcmac_set(mcge, &mjl);
+				mjl.lan_ifindex = mcge->ifindex;
+				mcg_pq_put(MCAST_PQ_LEAVE, &mjl, mcge, 0);
+				mcg_br_entry_joined_set(mcge, 0);
+			}
+		} else {
+			list_for_each(pos, &head->mcg_entry) {
+				mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
+				if (mcge->joined == 1) {
+					mcg_br_entry_srcmac_set(mcge, &mjl);
+					mjl.lan_ifindex = mcge->ifindex;
+					mcg_pq_put(MCAST_PQ_LEAVE, &mjl, mcge, 0);
+					mcg_br_entry_joined_set(mcge, 0);
+					syslog(LOG_INFO, "%s:%d leave request queued group %s\n", __FUNCTION__, __LINE__,
+					       mcg_head_addr_str(head, abuf, sizeof (abuf)));
+				}
+			}
+		}
+	}
+
+	if (e != NULL) {
+		mcg_br_entry_del(head, e);
+	} else {
+		mcg_br_entry_head_del_all(head);
+	}
+
+	return (0);
+}
+
+/**
+ * @brief leaves and removes one member found through a reverse index
+ * @details drops the group head too once its last member is gone
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_br_entry_purge(struct mcg_br_mdb_entry_t *mcge)
+{
+	struct mcg_br_head_t *head = mcge->head;
+	struct br_mdb_entry e;
+
+	memset(&e, 0, sizeof (struct br_mdb_entry));
+	e.ifindex = mcge->ifindex;
+	memcpy(e.src_addr.eth_addr, mcge->srcmac, ETH_ALEN);
+	mcg_br_entry_leave(head, &e);
+	if (list_empty(&head->mcg_entry)) {
+		mcg_br_entry_head_del(head);
+	}
+}
+
+/**
+ * @brief removes all memberships of a bridge port from the accelerator
+ * @details single pass over the port reverse index - used on link down and link delete
+ * @returns number of memberships removed
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcg_br_entry_purge_port(int ifindex)
+{
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcg_br_mdb_entry_t *mcge;
+	int count = 0;
+
+	list_for_each_safe(pos, q, &mcastpa.port_hash[mcg_hash_port(ifindex)]) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, port_hash);
+		if (mcge->ifindex != ifindex)
+			continue;
+		mcg_br_entry_purge(mcge);
+		count++;
+	}
+	if (count)
+		syslog(LOG_NOTICE, "%s:%d port %s down removed %d members\n", __FUNCTION__, __LINE__,
+		       (char *) mcast_if_name(ifindex), count);
+	return (count);
+}
+
+/**
+ * @brief takes a member out of the accelerator but keeps it in the table
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_br_entry_park(struct mcg_br_mdb_entry_t *mcge)
+{
+	struct mcastpa_join_leave_t mjl;
+
+	if ((mcge->joined == 1) && (mcg_br_entry_mjl_init(mcge->head, &mjl) == 0)) {
+		mcg_br_entry_srcmac_set(mcge, &mjl);
+		mjl.lan_ifindex = mcge->ifindex;
+		mcg_pq_put(MCAST_PQ_LEAVE, &mjl, mcge, 0);
+	}
+	mcg_br_entry_joined_set(mcge, 0);
+	mcg_sw_leave(mcge);
+	mcge->parked = 1;
+}
+
+/**
+ * @brief takes the memberships of a subscriber srcmac on one bridge port out of the accelerator
+ * @details single pass over the srcmac reverse index - used on station leave. The members are
+ * @details parked, not removed - the kernel mdb entries outlive the fdb entry and later reports
+ * @details only refresh them, so no RTM_NEWMDB would bring the members back. Relearning the
+ * @details station or an mdb event or dump for the member joins it again
+ * @returns number of memberships parked
+ * @note br_ifindex 0 matches every bridge
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcg_br_entry_park_mac(int br_ifindex, int ifindex, const unsigned char *mac)
+{
+	struct list_head *pos;
+	struct mcg_br_mdb_entry_t *mcge;
+	int count = 0;
+
+	list_for_each(pos, &mcastpa.mac_hash[mcg_hash_mac(mac)]) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mac_hash);
+		if ((mcge->ifindex != ifindex) || mcge->parked || (memcmp(mcge->srcmac, mac, ETH_ALEN) != 0))
+			continue;
+		if (br_ifindex && (mcge->head->br_ifindex != br_ifindex))
+			continue;
+		mcg_br_entry_park(mcge);
+		count++;
+	}
+	if (count)
+		syslog(LOG_NOTICE, "%s:%d station %02X:%02X:%02X:%02X:%02X:%02X left port %s parked %d members\n",
+		       __FUNCTION__, __LINE__, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+		       (char *) mcast_if_name(ifindex), count);
+	return (count);
+}
+
+/**
+ * @brief joins the parked memberships of a subscriber srcmac on one bridge port again
+ * @details the station is back in the fdb - single pass over the srcmac reverse index
+ * @returns number of memberships joined again
+ * @note br_ifindex 0 matches every bridge
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcg_br_entry_unpark_mac(int br_ifindex, int ifindex, const unsigned char *mac)
+{
+	struct list_head *pos;
+	struct mcg_br_mdb_entry_t *mcge;
+	int count = 0;
+
+	list_for_each(pos, &mcastpa.mac_hash[mcg_hash_mac(mac)]) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mac_hash);
+		if ((mcge->ifindex != ifindex) || !mcge->parked || (memcmp(mcge->srcmac, mac, ETH_ALEN) != 0))
+			continue;
+		if (br_ifindex && (mcge->head->br_ifindex != br_ifindex))
+			continue;
+		mcge->parked = 0;
+		mcg_br_entry_join(mcge->head);
+		count++;
+	}
+	if (count)
+		syslog(LOG_NOTICE, "%s:%d station %02X:%02X:%02X:%02X:%02X:%02X back on port %s joined %d members\n",
+		       __FUNCTION__, __LINE__, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+		       (char *) mcast_if_name(ifindex), count);
+	return (count);
+}
+
+/**
+ * @brief shows the port numbers in use
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_port_show(FILE * f)
+{
+	struct list_head *pos;
+	struct mcast_br_ports_t *brp;
+	int i;
+
+	list_for_each(pos, &mcastpa.br_ports) {
+		brp = (struct mcast_br_ports_t *) list_entry(pos, struct mcast_br_ports_t, list);
+		fprintf(f, "ports %s of %u:", mcast_if_name(brp->br_ifindex), brp->size);
+		for (i = 0; i < brp->size; i++)
+			if (brp->ifindex[i])
+				fprintf(f, " %d=%s/%u", i, mcast_if_name(brp->ifindex[i]), brp->members[i]);
+		fprintf(f, "\n");
+	}
+	fprintf(f, "ports full %llu\n", (unsigned long long) mcastpa.port_full);
+}
+
+/**
+ * @brief shows pool, queue, latency and event counters
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcastpa_stats_show(FILE * f)
+{
+	fprintf(f, "backend %s caps 0x%x capacity %u full %llu waiting %u\n", mcastpa.pa->name, mcastpa.pa->caps,
+		mcastpa.pa->capacity, (unsigned long long) mcastpa.capacity_full, mcastpa.capacity_waiting);
+	mcast_port_show(f);
+	mcast_pool_show(f, &mcastpa.head_pool);
+	mcast_pool_show(f, &mcastpa.mbr_pool);
+	mcast_pool_show(f, &mcastpa.zap_pool);
+	mcast_pq_show(f, &mcastpa.pq);
+	mcast_hist_show(f);
+	mcast_pool_show(f, &mcastpa.retry_pool);
+	fprintf(f, "netlink overflows %llu resyncs %llu redump every %d s %llu added %llu removed %llu\n",
+		(unsigned long long) mcastpa.nl_overflows, (unsigned long long) mcastpa.resyncs,
+		mcastpa.params.redump, (unsigned long long) mcastpa.redumps,
+		(unsigned long long) mcastpa.resync_added, (unsigned long long) mcastpa.resync_removed);
+	mcast_pool_show(f, &mcastpa.shadow_pool);
+	fprintf(f, "reconcile every %d s passes %llu deferred %llu joins %llu leaves %llu\n",
+		mcastpa.params.reconcile, (unsigned long long) mcastpa.reconciles,
+		(unsigned long long) mcastpa.reconcile_deferred, (unsigned long long) mcastpa.reconcile_joins,
+		(unsigned long long) mcastpa.reconcile_leaves);
+	fprintf(f, "retry joins %llu leaves %llu given up %llu stale results %llu software %llu ms\n",
+		(unsigned long long) mcastpa.retry_joins, (unsigned long long) mcastpa.retry_leaves,
+		(unsigned long long) mcastpa.retry_given_up, (unsigned long long) mcastpa.stale_results,
+		(unsigned long long) mcastpa.sw_ms_total);
+	fprintf(f, "zap window %d ms events %llu merged %llu flushes %llu\n", mcastpa.params.zap_window,
+		(unsigned long long) mcastpa.zap_events, (unsigned long long) mcastpa.zap_merged,
+		(unsigned long long) mcastpa.zap_flushes);
+	if (mcastpa.loop.epfd >= 0) {
+		fprintf(f, "uptime %llu s\n", (unsigned long long) mcastpa.timer_tick);
+		mcast_loop_show(f, &mcastpa.loop);
+	}
+	if (mcastpa.ctl.fd >= 0)
+		mcast_ctl_show(f, &mcastpa.ctl);
+	mcast_snap_show(f);
+}
+
+/**
+ * @brief joins a vsa requested group on a device
+ * @details emulates a bridge device joining
+ * @returns 0 if OK -ENOSPC if the group or member pool is exhausted
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+vsa_entry_join(struct br_mdb_entry *e, struct mcg_br_mdb_entry_t **mcgep)
+{
+	struct mcg_br_head_t *head;
+	struct mcg_br_mdb_entry_t *mcge;
+
+	head = mcg_br_entry_head_get(e);
+	if (head == NULL) {
+		head = mcg_br_entry_head_add(e);
+		if (head == NULL)
+			return (-ENOSPC);
+		head->br_ifindex = 0;
+	}
+	mcge = mcg_br_entry_get(head, e);
+	if (mcge == NULL) {
+		mcge = mcg_br_entry_add(head, e);
+		if (mcge == NULL) {
+			if (list_empty(&head->mcg_entry))
+				mcg_br_entry_head_del(head);
+			return (-ENOSPC);
+		}
+	}
+	mcge->local = 1;
+	mcg_br_entry_join(head);
+	*mcgep = mcge;
+	return (0);
+}
+
+/**
+ * @brief leave a vsa requested group on a device
+ * @details emulates a bridge device leaving
+ * @returns 0 if OK -ENOENT if not a member
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+vsa_entry_leave(struct br_mdb_entry *e)
+{
+	struct mcg_br_head_t *head;
+
+	head = mcg_br_entry_head_get(e);
+	if ((head == NULL) || (mcg_br_entry_get(head, e) == NULL))
+		return (-ENOENT);
+
+	mcg_br_entry_leave(head, e);
+
+	if (list_empty(&head->mcg_entry)) {
+		mcg_br_entry_head_del(head);
+	}
+	return (0);
+}
+
+/**
+ * @brief member state for the control socket
+ * @returns joined, software or waiting - no video source yet
+ * @author tim.hayes@smartrg.com
+ */
+static const char *
+mcg_br_entry_state(struct mcg_br_mdb_entry_t *mcge)
+{
+	if (mcge->parked)
+		return ("parked");
+	if (mcge->retries)
+		return ("software");
+	return (mcge->joined ? "joined" : "waiting");
+}
+
+/**
+ * @brief fills a member key from control request words
+ * @details group device [srcmac] - the mac defaults to 00:00:00:00:00:00 like the old vsa file
+ * @returns 0 if OK -EINVAL or -ENODEV otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcastpa_ctl_entry(struct mcast_ctl_req_t *req, int group_only, struct br_mdb_entry *e)
+{
+	unsigned char *mac = e->src_addr.eth_addr;
+
+	memset(e, 0, sizeof (struct br_mdb_entry));
+	if (inet_pton(AF_INET, req->argv[1], &e->addr.u.ip4) == 1) {
+		if (!IN_MULTICAST(ntohl(e->addr.u.ip4)))
+			return (-EINVAL);
+		e->addr.proto = htons(ETH_P_IP);
+	} else if (inet_pton(AF_INET6, req->argv[1], &e->addr.u.ip6) == 1) {
+		if (!IN6_IS_ADDR_MULTICAST(&e->addr.u.ip6))
+			return (-EINVAL);
+		e->addr.proto = htons(ETH_P_IPV6);
+	} else {
+		return (-EINVAL);
+	}
+	if (group_only)
+		return (0);
+	e->ifindex = ll_name_to_index(req->argv[2]);
+	if (e->ifindex == 0)
+		return (-ENODEV);
+	if ((req->argc == 4) &&
+	    (sscanf(req->argv[3], "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4],
+		    &mac[5]) != ETH_ALEN))
+		return (-EINVAL);
+	return (0);
+}
+
+/**
+ * @brief lists the members of one group for the control socket
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcastpa_ctl_query_head(struct mcast_ctl_req_t *req, struct mcg_br_head_t *head)
+{
+	struct list_head *pos;
+	struct mcg_br_mdb_entry_t *mcge;
+	char abuf[INET6_ADDRSTRLEN];
+	unsigned char *m;
+	int count = 0;
+
+	mcg_head_addr_str(head, abuf, sizeof (abuf));
+	list_for_each(pos, &head->mcg_entry) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
+		m = mcge->srcmac;
+		mcast_ctl_printf(req, "member %s %s %02x:%02x:%02x:%02x:%02x:%02x %s %s", abuf,
+				 mcast_if_name(mcge->ifindex), m[0], m[1], m[2], m[3], m[4], m[5],
+				 mcg_br_entry_state(mcge), mcge->local ? "local" : "mdb");
+		count++;
+	}
+	return (count);
+}
+
+/**
+ * @brief handles one control socket request
+ * @details
+ * @details join <group> <device> [srcmac] - adds a local member and joins it
+ * @details leave <group> <device> [srcmac] - leaves and removes a member
+ * @details query [group] - one member line per member of the group or of all groups
+ * @details stats - host addresses and counters - what the SIGUSR1 dump used to hold
+ * @returns 0 if OK -errno otherwise
+ * @note replaces /tmp/vsapa.cfg and SIGUSR2 - one connection can carry any number of requests
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcastpa_ctl(struct mcast_ctl_req_t *req)
+{
+	struct list_head *pos;
+	struct mcg_br_head_t *head;
+	struct mcg_br_mdb_entry_t *mcge;
+	struct br_mdb_entry e;
+	char *buf = NULL;
+	char *line;
+	char *save = NULL;
+	size_t len = 0;
+	FILE *f;
+	int count = 0;
+	int res;
+
+	if ((strcmp(req->argv[0], "join") == 0) || (strcmp(req->argv[0], "leave") == 0)) {
+		if ((req->argc < 3) || (req->argc > 4))
+			return (-EINVAL);
+		res = mcastpa_ctl_entry(req, 0, &e);
+		if (res < 0)
+			return (res);
+		if (req->argv[0][0] == 'l')
+			return (vsa_entry_leave(&e));
+		res = vsa_entry_join(&e, &mcge);
+		if (res == 0)
+			snprintf(req->res, sizeof (req->res), "%s", mcg_br_entry_state(mcge));
+		return (res);
+	}
+	if (strcmp(req->argv[0], "query") == 0) {
+		if (req->argc > 2)
+			return (-EINVAL);
+		if (req->argc == 2) {
+			res = mcastpa_ctl_entry(req, 1, &e);
+			if (res < 0)
+				return (res);
+			head = mcg_br_entry_head_get(&e);
+			if (head == NULL)
+				return (-ENOENT);
+			count = mcastpa_ctl_query_head(req, head);
+		} else {
+			list_for_each(pos, &mcastpa.mcg_head) {
+				head = (struct mcg_br_head_t *) list_entry(pos, struct mcg_br_head_t, mcg_head);
+				count += mcastpa_ctl_query_head(req, head);
+			}
+		}
+		snprintf(req->res, sizeof (req->res), "%d", count);
+		return (0);
+	}
+	if (strcmp(req->argv[0], "stats") == 0) {
+		f = open_memstream(&buf, &len);
+		if (f == NULL)
+			return (-ENOMEM);
+		mcast_ip_entry_show(f);
+		mcastpa_stats_show(f);
+		fclose(f);
+		for (line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save))
+			mcast_ctl_printf(req, "%s", line);
+		free(buf);
+		return (0);
+	}
+	return (-EOPNOTSUPP);
+}
+
+/**
+ * @brief finds a head entry from a specific mc group
+ * @details group is the binary RTA_DST of a multicast route
+ * @returns pointer if group found NULL otherwise 
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+struct mcg_br_head_t *
+mcg_br_entry_head_get_from_group(int family, const void *group)
+{
+	if (family == AF_INET)
+		return (mcg_br_entry_head_lookup(htons(ETH_P_IP), group));
+	return (mcg_br_entry_head_lookup(htons(ETH_P_IPV6), group));
+}
+
+/**
+ * @brief  exit handler
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+#define MDB_FORK_EXIT 69
+static void
+mdb_exit_handler(int ev, void *arg)
+{
+	struct mcastpa_system_init_t msi;
+	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
+	if (ev == MDB_FORK_EXIT)
+		return;
+	syslog(LOG_INFO, "%s:%d removing head lists\n", __FUNCTION__, __LINE__);
+	mcg_br_entry_head_list_del_all();
+	syslog(LOG_NOTICE, "%s:%d group pool hwm %u member pool hwm %u\n", __FUNCTION__, __LINE__,
+	       mcastpa.head_pool.hwm, mcastpa.mbr_pool.hwm);
+	/* the leaves queued above still reach the driver before it is shut down */
+	mcast_pq_deinit(&mcastpa.pq);
+	mcast_br_ports_free_all();
+	memset(&msi, 0, sizeof (struct mcastpa_system_init_t));
+	mcastpa.pa->deinit(&msi);
+	mcast_ctl_deinit(&mcastpa.ctl);
+	mcastpa.snap = 0;
+	mcast_snap_deinit();
+	mcast_loop_deinit(&mcastpa.loop);
+	mcast_nlrec_close();
+	mcast_trace_deinit();
+	closelog();
+}
+
+/**
+ * @brief  formats a binary route address
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+const char *
+rt_addr_n2a(int af, const void *addr, char *buf, int buflen)
+{
+	switch (af) {
+	case AF_INET:
+	case AF_INET6:
+		return inet_ntop(af, addr, buf, buflen);
+	default:
+		return "???";
+	}
+}
+
+/**
+ * @brief tracks our host addresses
+ * @details RTM_NEWADDR and RTM_DELADDR for ipv4 and ipv6 - replaces learning RTA_PREFSRC from routes
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+do_addr(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+{
+	struct ifaddrmsg *ifa = NLMSG_DATA(n);
+	int len = n->nlmsg_len;
+	struct rtattr *tb[IFA_MAX + 1];
+	struct rtattr *a;
+	char abuf[INET6_ADDRSTRLEN];
+
+	if (n->nlmsg_type != RTM_NEWADDR && n->nlmsg_type != RTM_DELADDR)
+		return 0;
+
+	len -= NLMSG_LENGTH(sizeof (*ifa));
+	if (len < 0) {
+		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
+		return -1;
+	}
+	if ((ifa->ifa_family != AF_INET) && (ifa->ifa_family != AF_INET6))
+		return 0;
+
+	parse_rtattr(tb, IFA_MAX, IFA_RTA(ifa), len);
+
+	/* IFA_LOCAL is our end of a point to point link, IFA_ADDRESS the peer */
+	a = tb[IFA_LOCAL] ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+	if (a == NULL)
+		return 0;
+
+	if (n->nlmsg_type == RTM_NEWADDR) {
+		if (mcast_ip_entry_get(ifa->ifa_family, RTA_DATA(a), ifa->ifa_index) == NULL)
+			mcast_ip_entry_add(ifa->ifa_family, RTA_DATA(a), ifa->ifa_index);
+	} else {
+		mcast_ip_entry_del(ifa->ifa_family, RTA_DATA(a), ifa->ifa_index);
+	}
+	syslog(LOG_INFO, "%s:%d %s %s dev %s\n", __FUNCTION__, __LINE__,
+	       n->nlmsg_type == RTM_NEWADDR ? "add" : "del", inet_ntop(ifa->ifa_family, RTA_DATA(a), abuf,
+								       sizeof (abuf)), mcast_if_name(ifa->ifa_index));
+	return 0;
+}
+
+/**
+ * @brief  initialize our host address knowledge
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+addr_parse_init(void)
+{
+
+	if (rtnl_wilddump_request(&rth, AF_UNSPEC, RTM_GETADDR) < 0) {
+		syslog(LOG_INFO, "Cannot send dump request\n");
+		return 1;
+	}
+
+	if (mcast_nl_dump(&rth, do_addr) < 0) {
+		syslog(LOG_INFO, "Dump terminated\n");
+		return 1;
+	}
+	return 0;
+}
+
+static inline char *
+cache_mdb_entry_srcmac(struct br_mdb_entry *e)
+{
+	SPRINT_BUF(abuf);
+	int i;
+	int len = 0;
+	for (i = 0; i < ETH_ALEN; i++) {
+		if (i < (ETH_ALEN - 1)) {
+			len += sprintf(abuf + len, "%02X:", e->src_addr.eth_addr[i]);
+		} else {
+			len += sprintf(abuf + len, "%02X", e->src_addr.eth_addr[i]);
+		}
+	}
+	return (abuf);
+}
+
+static void
+cache_mdb_entry(int type, int ifindex, struct br_mdb_entry *e)
+{
+	SPRINT_BUF(abuf);
+	struct mcg_br_head_t *head;
+	struct mcg_br_mdb_entry_t *mcge;
+	int family;
+
+	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
+
+	if (e->state & MDB_PERMANENT)
+		return;
+
+	if (mcast_if_iswifi(e->ifindex)) {
+		if (mcastpa.params.nowifi) {
+			return;
+		}
+	}
+
+	if (e->addr.proto == htons(ETH_P_IP)) {
+		family = AF_INET;
+	} else if (e->addr.proto == htons(ETH_P_IPV6)) {
+		/* node and link local scope groups are never routed from the wan */
+		if (IN6_IS_ADDR_MC_NODELOCAL(&e->addr.u.ip6) || IN6_IS_ADDR_MC_LINKLOCAL(&e->addr.u.ip6))
+			return;
+		family = AF_INET6;
+	} else {
+		return;
+	}
+
+	if (inet_ntop(family, &e->addr.u, abuf, sizeof (abuf)) == NULL)
+		return;
+
+	if ((type == RTM_NEWMDB) || (type == RTM_GETMDB)) {
+
+		if (type == RTM_NEWMDB)
+			syslog(LOG_NOTICE, "RTM_NEWMDB dev %s port %s grp %s srcmac %s\n",
+			       (char *) mcast_if_name(ifindex), (char *) mcast_if_name(e->ifindex), abuf,
+			       cache_mdb_entry_srcmac(e));
+
+		head = mcg_br_entry_head_get(e);
+		if (head == NULL) {
+			head = mcg_br_entry_head_add(e);
+		}
+		if (head != NULL) {
+			head->br_ifindex = ifindex;
+			mcge = mcg_br_entry_get(head, e);
+			/* a dump only reports what is new to us, refreshes are not events */
+			if (type == RTM_GETMDB)
+				syslog((mcge == NULL) ? LOG_NOTICE : LOG_DEBUG,
+				       "RTM_GETMDB dev %s port %s grp %s srcmac %s\n", (char *) mcast_if_name(ifindex),
+				       (char *) mcast_if_name(e->ifindex), abuf, cache_mdb_entry_srcmac(e));
+			if (mcge == NULL) {
+				mcge = mcg_br_entry_add(head, e);
+				if ((mcge != NULL) && (type == RTM_GETMDB) && (mcastpa.resyncs || mcastpa.redumps))
+					mcastpa.resync_added++;
+			}
+			if ((mcge == NULL) && list_empty(&head->mcg_entry)) {
+				/* member pool exhausted - do not keep a group with no members */
+				mcg_br_entry_head_del(head);
+				return;
+			}
+			if (mcge != NULL) {
+				mcge->gen = mcastpa.mdb_gen;
+				/* the kernel still reports a station whose fdb entry went away */
+				mcge->parked = 0;
+				/* refresh of a member already in the accelerator - nothing to push */
+				if (mcge->joined == 1)
+					return;
+			}
+			mcg_br_entry_join(head);
+		}
+	}
+	if (type == RTM_DELMDB) {
+
+		syslog(LOG_NOTICE, "RTM_DELMDB dev %s port %s grp %s srcmac %s\n",
+		       (char *) mcast_if_name(ifindex), (char *) mcast_if_name(e->ifindex), abuf,
+		       cache_mdb_entry_srcmac(e));
+
+		head = mcg_br_entry_head_get(e);
+		if (head == NULL) {
+			syslog(LOG_INFO, "RTM_DELMDB head is NULL\n");
+			return;
+		}
+		mcge = mcg_br_entry_get(head, e);
+		if (mcge == NULL) {
+			syslog(LOG_INFO, "RTM_DELMDB mcge is NULL\n");
+			return;
+		}
+		mcg_br_entry_leave(head, e);
+		if (list_empty(&head->mcg_entry)) {
+			mcg_br_entry_head_del(head);
+		}
+	}
+}
+
+/**
+ * @brief hashes an mdb event to a pending event bucket
+ * @details same key as a group member - group, bridge port and srcmac
+ * @returns bucket index
+ * @author tim.hayes@smartrg.com
+ */
+static inline unsigned int
+mcg_zap_hash(struct br_mdb_entry *e)
+{
+	uint32_t key;
+
+	key = mcg_addr_fold(e->addr.proto, &e->addr.u);
+	key ^= (uint32_t) e->ifindex * 0x85EBCA6BU;
+	key ^= ((uint32_t) e->src_addr.eth_addr[4] << 8 | e->src_addr.eth_addr[5]);
+	return ((key * 0x9E3779B1U) >> 26) & (ZAP_HASH_SIZE - 1);
+}
+
+/**
+ * @brief compares the keys of two mdb events
+ * @returns 1 if same group, port and srcmac 0 otherwise
+ * @author tim.hayes@smartrg.com
+ */
+static inline int
+mcg_zap_equal(struct mcg_zap_t *zap, int br_ifindex, struct br_mdb_entry *e)
+{
+	if ((zap->br_ifindex != br_ifindex) || (zap->e.ifindex != e->ifindex) || (zap->e.addr.proto != e->addr.proto))
+		return (0);
+	if (memcmp(zap->e.src_addr.eth_addr, e->src_addr.eth_addr, ETH_ALEN) != 0)
+		return (0);
+	if (e->addr.proto == htons(ETH_P_IP))
+		return (zap->e.addr.u.ip4 == e->addr.u.ip4);
+	return (memcmp(&zap->e.addr.u.ip6, &e->addr.u.ip6, sizeof (struct in6_addr)) == 0);
+}
+
+/**
+ * @brief applies all pending mdb events
+ * @details all leaves first so accelerator entries are freed before joins take new ones
+ * @note only the last event for a (group, port, srcmac) is pending - add then remove of a new member
+ * @note finds no member and costs nothing, remove then add of a joined member is a refresh
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcg_zap_flush(void)
+{
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcg_zap_t *zap;
+	uint64_t rx_ns = mcastpa.pq.rx_ns;
+
+	if (list_empty(&mcastpa.zap_list))
+		return;
+
+	mcastpa.zap_flushes++;
+	/* latency is measured from when each event arrived, not from the flush */
+	list_for_each(pos, &mcastpa.zap_list) {
+		zap = (struct mcg_zap_t *) list_entry(pos, struct mcg_zap_t, list);
+		mcastpa.pq.rx_ns = zap->rx_ns;
+		if (zap->type == RTM_DELMDB)
+			cache_mdb_entry(zap->type, zap->br_ifindex, &zap->e);
+	}
+	list_for_each_safe(pos, q, &mcastpa.zap_list) {
+		zap = (struct mcg_zap_t *) list_entry(pos, struct mcg_zap_t, list);
+		mcastpa.pq.rx_ns = zap->rx_ns;
+		if (zap->type != RTM_DELMDB)
+			cache_mdb_entry(zap->type, zap->br_ifindex, &zap->e);
+		list_del(&zap->list);
+		list_del(&zap->hash);
+		mcast_pool_free(&mcastpa.zap_pool, zap);
+	}
+	mcastpa.pq.rx_ns = rx_ns;
+}
+
+/**
+ * @brief ms until the pending mdb events must be flushed
+ * @returns -1 if nothing is pending
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcg_zap_timeout(void)
+{
+	struct timespec now;
+	long elapsed;
+
+	if (list_empty(&mcastpa.zap_list))
+		return (-1);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsed = (now.tv_sec - mcastpa.zap_start.tv_sec) * 1000 + (now.tv_nsec - mcastpa.zap_start.tv_nsec) / 1000000;
+	if (elapsed >= mcastpa.params.zap_window)
+		return (0);
+	return (mcastpa.params.zap_window - elapsed);
+}
+
+/**
+ * @brief queues an mdb event in the coalescing window
+ * @details a later event for the same (group, port, srcmac) replaces the pending one
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_zap_queue(int type, int br_ifindex, struct br_mdb_entry *e)
+{
+	struct list_head *pos;
+	struct list_head *bucket;
+	struct mcg_zap_t *zap;
+
+	mcastpa.zap_events++;
+	bucket = &mcastpa.zap_hash[mcg_zap_hash(e)];
+	list_for_each(pos, bucket) {
+		zap = (struct mcg_zap_t *) list_entry(pos, struct mcg_zap_t, hash);
+		if (mcg_zap_equal(zap, br_ifindex, e)) {
+			zap->type = type;
+			zap->rx_ns = mcastpa.pq.rx_ns;
+			memcpy(&zap->e, e, sizeof (struct br_mdb_entry));
+			mcastpa.zap_merged++;
+			return;
+		}
+	}
+
+	zap = (struct mcg_zap_t *) mcast_pool_alloc(&mcastpa.zap_pool);
+	if (zap == NULL) {
+		mcg_zap_flush();
+		zap = (struct mcg_zap_t *) mcast_pool_alloc(&mcastpa.zap_pool);
+		if (zap == NULL) {
+			cache_mdb_entry(type, br_ifindex, e);
+			return;
+		}
+	}
+	if (list_empty(&mcastpa.zap_list))
+		clock_gettime(CLOCK_MONOTONIC, &mcastpa.zap_start);
+	zap->type = type;
+	zap->br_ifindex = br_ifindex;
+	zap->rx_ns = mcastpa.pq.rx_ns;
+	memcpy(&zap->e, e, sizeof (struct br_mdb_entry));
+	list_add_tail(&zap->list, &mcastpa.zap_list);
+	list_add(&zap->hash, bucket);
+}
+
+/**
+ * @brief hands an mdb event to the coalescing window or applies it at once
+ * @details initial dumps and a zero window apply at once
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mdb_entry_dispatch(int type, int ifindex, struct br_mdb_entry *e)
+{
+	if (mcastpa.zap_enabled && (type != RTM_GETMDB)) {
+		mcg_zap_queue(type, ifindex, e);
+	} else {
+		cache_mdb_entry(type, ifindex, e);
+	}
+}
+
+/**
+ * @brief parses mdb_entry - may contain mulitiples and calls cache function 
+ * @details checks for bridge membership and not wan interface
+ * @note We saw Cspire join on wan interface
+ * @note ifindex is bridge ifindex
+ * @todo we only look for one wan interface.  
+ * @todo what about guest bridge -  need to check for that
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+parse_br_mdb_entry(struct nlmsghdr *n, int ifindex, struct rtattr *attr)
+{
+	struct rtattr *i;
+	int rem;
+	struct br_mdb_entry *e;
+
+	syslog(LOG_INFO, "%s:%d bridge %s\n", __FUNCTION__, __LINE__, (char *) mcast_if_name(ifindex));
+
+	rem = RTA_PAYLOAD(attr);
+	for (i = RTA_DATA(attr); RTA_OK(i, rem); i = RTA_NEXT(i, rem)) {
+		e = RTA_DATA(i);
+		if (mcastpa.params.wan_ifindex == ifindex) {
+			syslog(LOG_INFO, "%s:%d ignoring join on wan interface\n", __FUNCTION__, __LINE__);
+			continue;
+		}
+		if (mcastpa.params.bridged) {
+			if (mcast_if_role(ifindex) & MCAST_IF_VIDEO_BRIDGE) {
+				mdb_entry_dispatch(n->nlmsg_type, ifindex, e);
+			} else {
+				syslog(LOG_INFO, "%s:%d bridge %s mismatch %s\n", __FUNCTION__, __LINE__,
+				       (char *) mcast_if_name(ifindex), mcastpa.params.bridge_name);
+			}
+		} else {
+			mdb_entry_dispatch(n->nlmsg_type, ifindex, e);
+		}
+	}
+}
+
+int
+parse_mdb(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+{
+	struct br_port_msg *r = NLMSG_DATA(n);
+	int len = n->nlmsg_len;
+	struct rtattr *tb[MDBA_MAX + 1];
+
+	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
+
+	if (n->nlmsg_type != RTM_GETMDB && n->nlmsg_type != RTM_NEWMDB && n->nlmsg_type != RTM_DELMDB) {
+		syslog(LOG_INFO, "Not RTM_GETMDB, RTM_NEWMDB or RTM_DELMDB: %08x %08x %08x\n",
+		       n->nlmsg_len, n->nlmsg_type, n->nlmsg_flags);
+
+		return 0;
+	}
+
+	len -= NLMSG_LENGTH(sizeof (*r));
+	if (len < 0) {
+		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
+		return -1;
+	}
+
+	parse_rtattr(tb, MDBA_MAX, MDBA_RTA(r), n->nlmsg_len - NLMSG_LENGTH(sizeof (*r)));
+
+	if (tb[MDBA_MDB]) {
+		struct rtattr *i;
+		int rem = RTA_PAYLOAD(tb[MDBA_MDB]);
+
+		for (i = RTA_DATA(tb[MDBA_MDB]); RTA_OK(i, rem); i = RTA_NEXT(i, rem))
+			parse_br_mdb_entry(n, r->ifindex, i);
+	}
+
+	return 0;
+}
+
+int
+do_mroute(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+{
+	struct rtmsg *r = NLMSG_DATA(n);
+	int len = n->nlmsg_len;
+	struct rtattr *tb[RTA_MAX + 1];
+	char abuf[256];
+	int iif = 0;
+	int family;
+	int delete = 0;
+	char this_address[128] = { 0 };
+	char group_address[128] = { 0 };
+	struct mcg_br_head_t *head;
+
+	syslog(LOG_INFO, "%s:%d \n", __FUNCTION__, __LINE__);
+
+	if ((n->nlmsg_type != RTM_NEWROUTE && n->nlmsg_type != RTM_DELROUTE) || !(n->nlmsg_flags & NLM_F_MULTI)) {
+//              syslog (LOG_INFO,"Not a multicast route: %08x %08x %08x\n", n->nlmsg_len, n->nlmsg_type, n->nlmsg_flags);
+//              return 0;
+	}
+	len -= NLMSG_LENGTH(sizeof (*r));
+	if (len < 0) {
+		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
+		return -1;
+	}
+
+	if (r->rtm_type != RTN_MULTICAST) {
+		return 0;
+	}
+
+	/* ff00::/8 in the ipv6 local table is RTN_MULTICAST too - only mfc entries are wanted */
+	if ((r->rtm_family != RTNL_FAMILY_IPMR) && (r->rtm_family != RTNL_FAMILY_IP6MR)) {
+		return 0;
+	}
+
+	parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+
+	if (tb[RTA_IIF]) {
+		iif = *(int *) RTA_DATA(tb[RTA_IIF]);
+		if (!mcast_if_iswan(iif)) {
+			return 0;
+		}
+	} else {
+		return 0;
+	}
+
+	family = r->rtm_family == RTNL_FAMILY_IPMR ? AF_INET : AF_INET6;
+
+	if (tb[RTA_SRC]) {
+		if (islocaladdr(family, RTA_DATA(tb[RTA_SRC]))) {
+			return 0;
+		}
+		len =
+		    snprintf(this_address, sizeof (this_address), "%s",
+			     (char *) rt_addr_n2a(family, RTA_DATA(tb[RTA_SRC]), abuf, sizeof (abuf)));
+	} else {
+		return 0;
+	}
+
+	if (n->nlmsg_type == RTM_DELROUTE) {
+		delete = 1;
+	}
+
+	if (tb[RTA_DST]) {
+		len =
+		    snprintf(group_address, sizeof (group_address), "%s",
+			     (char *) rt_addr_n2a(family, RTA_DATA(tb[RTA_DST]), abuf, sizeof (abuf)));
+	} else {
+		return 0;
+	}
+
+	if (delete) {
+		head = mcg_br_entry_head_get_from_group(family, RTA_DATA(tb[RTA_DST]));
+		if (head != NULL) {
+			syslog(LOG_INFO, "%s:%d not deleteing mc group %s from %s head not found\n", __FUNCTION__,
+			       __LINE__, group_address, this_address);
+#if 0
+
+			// routes get deleted and added every few minutes so we loose ppa flows
+
+			mcg_br_entry_head_del_all(head);
+			mcg_br_entry_leave(head, NULL);
+			mcg_br_entry_head_del(head);
+#endif
+		} else {
+			syslog(LOG_INFO, "%s:%d mc group %s from %s head not found\n", __FUNCTION__, __LINE__,
+			       group_address, this_address);
+		}
+	} else {
+		syslog(LOG_INFO, "%s:%d mc group %s from %s\n", __FUNCTION__, __LINE__, group_address, this_address);
+		head = mcg_br_entry_head_get_from_group(family, RTA_DATA(tb[RTA_DST]));
+		if (head != NULL) {
+			if (head->src.family == AF_UNSPEC) {
+				head->src.family = family;
+				memcpy(&head->src.u, RTA_DATA(tb[RTA_SRC]), family == AF_INET ? 4 : 16);
+				head->wan_ifindex = iif;
+				mcg_trace(MT_ROUTE, head, iif, NULL, 0);
+				mcg_br_entry_join(head);
+				syslog(LOG_INFO, "%s:%d mc group %s from %s added to head\n", __FUNCTION__, __LINE__,
+				       group_address, this_address);
+			} else {
+				syslog(LOG_INFO, "%s:%d mc group %s from %s was not installed because a source exists \n",
+				       __FUNCTION__, __LINE__, group_address, this_address);
+			}
+		} else {
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief handles link changes of bridge ports
+ * @details a port that is deleted or no longer running has all of its memberships purged
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+do_link(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+{
+	struct ifinfomsg *ifi = NLMSG_DATA(n);
+
+	if (n->nlmsg_len < NLMSG_LENGTH(sizeof (*ifi))) {
+		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", n->nlmsg_len);
+		return -1;
+	}
+
+	mcast_if_update(who, n, arg);
+
+	if ((n->nlmsg_type == RTM_DELLINK) || !(ifi->ifi_flags & IFF_UP) || !(ifi->ifi_flags & IFF_RUNNING)) {
+		mcg_br_entry_purge_port(ifi->ifi_index);
+	}
+	return 0;
+}
+
+/**
+ * @brief handles bridge fdb changes
+ * @details a station whose fdb entry on a port is deleted (disassociated, flushed, aged out) has
+ * @details its memberships on that port parked, a station learned again on the port rejoins them
+ * @note an active STB keeps its fdb entry alive with periodic IGMP reports
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+do_neigh(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+{
+	struct ndmsg *ndm = NLMSG_DATA(n);
+	int len = n->nlmsg_len;
+	struct rtattr *tb[NDA_MAX + 1];
+	int master = 0;
+
+	if ((n->nlmsg_type != RTM_DELNEIGH) && (n->nlmsg_type != RTM_NEWNEIGH))
+		return 0;
+
+	len -= NLMSG_LENGTH(sizeof (*ndm));
+	if (len < 0) {
+		syslog(LOG_INFO, "BUG: wrong nlmsg len %d\n", len);
+		return -1;
+	}
+
+	if (ndm->ndm_family != AF_BRIDGE)
+		return 0;
+
+	parse_rtattr(tb, NDA_MAX, NDA_RTA(ndm), len);
+
+	if (tb[NDA_MASTER] && (RTA_PAYLOAD(tb[NDA_MASTER]) == sizeof (uint32_t)))
+		master = *(uint32_t *) RTA_DATA(tb[NDA_MASTER]);
+	if (tb[NDA_LLADDR] && (RTA_PAYLOAD(tb[NDA_LLADDR]) == ETH_ALEN)) {
+		if (n->nlmsg_type == RTM_DELNEIGH)
+			mcg_br_entry_park_mac(master, ndm->ndm_ifindex, RTA_DATA(tb[NDA_LLADDR]));
+		else
+			mcg_br_entry_unpark_mac(master, ndm->ndm_ifindex, RTA_DATA(tb[NDA_LLADDR]));
+	}
+	return 0;
+}
+
+static int
+do_monitor_msg(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg)
+{
+	struct rtmsg *r = NLMSG_DATA(n);
+
+	switch (n->nlmsg_type) {
+	case RTM_NEWMDB:
+		syslog(LOG_INFO, "%s:%d NEWMDB\n", __FUNCTION__, __LINE__);
+		parse_mdb(who, n, arg);
+		break;
+	case RTM_DELMDB:
+		syslog(LOG_INFO, "%s:%d DELMDB\n", __FUNCTION__, __LINE__);
+		parse_mdb(who, n, arg);
+		break;
+	case RTM_GETMDB:
+		/* mdb dump reply - only seen when replaying a record */
+		parse_mdb(who, n, arg);
+		break;
+	case RTM_NEWROUTE:
+		if (r->rtm_type == RTN_MULTICAST) {
+			syslog(LOG_INFO, "%s:%d NEWMCROUTE\n", __FUNCTION__, __LINE__);
+			do_mroute(who, n, arg);
+		}
+		break;
+	case RTM_DELROUTE:
+		if (r->rtm_type == RTN_MULTICAST) {
+			syslog(LOG_INFO, "%s:%d DELMCROUTE\n", __FUNCTION__, __LINE__);
+			do_mroute(who, n, arg);
+		}
+		break;
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+		do_addr(who, n, arg);
+		break;
+	case RTM_NEWLINK:
+	case RTM_DELLINK:
+		do_link(who, n, arg);
+		break;
+	case RTM_NEWNEIGH:
+	case RTM_DELNEIGH:
+		do_neigh(who, n, arg);
+		break;
+	default:
+		syslog(LOG_INFO, "do_monitor: nlmmsg_type unknown %u\n", n->nlmsg_type);
+		break;
+	}
+	return (0);
+}
+
+/**
+ * @brief  initialize our wan mroute knowledge
+ * @details dumps the ipv4 and ipv6 mfc - an AF_INET dump would only return the unicast fib
+ * @note a kernel without ipv6 multicast routing fails the second dump - ipv4 is still learned
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mroute_parse_init(struct rtnl_handle *h)
+{
+	static const int family[] = { RTNL_FAMILY_IPMR, RTNL_FAMILY_IP6MR };
+	int res = 0;
+	int i;
+
+	for (i = 0; i < sizeof (family) / sizeof (family[0]); i++) {
+		if (rtnl_wilddump_request(h, family[i], RTM_GETROUTE) < 0) {
+			syslog(LOG_INFO, "Cannot send mfc %d dump request\n", family[i]);
+			res = 1;
+			continue;
+		}
+
+		if (mcast_nl_dump(h, do_mroute) < 0) {
+			syslog(LOG_INFO, "mfc %d dump terminated\n", family[i]);
+			res = 1;
+		}
+	}
+	return res;
+}
+
+/**
+ * @brief sets br-video to be a virtual router port 
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ */
+#define MROUTE_RATE_LIMIT_ENDLESS 0
+#define MROUTE_TTL_THRESHOLD 1
+#define MROUTE_DEFAULT_TTL 1
+void
+mroute_bridge_init(void)
+{
+
+	int res;
+	int sock;
+	int proto;
+	int mrt_cmd;
+	int val = 1;
+	int table = 0;
+	struct vifctl vc;
+	unsigned char flags;
+
+	syslog(LOG_INFO, "%s:%d ", __FUNCTION__, __LINE__);
+	if ((sock = socket(AF_INET, SOCK_RAW, IPPROTO_IGMP)) == -1) {
+		syslog(LOG_INFO, "%s:%d IPPROTO_IGMP faild", __FUNCTION__, __LINE__);
+		return;
+	}
+
+	res = setsockopt(sock, IPPROTO_IP, MRT_TABLE, &table, sizeof (table));
+	syslog(LOG_INFO, "%s:%d MRT_TABLE res %d\n", __FUNCTION__, __LINE__, res);
+	proto = IPPROTO_IP;
 	mrt_cmd = MRT_INIT;
 	res = setsockopt(sock, proto, mrt_cmd, (void *) &val, sizeof (val));
 	syslog(LOG_INFO, "%s:%d MRT_INIT res %d\n", __FUNCTION__, __LINE__, res);
 
-	memset(&vc, 0, sizeof (vc));
-	flags = VIFF_USE_IFINDEX + VIFF_REGISTER;
-	flags = VIFF_USE_IFINDEX;
-	vc.vifc_vifi = 0;	//vifNum;
-	vc.vifc_flags = flags;
-	vc.vifc_threshold = MROUTE_TTL_THRESHOLD;
-	vc.vifc_rate_limit = MROUTE_RATE_LIMIT_ENDLESS;
-	vc.vifc_lcl_ifindex = ll_name_to_index("br-video");	//if_index;
-	res = setsockopt(sock, IPPROTO_IP, MRT_ADD_VIF, (void *) &vc, sizeof (vc));
-	syslog(LOG_INFO, "%s:%d MRT_ADD_VIF res %d\n", __FUNCTION__, __LINE__, res);
+	memset(&vc, 0, sizeof (vc));
+	flags = VIFF_USE_IFINDEX + VIFF_REGISTER;
+	flags = VIFF_USE_IFINDEX;
+	vc.vifc_vifi = 0;	//vifNum;
+	vc.vifc_flags = flags;
+	vc.vifc_threshold = MROUTE_TTL_THRESHOLD;
+	vc.vifc_rate_limit = MROUTE_RATE_LIMIT_ENDLESS;
+	vc.vifc_lcl_ifindex = ll_name_to_index("br-video");	//if_index;
+	res = setsockopt(sock, IPPROTO_IP, MRT_ADD_VIF, (void *) &vc, sizeof (vc));
+	syslog(LOG_INFO, "%s:%d MRT_ADD_VIF res %d\n", __FUNCTION__, __LINE__, res);
+
+}
+
+/**
+ * @brief  initialize our lan mdb knowledge
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mdb_parse_init(struct rtnl_handle *h)
+{
+
+	if (rtnl_wilddump_request(h, PF_BRIDGE, RTM_GETMDB) < 0) {
+		syslog(LOG_INFO, "Cannot send RTM_GETMDG dump request\n");
+		return 1;
+	}
+
+	if (mcast_nl_dump(h, parse_mdb) < 0) {
+		syslog(LOG_INFO, "Dump terminated\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief leaves and removes the members the last mdb dump did not show
+ * @details
+ * @note vsa members are not in the kernel mdb and are kept
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_resync_sweep(void)
+{
+	struct list_head *hpos;
+	struct list_head *hq;
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcg_br_head_t *head;
+	struct mcg_br_mdb_entry_t *mcge;
+	struct br_mdb_entry e;
+
+	list_for_each_safe(hpos, hq, &mcastpa.mcg_head) {
+		head = (struct mcg_br_head_t *) list_entry(hpos, struct mcg_br_head_t, mcg_head);
+		list_for_each_safe(pos, q, &head->mcg_entry) {
+			mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
+			if (mcge->local || (mcge->gen == mcastpa.mdb_gen))
+				continue;
+			memset(&e, 0, sizeof (struct br_mdb_entry));
+			e.ifindex = mcge->ifindex;
+			memcpy(e.src_addr.eth_addr, mcge->srcmac, ETH_ALEN);
+			mcg_br_entry_leave(head, &e);
+			mcastpa.resync_removed++;
+		}
+		if (list_empty(&head->mcg_entry))
+			mcg_br_entry_head_del(head);
+	}
+}
+
+/**
+ * @brief brings the group table back in line with the kernel
+ * @details redumps the mdb and the multicast routes on a separate socket, members the dump
+ * @details shows are added and joined, members it no longer shows are left and removed
+ * @details - members and routes that did not change cost no driver call
+ * @details runs after lost netlink messages or, with periodic set, on the --redump timer
+ * @details - either one restarts the redump timer
+ * @note vsa members are not in the kernel mdb and are kept
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_resync(int periodic)
+{
+	uint64_t added = mcastpa.resync_added;
+	uint64_t removed = mcastpa.resync_removed;
+
+	clock_gettime(CLOCK_MONOTONIC, &mcastpa.redump_due);
+	mcastpa.redump_due.tv_sec += mcastpa.params.redump;
+	if (periodic) {
+		mcastpa.redumps++;
+		mcast_trace(MT_REDUMP, 0, NULL, 0, NULL, 0, mcastpa.redumps);
+		mcast_nlrec_write(NULL, MCAST_NLREC_REDUMP, 0);
+	} else {
+		mcastpa.resync = 0;
+		mcastpa.resyncs++;
+		mcast_trace(MT_RESYNC, 0, NULL, 0, NULL, 0, mcastpa.resyncs);
+		mcast_nlrec_write(NULL, MCAST_NLREC_RESYNC, 0);
+	}
+
+	/* pending events are older than the snapshot */
+	mcg_zap_flush();
+
+	mcastpa.mdb_gen++;
+	if (mdb_parse_init(&rth_dump) != 0) {
+		syslog(LOG_NOTICE, "%s:%d mdb dump failed - table not swept\n", __FUNCTION__, __LINE__);
+		return;
+	}
+
+	mcg_resync_sweep();
+
+	mroute_parse_init(&rth_dump);
+
+	syslog((mcastpa.resync_added != added || mcastpa.resync_removed != removed) ? LOG_NOTICE : LOG_INFO,
+	       "%s:%d %s %llu added %llu removed %llu\n", __FUNCTION__, __LINE__, periodic ? "redump" : "resync",
+	       (unsigned long long) (periodic ? mcastpa.redumps : mcastpa.resyncs),
+	       (unsigned long long) (mcastpa.resync_added - added),
+	       (unsigned long long) (mcastpa.resync_removed - removed));
+}
+
+/**
+ * @brief hashes a driver request to a shadow bucket
+ * @details same key as a group member - group, bridge port and srcmac
+ * @returns bucket index
+ * @author tim.hayes@smartrg.com
+ */
+static inline unsigned int
+mcg_shadow_hash(struct mcastpa_join_leave_t *mjl)
+{
+	uint32_t key;
+
+	if (mjl->group.family == AF_INET6)
+		key = mcg_addr_fold(htons(ETH_P_IPV6), &mjl->group.u.ip6);
+	else
+		key = mcg_addr_fold(htons(ETH_P_IP), &mjl->group.u.ip4);
+	key ^= (uint32_t) mjl->lan_ifindex * 0x85EBCA6BU;
+	key ^= ((uint32_t) mjl->srcmac[4] << 8 | mjl->srcmac[5]);
+	return ((key * 0x9E3779B1U) >> 22) & (SHADOW_HASH_SIZE - 1);
+}
+
+/**
+ * @brief finds the shadow of a programmed flow
+ * @returns pointer to entry or null
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static struct mcg_shadow_t *
+mcg_shadow_get(struct mcastpa_join_leave_t *mjl)
+{
+	struct list_head *pos;
+	struct mcg_shadow_t *sh;
+
+	list_for_each(pos, &mcastpa.shadow_hash[mcg_shadow_hash(mjl)]) {
+		sh = (struct mcg_shadow_t *) list_entry(pos, struct mcg_shadow_t, hash);
+		if ((sh->mjl.lan_ifindex == mjl->lan_ifindex) && (sh->mjl.group.family == mjl->group.family) &&
+		    (memcmp(&sh->mjl.group.u, &mjl->group.u, sizeof (mjl->group.u)) == 0) &&
+		    (memcmp(sh->mjl.srcmac, mjl->srcmac, ETH_ALEN) == 0))
+			return (sh);
+	}
+	return (NULL);
+}
+
+/**
+ * @brief records a join the driver accepted
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_shadow_add(struct mcastpa_join_leave_t *mjl)
+{
+	struct mcg_shadow_t *sh;
+
+	sh = mcg_shadow_get(mjl);
+	if (sh == NULL) {
+		sh = (struct mcg_shadow_t *) mcast_pool_alloc(&mcastpa.shadow_pool);
+		if (sh == NULL)
+			return;
+		list_add(&sh->hash, &mcastpa.shadow_hash[mcg_shadow_hash(mjl)]);
+	}
+	memcpy(&sh->mjl, mjl, sizeof (struct mcastpa_join_leave_t));
+}
+
+/**
+ * @brief forgets a flow the driver removed
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_shadow_del(struct mcastpa_join_leave_t *mjl)
+{
+	struct mcg_shadow_t *sh;
+
+	sh = mcg_shadow_get(mjl);
+	if (sh == NULL)
+		return;
+	list_del(&sh->hash);
+	mcast_pool_free(&mcastpa.shadow_pool, sh);
+}
+
+/**
+ * @brief finds the group member a driver request was made for
+ * @returns pointer to member or null
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static struct mcg_br_mdb_entry_t *
+mcg_br_entry_get_mjl(struct mcastpa_join_leave_t *mjl)
+{
+	struct mcg_br_head_t *head;
+	struct br_mdb_entry e;
+
+	if (mjl->group.family == AF_INET6)
+		head = mcg_br_entry_head_lookup(htons(ETH_P_IPV6), &mjl->group.u.ip6);
+	else
+		head = mcg_br_entry_head_lookup(htons(ETH_P_IP), &mjl->group.u.ip4);
+	if (head == NULL)
+		return (NULL);
+	memset(&e, 0, sizeof (e));
+	e.ifindex = mjl->lan_ifindex;
+	memcpy(e.src_addr.eth_addr, mjl->srcmac, ETH_ALEN);
+	return (mcg_br_entry_get(head, &e));
+}
+
+/**
+ * @brief joins members refused for backend capacity while it has room
+ * @details in refusal order - called when results were read, which is when a shadow slot or
+ * @details a queued request is freed
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_capacity_run(void)
+{
+	struct mcg_br_mdb_entry_t *mcge;
+
+	while (!list_empty(&mcastpa.capacity_wait) && mcg_capacity_room()) {
+		mcge = (struct mcg_br_mdb_entry_t *) list_entry(mcastpa.capacity_wait.next,
+								 struct mcg_br_mdb_entry_t, cap_wait);
+		mcg_capacity_unwait(mcge);
+		mcg_br_entry_join(mcge->head);
+	}
+}
+
+/**
+ * @brief handles the results the programming worker hands back
+ * @details accepted requests update the shadow, failed requests are retried later, a member
+ * @details whose join failed is software bridged until a retried join succeeds - results of a
+ * @details request overtaken by a newer one for the same member only update the shadow
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_retry_results(void)
+{
+	struct mcast_pq_item_t item;
+	struct mcg_br_mdb_entry_t *mcge;
+	char abuf[INET6_ADDRSTRLEN];
+
+	while (mcast_pq_result_get(&mcastpa.pq, &item)) {
+		mcge = mcg_br_entry_get_mjl(&item.mjl);
+		if (item.res == 0) {
+			/* the shadow follows the driver whatever the member wants now */
+			if (item.op == MCAST_PQ_JOIN)
+				mcg_shadow_add(&item.mjl);
+			else
+				mcg_shadow_del(&item.mjl);
+		}
+		/* a newer request for the member is queued - its result decides */
+		if ((mcge != NULL) && (item.seq != mcge->seq)) {
+			mcastpa.stale_results++;
+			continue;
+		}
+		if (item.res == 0) {
+			if ((item.op == MCAST_PQ_JOIN) && (mcge != NULL)) {
+				/* a retried request finally made it */
+				mcg_br_entry_joined_set(mcge, 1);
+				mcg_sw_leave(mcge);
+			}
+			continue;
+		}
+		if (item.op == MCAST_PQ_JOIN) {
+			if (mcge == NULL)
+				continue;	/* member left meanwhile */
+			mcg_br_entry_joined_set(mcge, 0);
+			mcg_sw_enter(mcge);
+			mcge->retries = item.attempt + 1;
+		}
+		if (mcast_pq_transient(item.res) && (item.attempt + 1 < RETRY_ATTEMPTS) &&
+		    (mcg_retry_add(item.op, &item.mjl, item.attempt + 1) == 0))
+			continue;
+		mcastpa.retry_given_up++;
+		inet_ntop(item.mjl.group.family, &item.mjl.group.u, abuf, sizeof (abuf));
+		syslog(LOG_NOTICE, "%s:%d %s group %s port %s given up after %u attempts res %d\n", __FUNCTION__,
+		       __LINE__, item.op == MCAST_PQ_JOIN ? "join" : "leave", abuf, mcast_if_name(item.mjl.lan_ifindex),
+		       item.attempt + 1, item.res);
+	}
+	mcg_capacity_run();
+}
+
+/**
+ * @brief sends the retries that are due
+ * @details a join is redone from the current group state - a leave only if the member
+ * @details has not joined again meanwhile
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_retry_run(void)
+{
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcg_retry_t *retry;
+	struct mcg_br_mdb_entry_t *mcge;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	list_for_each_safe(pos, q, &mcastpa.retry_list) {
+		retry = (struct mcg_retry_t *) list_entry(pos, struct mcg_retry_t, list);
+		if ((retry->due.tv_sec > now.tv_sec) ||
+		    ((retry->due.tv_sec == now.tv_sec) && (retry->due.tv_nsec > now.tv_nsec)))
+			continue;
+		mcge = mcg_br_entry_get_mjl(&retry->mjl);
+		if (retry->op == MCAST_PQ_JOIN) {
+			if ((mcge != NULL) && (mcge->joined == 0)) {
+				mcastpa.retry_joins++;
+				mcg_br_entry_join(mcge->head);
+			}
+		} else if ((mcge == NULL) || (mcge->joined == 0)) {
+			mcastpa.retry_leaves++;
+			mcg_pq_put(MCAST_PQ_LEAVE, &retry->mjl, mcge, retry->attempt);
+		}
+		list_del(&retry->list);
+		mcast_pool_free(&mcastpa.retry_pool, retry);
+	}
+}
+
+/**
+ * @brief ms until the next retry is due
+ * @returns -1 if no retry is pending
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcg_retry_timeout(void)
+{
+	struct list_head *pos;
+	struct mcg_retry_t *retry;
+	struct timespec now;
+	long ms;
+	long min = -1;
+
+	if (list_empty(&mcastpa.retry_list))
+		return (-1);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	list_for_each(pos, &mcastpa.retry_list) {
+		retry = (struct mcg_retry_t *) list_entry(pos, struct mcg_retry_t, list);
+		ms = (retry->due.tv_sec - now.tv_sec) * 1000 + (retry->due.tv_nsec - now.tv_nsec) / 1000000;
+		if (ms < 0)
+			ms = 0;
+		if ((min < 0) || (ms < min))
+			min = ms;
+	}
+	return (min);
+}
+
+/**
+ * @brief compares the group table with the shadow of the accelerator
+ * @details joined members missing from the shadow are joined again, shadow flows no joined
+ * @details member wants are left, members given up after RETRY_ATTEMPTS get one more try
+ * @note only called with no request in flight so the shadow is exact
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_reconcile_shadow(void)
+{
+	struct list_head *hpos;
+	struct list_head *pos;
+	struct list_head *q;
+	struct mcg_br_head_t *head;
+	struct mcg_br_mdb_entry_t *mcge;
+	struct mcg_shadow_t *sh;
+	struct mcastpa_join_leave_t mjl;
+	int rejoin;
+	int i;
+
+	list_for_each(hpos, &mcastpa.mcg_head) {
+		head = (struct mcg_br_head_t *) list_entry(hpos, struct mcg_br_head_t, mcg_head);
+		if (mcg_br_entry_mjl_init(head, &mjl) < 0)
+			continue;	/* no video src - nothing should be programmed */
+		rejoin = 0;
+		list_for_each(pos, &head->mcg_entry) {
+			mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
+			mcg_br_entry_srcmac_set(mcge, &mjl);
+			mjl.lan_ifindex = mcge->ifindex;
+			if ((mcge->joined == 1) && (mcg_shadow_get(&mjl) == NULL)) {
+				mcg_br_entry_joined_set(mcge, 0);
+				mcastpa.reconcile_joins++;
+				rejoin = 1;
+			} else if ((mcge->joined == 0) && (mcge->retries >= RETRY_ATTEMPTS)) {
+				mcastpa.reconcile_joins++;
+				rejoin = 1;
+			}
+		}
+		if (rejoin)
+			mcg_br_entry_join(head);
+	}
+
+	for (i = 0; i < SHADOW_HASH_SIZE; i++) {
+		list_for_each_safe(pos, q, &mcastpa.shadow_hash[i]) {
+			sh = (struct mcg_shadow_t *) list_entry(pos, struct mcg_shadow_t, hash);
+			mcge = mcg_br_entry_get_mjl(&sh->mjl);
+			if ((mcge != NULL) && (mcge->joined == 1))
+				continue;
+			/* the shadow entry goes when the driver confirms the leave */
+			mcastpa.reconcile_leaves++;
+			mcg_pq_put(MCAST_PQ_LEAVE, &sh->mjl, mcge, 0);
+		}
+	}
+}
+
+/**
+ * @brief periodic reconciliation of the group table and the accelerator
+ * @details the shadow check only runs when the programming queue and retry list are idle - a
+ * @details request is in flight until its result was read, so the shadow holds every result
+ * @note the kernel mdb is redumped on its own, longer, --redump interval
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_reconcile(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &mcastpa.reconcile_due);
+	mcastpa.reconcile_due.tv_sec += mcastpa.params.reconcile;
+	mcastpa.reconciles++;
+
+	/* reading the results can empty the queue - depth 0 means no result is left unread */
+	mcg_retry_results();
+	if ((mcast_pq_depth(&mcastpa.pq) == 0) && list_empty(&mcastpa.retry_list))
+		mcg_reconcile_shadow();
+	else
+		mcastpa.reconcile_deferred++;
+}
+
+/**
+ * @brief ms until the next reconciliation pass
+ * @returns -1 if reconciliation is disabled
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcg_reconcile_timeout(void)
+{
+	struct timespec now;
+	long ms;
+
+	if (mcastpa.params.reconcile <= 0)
+		return (-1);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (mcastpa.reconcile_due.tv_sec - now.tv_sec) * 1000 +
+	    (mcastpa.reconcile_due.tv_nsec - now.tv_nsec) / 1000000;
+	return (ms < 0 ? 0 : ms);
+}
+
+/**
+ * @brief ms until the next periodic redump
+ * @returns -1 if periodic redumps are disabled
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcg_redump_timeout(void)
+{
+	struct timespec now;
+	long ms;
+
+	if (mcastpa.params.redump <= 0)
+		return (-1);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (mcastpa.redump_due.tv_sec - now.tv_sec) * 1000 +
+	    (mcastpa.redump_due.tv_nsec - now.tv_nsec) / 1000000;
+	return (ms < 0 ? 0 : ms);
+}
+
+/**
+ * @brief earliest of two poll timeouts
+ * @returns -1 if neither is set
+ * @author tim.hayes@smartrg.com
+ */
+static inline int
+mcast_timeout_min(int a, int b)
+{
+	if (a < 0)
+		return (b);
+	if ((b >= 0) && (b < a))
+		return (b);
+	return (a);
+}
+
+/**
+ * @brief dispatches one buffer of netlink messages
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_nl_input(struct sockaddr_nl *nladdr, char *buf, int status)
+{
+	struct nlmsghdr *h;
+
+	mcast_trace(MT_NL_RECV, 0, NULL, 0, NULL, 0, status);
+	/* requests queued while this buffer is applied get its receive time */
+	mcastpa.pq.rx_ns = mcast_hist_now();
+	for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, status); h = NLMSG_NEXT(h, status)) {
+		mcast_trace(MT_NL_MSG, 0, NULL, 0, NULL, 0, h->nlmsg_type);
+		mcast_nlrec_write(h, 0, mcastpa.pq.rx_ns);
+		do_monitor_msg(nladdr, h, NULL);
+	}
+	mcast_nlrec_flush();
+	mcastpa.pq.rx_ns = 0;
+}
+
+/**
+ * @brief receives and dispatches one buffer of netlink messages
+ * @details same as libnetlink rtnl_listen() but returns after each read
+ * @returns 0 if OK -1 on a fatal socket error
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcast_nl_recv(void)
+{
+	struct sockaddr_nl nladdr;
+	struct iovec iov;
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof (nladdr),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	static char buf[16384];
+	int status;
+
+	iov.iov_base = buf;
+	iov.iov_len = sizeof (buf);
+	status = recvmsg(rth.fd, &msg, MSG_DONTWAIT);
+	if (status < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return (0);
+		if (errno == ENOBUFS) {
+			/* the kernel dropped messages - the socket itself is fine */
+			if (mcastpa.nl_overflows++ == 0)
+				syslog(LOG_NOTICE, "%s:%d netlink overflow - resyncing\n", __FUNCTION__, __LINE__);
+			mcastpa.resync = 1;
+			mcast_trace(MT_NL_OVERFLOW, 0, NULL, 0, NULL, 0, mcastpa.nl_overflows);
+			mcast_nlrec_write(NULL, MCAST_NLREC_OVERFLOW, 0);
+			return (0);
+		}
+		syslog(LOG_NOTICE, "%s:%d netlink receive error %s (%d)\n", __FUNCTION__, __LINE__, strerror(errno),
+		       errno);
+		return (-1);
+	}
+	if (status == 0) {
+		syslog(LOG_NOTICE, "%s:%d EOF on netlink\n", __FUNCTION__, __LINE__);
+		return (-1);
+	}
+
+	mcast_nl_input(&nladdr, buf, status);
+	return (0);
+}
+
+/**
+ * @brief publishes the group, member and interface tables to the shared memory snapshot
+ * @details groups in list order with their members contiguous - replaces the text dump
+ * @details SIGUSR1 used to write to /tmp/mcastpa-dump
+ * @note netlink thread only - it is the only writer of the tables and of the snapshot
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcg_snap_publish(void)
+{
+	struct mcast_snap_shm_t *shm;
+	struct mcast_snap_buf_t *buf;
+	struct mcast_snap_group_t *g;
+	struct mcast_snap_member_t *m;
+	struct mcast_snap_if_t *sif;
+	struct list_head *hpos;
+	struct list_head *pos;
+	struct mcg_br_head_t *head;
+	struct mcg_br_mdb_entry_t *mcge;
+	uint32_t groups = 0;
+	uint32_t members = 0;
+	uint32_t ifs = 0;
+	int i;
+
+	if (!mcastpa.snap)
+		return;
+	buf = mcast_snap_begin(&shm);
+	g = mcast_snap_groups(shm, buf);
+	m = mcast_snap_members(shm, buf);
+	sif = mcast_snap_ifs(shm, buf);
+
+	/* the segment is sized for the pools so neither count can run over */
+	list_for_each(hpos, &mcastpa.mcg_head) {
+		head = (struct mcg_br_head_t *) list_entry(hpos, struct mcg_br_head_t, mcg_head);
+		memset(g, 0, sizeof (*g));
+		g->family = (head->addr.proto == htons(ETH_P_IP)) ? AF_INET : AF_INET6;
+		memcpy(g->group, &head->addr.u, g->family == AF_INET ? 4 : 16);
+		g->src_family = head->src.family;
+		if (head->src.family != AF_UNSPEC)
+			memcpy(g->src, &head->src.u, head->src.family == AF_INET ? 4 : 16);
+		g->ifindex = head->ifindex;
+		g->br_ifindex = head->br_ifindex;
+		g->wan_ifindex = head->wan_ifindex;
+		g->sw_members = head->sw_members;
+		g->sw_ms = head->sw_ms;
+		g->first = members;
+		list_for_each(pos, &head->mcg_entry) {
+			mcge = (struct mcg_br_mdb_entry_t *) list_entry(pos, struct mcg_br_mdb_entry_t, mcg_entry);
+			m->group = groups;
+			m->ifindex = mcge->ifindex;
+			memcpy(m->mac, mcge->srcmac, ETH_ALEN);
+			m->flags = (mcge->joined ? MCAST_SNAP_JOINED : 0) | (mcge->retries ? MCAST_SNAP_SOFTWARE : 0) |
+			    (mcge->local ? MCAST_SNAP_LOCAL : 0) | (mcge->parked ? MCAST_SNAP_PARKED : 0);
+			m->retries = mcge->retries;
+			m++;
+			members++;
+		}
+		g->members = members - g->first;
+		g++;
+		groups++;
+	}
+	for (i = 0; (i < mcastpa.iftab_size) && (ifs < shm->max_ifs); i++) {
+		if (!mcastpa.iftab[i].valid)
+			continue;
+		sif->ifindex = i;
+		sif->role = mcastpa.iftab[i].role;
+		sif->master = mcastpa.iftab[i].master;
+		sif->flags = mcastpa.iftab[i].flags;
+		memcpy(sif->name, mcastpa.iftab[i].name, sizeof (sif->name));
+		sif++;
+		ifs++;
+	}
+	buf->groups = groups;
+	buf->members = members;
+	buf->ifs = ifs;
+	mcast_snap_commit(buf);
+
+	mcastpa.snap_dirty = 0;
+	clock_gettime(CLOCK_MONOTONIC, &mcastpa.snap_due);
+	mcastpa.snap_due.tv_sec += mcastpa.params.snap_interval / 1000;
+	mcastpa.snap_due.tv_nsec += (mcastpa.params.snap_interval % 1000) * 1000000;
+	if (mcastpa.snap_due.tv_nsec >= 1000000000) {
+		mcastpa.snap_due.tv_sec++;
+		mcastpa.snap_due.tv_nsec -= 1000000000;
+	}
+}
+
+/**
+ * @brief ms until the snapshot should be published
+ * @details a publish is due snap_interval after the last one once the tables changed
+ * @returns -1 if nothing changed or the snapshot is off, 0 if due
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcg_snap_timeout(void)
+{
+	struct timespec now;
+	long ms;
+
+	if (!mcastpa.snap || !mcastpa.snap_dirty)
+		return (-1);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (mcastpa.snap_due.tv_sec - now.tv_sec) * 1000 + (mcastpa.snap_due.tv_nsec - now.tv_nsec) / 1000000;
+	return (ms < 0 ? 0 : ms);
+}
+
+/**
+ * @brief runs whatever is due after netlink input
+ * @details resync, driver results, end of the coalescing window, retries, reconciliation and
+ * @details the snapshot
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_nl_service(int results)
+{
+	if (mcastpa.resync)
+		mcg_resync(0);
+	if (results)
+		mcg_retry_results();
+	if (mcg_zap_timeout() == 0)
+		mcg_zap_flush();
+	if (mcg_retry_timeout() == 0)
+		mcg_retry_run();
+	if (mcg_reconcile_timeout() == 0)
+		mcg_reconcile();
+	if (mcg_redump_timeout() == 0)
+		mcg_resync(1);
+	if (mcg_snap_timeout() == 0)
+		mcg_snap_publish();
+}
+
+/**
+ * @brief netlink socket readable
+ * @details one read per wakeup - the loop comes back while more is queued
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_nl_event(int fd, uint32_t events, void *arg)
+{
+	if (mcast_nl_recv() < 0)
+		mcast_loop_stop(&mcastpa.loop, -1);
+}
+
+/**
+ * @brief driver results queued by the programming worker
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_pq_event(int fd, uint32_t events, void *arg)
+{
+	mcg_retry_results();
+}
+
+/**
+ * @brief zap, retry, reconcile or snapshot deadline reached
+ * @details the work itself is done by mcast_loop_service()
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_timer_event(int fd, uint32_t events, void *arg)
+{
+	mcast_loop_timer_read(fd);
+	mcastpa.timer_due = 0;
+}
+
+/**
+ * @brief 1 second tick
+ * @details
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_tick_event(int fd, uint32_t events, void *arg)
+{
+	mcastpa.timer_tick += mcast_loop_timer_read(fd);
+	mcastpa.last_time = mcastpa.current_time;
+	clock_gettime(CLOCK_MONOTONIC, &mcastpa.current_time);
+}
+
+/**
+ * @brief signals taken from the signalfd
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_sig_event(int fd, uint32_t events, void *arg)
+{
+	struct signalfd_siginfo si;
 
+	while (read(fd, &si, sizeof (si)) == sizeof (si))
+		mcast_sig_handler(si.ssi_signo);
 }
 
 /**
- * @brief  initialize our lan mdb knowledge
- * @details
+ * @brief runs after every wakeup of the main loop
+ * @details does whatever is due and moves the deadline timer to the next deadline - a
+ * @details deadline later than the armed one only costs an early wakeup, so the timer is
+ * @details moved forward only
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-static int
-mdb_parse_init(void)
+static void
+mcast_loop_service(void)
 {
-
-	if (rtnl_wilddump_request(&rth, PF_BRIDGE, RTM_GETMDB) < 0) {
-		syslog(LOG_INFO, "Cannot send RTM_GETMDG dump request\n");
-		return 1;
-	}
-
-	if (rtnl_dump_filter(&rth, parse_mdb, 0) < 0) {
-		syslog(LOG_INFO, "Dump terminated\n");
-		return 1;
-	}
-	return 0;
+	uint64_t now;
+	uint64_t due;
+	int timeout;
+
+	mcast_nl_service(0);
+	timeout = mcast_timeout_min(mcg_zap_timeout(), mcg_retry_timeout());
+	timeout = mcast_timeout_min(timeout, mcg_reconcile_timeout());
+	timeout = mcast_timeout_min(timeout, mcg_redump_timeout());
+	timeout = mcast_timeout_min(timeout, mcg_snap_timeout());
+	if (timeout < 0)
+		return;
+	now = mcast_hist_now();
+	due = now + (uint64_t) timeout * 1000000;
+	if ((mcastpa.timer_due > now) && (mcastpa.timer_due <= due))
+		return;
+	if (mcast_loop_timer_set(&mcastpa.loop, mcastpa.timer_fd, due, 0) == 0)
+		mcastpa.timer_due = due;
 }
 
 /**
- * @brief handle any vsa requests 
- * @details
+ * @brief sets the netlink receive buffer
+ * @details SO_RCVBUFFORCE goes past rmem_max when running as root
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
  * @callergraph
  */
-static int
-vsa_parse_init(void)
+static void
+mcast_nl_rcvbuf(int fd, int size)
 {
-	mcast_vsa_get();
-	if (mcastpa.params.vsa.valid) {
-		vsa_entry_process();
-	}
-	return 0;
+	if (size <= 0)
+		return;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof (size)) < 0 &&
+	    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof (size)) < 0)
+		syslog(LOG_NOTICE, "%s:%d cannot set rcvbuf %d %s\n", __FUNCTION__, __LINE__, size, strerror(errno));
 }
 
 /**
@@ -2101,19 +4242,58 @@ do_monitor(void)
 
 	unsigned groups = 0;
 	struct mcastpa_system_init_t msi;
+	sigset_t sigs;
+
+	/* before the backend and the worker start their threads so they inherit the mask */
+	if (mcast_loop_init(&mcastpa.loop, mcast_loop_service) < 0)
+		return (-1);
+	sigemptyset(&sigs);
+	sigaddset(&sigs, SIGINT);
+	sigaddset(&sigs, SIGTERM);
+	sigaddset(&sigs, SIGQUIT);
+	sigaddset(&sigs, SIGUSR1);
+	sigaddset(&sigs, SIGUSR2);
+	if (mcast_loop_signals(&mcastpa.loop, &sigs, mcast_sig_event, NULL) < 0)
+		return (-1);
 
 	memset(&msi, 0, sizeof (struct mcastpa_system_init_t));
-	pa_init(&msi);
+	if (mcastpa.pa->init(&msi) < 0)
+		syslog(LOG_ERR, "%s:%d backend %s init failed\n", __FUNCTION__, __LINE__, mcastpa.pa->name);
+
+	if (mcast_trace_init() < 0)
+		syslog(LOG_NOTICE, "%s:%d event trace disabled\n", __FUNCTION__, __LINE__);
+
+	/* before the first dump so a replay starts from the same state */
+	if (mcastpa.params.nl_record != NULL)
+		mcast_nlrec_open(mcastpa.params.nl_record);
+
+	/* started here and not in main() so it survives daemonizing */
+	if (mcast_pq_init(&mcastpa.pq, "driver", mcastpa.pa, MCAST_PQ_SIZE_DEFAULT, mcastpa.params.pa_rate,
+			  mcastpa.params.pa_burst) < 0)
+		return (-1);
 
 	groups |= nl_mgrp(RTNLGRP_IPV4_MROUTE);
+	groups |= nl_mgrp(RTNLGRP_IPV6_MROUTE);
 	groups |= nl_mgrp(RTNLGRP_MDB);
-	groups |= nl_mgrp(RTNLGRP_IPV4_ROUTE);
+	groups |= nl_mgrp(RTNLGRP_IPV4_IFADDR);
+	groups |= nl_mgrp(RTNLGRP_IPV6_IFADDR);
+	groups |= nl_mgrp(RTNLGRP_LINK);
+	groups |= nl_mgrp(RTNLGRP_NEIGH);
 
 	if (rtnl_open(&rth, groups) < 0)
 		return (-1);
+	if (rtnl_open(&rth_dump, 0) < 0)
+		return (-1);
+	mcast_nl_rcvbuf(rth.fd, mcastpa.params.rcvbuf);
 
 	ll_init_map(&rth);
 
+	syslog(LOG_INFO, "%s \n", "========= mcast_if_parse_init ===========");
+	mcast_if_parse_init();
+
+	if (mcastpa.params.wan_ifindex == 0)
+		mcastpa.params.wan_ifindex = ll_name_to_index(mcast_wan_entry_default());
+
 	/* get existing state and possibly push flows from the initial state */
 
 	/* order is important */
@@ -2126,24 +4306,46 @@ do_monitor(void)
 	}
 #endif
 
-	syslog(LOG_INFO, "%s \n", "========= iproute_parse_init ===========");
-	iproute_parse_init();
+	syslog(LOG_INFO, "%s \n", "========= addr_parse_init ===========");
+	addr_parse_init();
 
 	syslog(LOG_INFO, "%s \n", "========= mdb_parse_init ===========");
-	mdb_parse_init();
+	mdb_parse_init(&rth);
 
 	syslog(LOG_INFO, "%s \n", "========= route_parse_init ===========");
-	mroute_parse_init();
-
-	syslog(LOG_INFO, "%s \n", "========= vsa_parse_init ===========");
-	vsa_parse_init();
+	mroute_parse_init(&rth);
 
 	syslog(LOG_INFO, "%s \n", "========= monitoring mcast ... ===========");
 
-	if (rtnl_listen(&rth, do_monitor_msg, NULL) < 0)
+	mcastpa.zap_enabled = (mcastpa.params.zap_window > 0);
+	clock_gettime(CLOCK_MONOTONIC, &mcastpa.reconcile_due);
+	mcastpa.reconcile_due.tv_sec += mcastpa.params.reconcile;
+	clock_gettime(CLOCK_MONOTONIC, &mcastpa.redump_due);
+	mcastpa.redump_due.tv_sec += mcastpa.params.redump;
+
+	if ((mcast_loop_add(&mcastpa.loop, rth.fd, mcast_nl_event, NULL) < 0) ||
+	    (mcast_loop_add(&mcastpa.loop, mcast_pq_fd(&mcastpa.pq), mcast_pq_event, NULL) < 0))
+		return (-1);
+	mcastpa.timer_fd = mcast_loop_timer(&mcastpa.loop, mcast_timer_event, NULL);
+	mcastpa.tick_fd = mcast_loop_timer(&mcastpa.loop, mcast_tick_event, NULL);
+	if ((mcastpa.timer_fd < 0) || (mcastpa.tick_fd < 0))
 		return (-1);
+	/* after the initial dumps so requests see the current table */
+	if (mcast_ctl_init(&mcastpa.ctl, &mcastpa.loop, mcastpa.params.ctl_path, mcastpa_ctl) < 0)
+		syslog(LOG_NOTICE, "%s:%d control socket disabled\n", __FUNCTION__, __LINE__);
+	if (mcastpa.params.snap_interval > 0) {
+		if (mcast_snap_init(mcastpa.params.max_groups, mcastpa.params.max_members, MCAST_SNAP_IFS) == 0) {
+			mcastpa.snap = 1;
+			mcg_snap_publish();
+		} else {
+			syslog(LOG_NOTICE, "%s:%d snapshot disabled\n", __FUNCTION__, __LINE__);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &mcastpa.start_time);
+	mcastpa.current_time = mcastpa.start_time;
+	mcast_loop_timer_set(&mcastpa.loop, mcastpa.tick_fd, mcast_hist_now() + 1000000000ULL, 1000);
 
-	return 0;
+	return (mcast_loop_run(&mcastpa.loop));
 }
 
 /**
@@ -2179,7 +4381,7 @@ do_wait_wan(char *name)
 
 /**
  * @brief sighandler 
- * @details
+ * @details called from the main loop with the signals read from its signalfd
  * @note
  * @author tim.hayes@smartrg.com
  * @callgraph
@@ -2195,17 +4397,16 @@ mcast_sig_handler(int signo)
 	case SIGINT:
 	case SIGTERM:
 		syslog(LOG_INFO, "%s:%d quit or kill %d", __FUNCTION__, __LINE__, signo);
-		exit(0);
+		mcast_loop_stop(&mcastpa.loop, 0);
+		break;
 	case SIGUSR1:
-		mcg_br_entry_head_list_show();
+		/* used to write /tmp/mcastpa-dump - now publishes the snapshot at once */
+		mcg_snap_publish();
 		break;
 	case SIGUSR2:
-		syslog(LOG_INFO, "%s:%d before vsa_entry_process", __FUNCTION__, __LINE__);
-		mcast_vsa_get();
-		if (mcastpa.params.vsa.valid) {
-			vsa_entry_process();
-		}
-		syslog(LOG_INFO, "%s:%d after vsa_entry_process", __FUNCTION__, __LINE__);
+		/* used to read /tmp/vsapa.cfg - still caught so an old script does not kill us */
+		syslog(LOG_NOTICE, "%s:%d SIGUSR2 ignored - use the control socket %s\n", __FUNCTION__, __LINE__,
+		       mcastpa.params.ctl_path);
 		break;
 	}
 }
@@ -2348,6 +4549,26 @@ mcastpa_usage(void)
 	printf(" --bridge set to bridged mode \n");
 	printf(" --exp experimental code segment testing\n");
 	printf(" --nowifi don't push wifi to packet accellerator\n");
+	printf(" --max-groups <n> mc groups preallocated (default %d)\n", MCG_MAX_GROUPS_DEFAULT);
+	printf(" --max-members <n> mc group members preallocated (default %d)\n", MCG_MAX_MEMBERS_DEFAULT);
+	printf(" --pa-rate <n> cap on driver requests per second, 0 for none - slowed on driver errors (default %d)\n",
+	       MCAST_PQ_RATE_DEFAULT);
+	printf(" --pa-burst <n> driver requests sent back to back once paced (default %d)\n", MCAST_PQ_BURST_DEFAULT);
+	printf(" --reconcile <s> seconds between reconciliation passes, 0 to disable (default %d)\n",
+	       RECONCILE_DEFAULT);
+	printf(" --redump <s> seconds between kernel mdb redumps, 0 to redump only after overflow (default %d)\n",
+	       REDUMP_DEFAULT);
+	printf(" --rcvbuf <bytes> netlink receive buffer (default %d)\n", NL_RCVBUF_DEFAULT);
+	printf(" --zap-window <ms> coalesce mdb events for up to ms, 0 to disable (default %d)\n", ZAP_WINDOW_DEFAULT);
+	printf(" --backend <name> accelerator backend (default %s) one of: ", mcast_pa_ops_get(NULL)->name);
+	mcast_pa_ops_list(stdout);
+	printf(" --pa-record <file> requests written by the record backend (default /tmp/mcastpa-record)\n");
+	printf(" --nl-record <file> record every netlink message received\n");
+	printf(" --nl-replay <file> run a --nl-record file through the engine and exit\n");
+	printf(" --replay-speed <x> replay time scale, 1 real time, 0 as fast as possible (default 0)\n");
+	printf(" --ctl <path> control socket for mcastpa-ctl (default %s)\n", MCAST_CTL_PATH);
+	printf(" --snap-interval <ms> min ms between snapshots for mcastpa-snap, 0 to disable (default %d)\n",
+	       SNAP_INTERVAL_DEFAULT);
 }
 
 static struct option long_options[] = {
@@ -2359,9 +4580,413 @@ static struct option long_options[] = {
 	{"src", required_argument, 0, 's'},
 	{"exp", no_argument, 0, 'x'},
 	{"nowifi", no_argument, 0, 'n'},
+	{"max-groups", required_argument, 0, 'G'},
+	{"max-members", required_argument, 0, 'M'},
+	{"zap-window", required_argument, 0, 'Z'},
+	{"pa-rate", required_argument, 0, 'R'},
+	{"pa-burst", required_argument, 0, 'B'},
+	{"rcvbuf", required_argument, 0, 'N'},
+	{"reconcile", required_argument, 0, 'C'},
+	{"redump", required_argument, 0, 'D'},
+	{"backend", required_argument, 0, 'P'},
+	{"pa-record", required_argument, 0, 'Q'},
+	{"nl-record", required_argument, 0, 'L'},
+	{"nl-replay", required_argument, 0, 'Y'},
+	{"replay-speed", required_argument, 0, 'T'},
+	{"ctl", required_argument, 0, 'K'},
+	{"snap-interval", required_argument, 0, 'I'},
 	{0, 0, 0, 0}
 };
 
+/**
+ * @brief sets the defaults and empties all lists and hash tables
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcastpa_init(void)
+{
+	int i;
+
+	memset(&mcastpa, 0, sizeof (struct mcastpa_t));
+	mcastpa.params.zap_window = ZAP_WINDOW_DEFAULT;
+	mcastpa.params.pa_rate = MCAST_PQ_RATE_DEFAULT;
+	mcastpa.params.pa_burst = MCAST_PQ_BURST_DEFAULT;
+	mcastpa.params.rcvbuf = NL_RCVBUF_DEFAULT;
+	mcastpa.params.reconcile = RECONCILE_DEFAULT;
+	mcastpa.params.redump = REDUMP_DEFAULT;
+	mcastpa.params.snap_interval = SNAP_INTERVAL_DEFAULT;
+
+	INIT_LIST_HEAD(&mcastpa.mcg_head);
+	for (i = 0; i < MCG_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mcastpa.mcg_hash[i]);
+	for (i = 0; i < MBR_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mcastpa.mbr_hash[i]);
+	for (i = 0; i < PORT_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mcastpa.port_hash[i]);
+	for (i = 0; i < MAC_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mcastpa.mac_hash[i]);
+	INIT_LIST_HEAD(&mcastpa.zap_list);
+	INIT_LIST_HEAD(&mcastpa.retry_list);
+	INIT_LIST_HEAD(&mcastpa.capacity_wait);
+	for (i = 0; i < SHADOW_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mcastpa.shadow_hash[i]);
+	pthread_rwlock_init(&mcastpa.iftab_lock, NULL);
+	for (i = 0; i < ZAP_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mcastpa.zap_hash[i]);
+	for (i = 0; i < IP_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mcastpa.ip_hash[i]);
+	INIT_LIST_HEAD(&mcastpa.wan_head);
+	INIT_LIST_HEAD(&mcastpa.br_ports);
+	mcastpa.loop.epfd = -1;
+	mcastpa.timer_fd = -1;
+	mcastpa.tick_fd = -1;
+	mcastpa.ctl.fd = -1;
+	mcastpa.params.ctl_path = MCAST_CTL_PATH;
+}
+
+/**
+ * @brief allocates the group, member, zap, retry and shadow pools
+ * @details sizes not given on the command line get their defaults
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcastpa_pools_init(void)
+{
+	if (mcastpa.params.max_groups == 0)
+		mcastpa.params.max_groups = MCG_MAX_GROUPS_DEFAULT;
+	if (mcastpa.params.max_members == 0)
+		mcastpa.params.max_members = MCG_MAX_MEMBERS_DEFAULT;
+	if (mcast_pool_init(&mcastpa.head_pool, "group", sizeof (struct mcg_br_head_t), mcastpa.params.max_groups) ||
+	    mcast_pool_init(&mcastpa.mbr_pool, "member", sizeof (struct mcg_br_mdb_entry_t),
+			    mcastpa.params.max_members) ||
+	    mcast_pool_init(&mcastpa.zap_pool, "zap", sizeof (struct mcg_zap_t), ZAP_MAX_PENDING) ||
+	    mcast_pool_init(&mcastpa.retry_pool, "retry", sizeof (struct mcg_retry_t), RETRY_MAX_PENDING) ||
+	    mcast_pool_init(&mcastpa.shadow_pool, "shadow", sizeof (struct mcg_shadow_t),
+			    mcastpa.params.max_members))
+		return (-1);
+	return (0);
+}
+
+#ifdef MCAST_PA_BENCH
+/**
+ * @brief sets up the engine for mcast-pa-bench
+ * @details same tables, pools and programming worker as the daemon - no netlink socket,
+ * @details every group uses srcip so joins do not wait for an mroute
+ * @returns 0 if OK -1 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcastpa_bench_init(struct mcastpa_bench_params_t *bp)
+{
+	mcastpa_init();
+	mcastpa.params.zap_window = bp->zap_window;
+	mcastpa.params.pa_rate = bp->pa_rate;
+	mcastpa.params.pa_burst = bp->pa_burst;
+	mcastpa.params.max_groups = bp->max_groups;
+	mcastpa.params.max_members = bp->max_members;
+	mcastpa.params.reconcile = 0;
+	mcastpa.params.redump = 0;
+	mcastpa.params.use_src = 1;
+	mcastpa.params.src_addr = bp->src;
+	if (mcastpa_pools_init() < 0)
+		return (-1);
+	mcastpa.pa = bp->pa;
+	if (mcastpa.pa->init(NULL) < 0)
+		return (-1);
+	if (mcast_pq_init(&mcastpa.pq, "driver", mcastpa.pa, bp->pq_size ? bp->pq_size : MCAST_PQ_SIZE_DEFAULT,
+			  mcastpa.params.pa_rate, mcastpa.params.pa_burst) < 0)
+		return (-1);
+	mcastpa.zap_enabled = 1;
+	return (0);
+}
+
+/**
+ * @brief hands one buffer of synthetic netlink messages to the engine
+ * @details as if read from the netlink socket, followed by whatever became due
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcastpa_bench_input(char *buf, int len)
+{
+	struct sockaddr_nl nladdr;
+
+	memset(&nladdr, 0, sizeof (nladdr));
+	nladdr.nl_family = AF_NETLINK;
+	if (len > 0)
+		mcast_nl_input(&nladdr, buf, len);
+	mcast_nl_service(1);
+}
+
+/**
+ * @brief ms until the engine has something to do without input
+ * @returns -1 if nothing is pending
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcastpa_bench_timeout(void)
+{
+	int timeout;
+
+	timeout = mcast_timeout_min(mcg_zap_timeout(), mcg_retry_timeout());
+	if (mcast_pq_depth(&mcastpa.pq))
+		timeout = mcast_timeout_min(timeout, 1);
+	return (timeout);
+}
+
+/**
+ * @brief shows the engine counters and latency histograms
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcastpa_bench_show(FILE * f)
+{
+	mcastpa_stats_show(f);
+}
+
+/**
+ * @brief adds or refreshes one member as an RTM_NEWMDB would
+ * @details cache_mdb_entry() without the checks and logging that do not touch the table
+ * @returns 0 if OK -1 if a pool is exhausted
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcastpa_bench_table_add(int br_ifindex, struct br_mdb_entry *e)
+{
+	struct mcg_br_head_t *head;
+	struct mcg_br_mdb_entry_t *mcge;
+
+	head = mcg_br_entry_head_get(e);
+	if (head == NULL)
+		head = mcg_br_entry_head_add(e);
+	if (head == NULL)
+		return (-1);
+	head->br_ifindex = br_ifindex;
+	mcge = mcg_br_entry_get(head, e);
+	if (mcge == NULL)
+		mcge = mcg_br_entry_add(head, e);
+	if (mcge == NULL) {
+		if (list_empty(&head->mcg_entry))
+			mcg_br_entry_head_del(head);
+		return (-1);
+	}
+	mcge->gen = mcastpa.mdb_gen;
+	if (mcge->joined == 0)
+		mcg_br_entry_join(head);
+	return (0);
+}
+
+/**
+ * @brief removes one member as an RTM_DELMDB would
+ * @returns 0 if OK -ENOENT if not a member
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcastpa_bench_table_del(struct br_mdb_entry *e)
+{
+	struct mcg_br_head_t *head;
+
+	head = mcg_br_entry_head_get(e);
+	if ((head == NULL) || (mcg_br_entry_get(head, e) == NULL))
+		return (-ENOENT);
+	mcg_br_entry_leave(head, e);
+	if (list_empty(&head->mcg_entry))
+		mcg_br_entry_head_del(head);
+	return (0);
+}
+
+/**
+ * @brief leaves and removes every group as the daemon does on exit
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcastpa_bench_table_teardown(void)
+{
+	mcg_br_entry_head_list_del_all();
+}
+
+/**
+ * @brief group and member pool allocations so far
+ * @author tim.hayes@smartrg.com
+ */
+unsigned long long
+mcastpa_bench_allocs(void)
+{
+	return (mcastpa.head_pool.allocs + mcastpa.mbr_pool.allocs);
+}
+
+/**
+ * @brief stops the programming worker after it drained the queue
+ * @details and releases the pools so mcastpa_bench_init() can run again
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcastpa_bench_deinit(void)
+{
+	mcg_zap_flush();
+	mcast_pq_deinit(&mcastpa.pq);
+	mcastpa.pa->deinit(NULL);
+	mcast_pool_deinit(&mcastpa.head_pool);
+	mcast_pool_deinit(&mcastpa.mbr_pool);
+	mcast_pool_deinit(&mcastpa.zap_pool);
+	mcast_pool_deinit(&mcastpa.retry_pool);
+	mcast_pool_deinit(&mcastpa.shadow_pool);
+	mcast_br_ports_free_all();
+}
+#else
+/**
+ * @brief waits until a replayed message is due
+ * @details keeps serving driver results, retries and the coalescing window meanwhile
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_replay_wait(uint64_t due)
+{
+	struct pollfd pfd;
+	uint64_t now;
+	int timeout;
+
+	pfd.fd = mcast_pq_fd(&mcastpa.pq);
+	pfd.events = POLLIN;
+	while ((now = mcast_hist_now()) < due) {
+		timeout = (due - now + 999999) / 1000000;
+		timeout = mcast_timeout_min(timeout, mcg_zap_timeout());
+		timeout = mcast_timeout_min(timeout, mcg_retry_timeout());
+		pfd.revents = 0;
+		if (poll(&pfd, 1, timeout) < 0 && errno != EINTR)
+			return;
+		mcast_nl_service(pfd.revents & POLLIN);
+	}
+}
+
+/**
+ * @brief feeds a --nl-record file through the engine instead of a netlink socket
+ * @details dump replies go straight to the handlers, events through the same path
+ * @details as a socket read, resync markers replay the sweep after the mdb dump that
+ * @details followed them - with replay_speed 0 the coalescing window is closed on the
+ * @details recorded time stamps, so the outcome does not depend on how fast this host runs
+ * @returns 0 if OK -1 otherwise
+ * @note reconciliation is off - it depends on wall clock and on driver results only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+do_replay(void)
+{
+	static char buf[MCAST_NLREC_MSG_MAX];
+	struct mcast_nlrec_t rec;
+	struct mcastpa_system_init_t msi;
+	struct sockaddr_nl nladdr;
+	struct nlmsghdr *n = (struct nlmsghdr *) buf;
+	uint64_t start;
+	uint64_t last = 0;
+	uint64_t zap_ns = 0;
+	uint64_t count = 0;
+	int sweep = 0;
+	FILE *f;
+
+	f = mcast_nlrec_open_read(mcastpa.params.nl_replay);
+	if (f == NULL) {
+		printf("cannot replay %s\n", mcastpa.params.nl_replay);
+		return (-1);
+	}
+
+	memset(&msi, 0, sizeof (struct mcastpa_system_init_t));
+	if (mcastpa.pa->init(&msi) < 0)
+		syslog(LOG_ERR, "%s:%d backend %s init failed\n", __FUNCTION__, __LINE__, mcastpa.pa->name);
+	mcastpa.params.reconcile = 0;
+	mcastpa.params.redump = 0;
+	if (mcast_pq_init(&mcastpa.pq, "driver", mcastpa.pa, MCAST_PQ_SIZE_DEFAULT, mcastpa.params.pa_rate,
+			  mcastpa.params.pa_burst) < 0) {
+		fclose(f);
+		return (-1);
+	}
+
+	memset(&nladdr, 0, sizeof (nladdr));
+	nladdr.nl_family = AF_NETLINK;
+	start = mcast_hist_now();
+	while (mcast_nlrec_read(f, &rec, buf, sizeof (buf))) {
+		if (sweep && !((rec.flags & MCAST_NLREC_DUMP) && (n->nlmsg_type == RTM_GETMDB))) {
+			mcg_resync_sweep();
+			sweep = 0;
+		}
+		if (mcastpa.params.replay_speed > 0) {
+			mcast_replay_wait(start + (uint64_t) (rec.ns / mcastpa.params.replay_speed));
+		} else {
+			/* the window closes on recorded time, measured from its first event */
+			if ((rec.ns - zap_ns) >= (uint64_t) mcastpa.params.zap_window * 1000000)
+				mcg_zap_flush();
+			mcg_retry_results();
+		}
+		last = rec.ns;
+
+		if (rec.flags & MCAST_NLREC_OVERFLOW) {
+			mcastpa.nl_overflows++;
+		} else if (rec.flags & (MCAST_NLREC_RESYNC | MCAST_NLREC_REDUMP)) {
+			if (rec.flags & MCAST_NLREC_RESYNC)
+				mcastpa.resyncs++;
+			else
+				mcastpa.redumps++;
+			mcg_zap_flush();
+			mcastpa.mdb_gen++;
+			sweep = 1;
+		} else if (rec.flags & MCAST_NLREC_DUMP) {
+			do_monitor_msg(&nladdr, n, NULL);
+		} else {
+			/* the initial dumps are done once the first event shows up */
+			mcastpa.zap_enabled = (mcastpa.params.zap_window > 0);
+			if (list_empty(&mcastpa.zap_list))
+				zap_ns = rec.ns;
+			mcast_nl_input(&nladdr, buf, rec.len);
+		}
+		count++;
+	}
+	fclose(f);
+
+	if (sweep)
+		mcg_resync_sweep();
+	mcg_zap_flush();
+	while (mcast_pq_depth(&mcastpa.pq) > 0 || !list_empty(&mcastpa.retry_list)) {
+		mcast_replay_wait(mcast_hist_now() + 10000000);
+		mcg_retry_results();
+	}
+
+	printf("replayed %llu records in %.3f s (recorded %.3f s)\n", (unsigned long long) count,
+	       (mcast_hist_now() - start) / 1e9, last / 1e9);
+	mcastpa_stats_show(stdout);
+	return (0);
+}
+
+
 /**
  * @brief main entry point
  * @details parse argc argv and get stuff e.g. startup params etc.
@@ -2379,14 +5004,11 @@ main(int argc, char **argv)
 	pid_t sid = 0;
 	char name[IFNAMSIZ];
 	struct mcast_wan_entry_t *p_mcast_wan_entry;
+	sigset_t sigs;
 
-	memset(&mcastpa, 0, sizeof (struct mcastpa_t));
-
-	INIT_LIST_HEAD(&mcastpa.mcg_head);
-	INIT_LIST_HEAD(&mcastpa.ip_head);
-	INIT_LIST_HEAD(&mcastpa.wan_head);
+	mcastpa_init();
 
-	while ((opt = getopt_long(argc, argv, "vfgmb:Vw:s:x", long_options, &long_index)) != -1) {
+	while ((opt = getopt_long(argc, argv, "vfgmb:Vw:s:xG:M:Z:R:B:N:C:D:P:Q:L:Y:T:K:I:", long_options, &long_index)) != -1) {
 		switch (opt) {
 		case 'v':
 			mcastpa.params.verbose = 1;
@@ -2417,6 +5039,14 @@ main(int argc, char **argv)
 		case 's':
 			mcastpa.params.use_src = 1;
 			sscanf(optarg, "%s", mcastpa.params.src);
+			if (inet_pton(AF_INET, mcastpa.params.src, &mcastpa.params.src_addr.u.ip4) == 1) {
+				mcastpa.params.src_addr.family = AF_INET;
+			} else if (inet_pton(AF_INET6, mcastpa.params.src, &mcastpa.params.src_addr.u.ip6) == 1) {
+				mcastpa.params.src_addr.family = AF_INET6;
+			} else {
+				mcastpa_usage();
+				exit(-1);
+			}
 			break;
 		case 'x':
 			mcastpa.params.exp = 1;
@@ -2425,12 +5055,64 @@ main(int argc, char **argv)
 
 			mcastpa.params.nowifi = 1;
 			break;
+		case 'G':
+			mcastpa.params.max_groups = strtoul(optarg, NULL, 0);
+			break;
+		case 'M':
+			mcastpa.params.max_members = strtoul(optarg, NULL, 0);
+			break;
+		case 'Z':
+			mcastpa.params.zap_window = atoi(optarg);
+			break;
+		case 'R':
+			mcastpa.params.pa_rate = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			mcastpa.params.pa_burst = strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			mcastpa.params.rcvbuf = atoi(optarg);
+			break;
+		case 'C':
+			mcastpa.params.reconcile = atoi(optarg);
+			break;
+		case 'D':
+			mcastpa.params.redump = atoi(optarg);
+			break;
+		case 'P':
+			mcastpa.params.backend = optarg;
+			break;
+		case 'Q':
+			mcast_pa_record_path(optarg);
+			break;
+		case 'L':
+			mcastpa.params.nl_record = optarg;
+			break;
+		case 'Y':
+			mcastpa.params.nl_replay = optarg;
+			break;
+		case 'T':
+			mcastpa.params.replay_speed = atof(optarg);
+			break;
+		case 'K':
+			mcastpa.params.ctl_path = optarg;
+			break;
+		case 'I':
+			mcastpa.params.snap_interval = atoi(optarg);
+			break;
 		default:
 			mcastpa_usage();
 			exit(-1);
 		}
 	}
 
+	mcastpa.pa = mcast_pa_ops_get(mcastpa.params.backend);
+	if (mcastpa.pa == NULL) {
+		printf("unknown backend %s\n", mcastpa.params.backend);
+		mcastpa_usage();
+		exit(-1);
+	}
+
 	/* if no wan specified then add it */
 
 	if (mcastpa.params.wan == 0) {
@@ -2448,28 +5130,29 @@ main(int argc, char **argv)
 
 	openlog("mcast-pa", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_LOCAL1);
 
-	on_exit(mdb_exit_handler, 0);
-
-	if (signal(SIGUSR1, mcast_sig_handler) == SIG_ERR)
-		printf("\ncan't catch SIGUSR1\n");
-
-	if (signal(SIGUSR2, mcast_sig_handler) == SIG_ERR)
-		printf("\ncan't catch SIGUSR1\n");
-
-	if (signal(SIGQUIT, mcast_sig_handler) == SIG_ERR)
-		printf("\ncan't catch SIGQUIT\n");
+	if (mcastpa_pools_init() < 0) {
+		printf("\ncan't allocate group pools\n");
+		exit(-1);
+	}
 
-	if (signal(SIGINT, mcast_sig_handler) == SIG_ERR)
-		printf("\ncan't catch SIGINT\n");
+	on_exit(mdb_exit_handler, 0);
 
-	if (signal(SIGTERM, mcast_sig_handler) == SIG_ERR)
-		printf("\ncan't catch SIGTERM\n");
+	/* do_monitor() takes signals on a signalfd - the user signals wait for it, quit and kill
+	   still end the process while waiting for the wan */
+	sigemptyset(&sigs);
+	sigaddset(&sigs, SIGUSR1);
+	sigaddset(&sigs, SIGUSR2);
+	if (sigprocmask(SIG_BLOCK, &sigs, NULL) < 0)
+		printf("\ncan't block SIGUSR1 and SIGUSR2\n");
 
 	if (mcastpa.params.exp == 1) {
 		do_exp();
 		exit(0);
 	}
 
+	if (mcastpa.params.nl_replay != NULL)
+		exit(do_replay() < 0 ? -1 : 0);
+
 	if (mcastpa.params.foreground == 1) {
 		do_monitor();
 		exit(0);
@@ -2519,3 +5202,4 @@ main(int argc, char **argv)
 
 	return 0;
 }
+#endif				// MCAST_PA_BENCH
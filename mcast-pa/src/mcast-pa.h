@@ -18,6 +18,9 @@
 /* Purpose: ppacmd driver for intel pa mc flows                              */
 /*                                                                           */
 /*****************************************************************************/
+#ifndef MCAST_PA_H
+#define MCAST_PA_H
+
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
@@ -25,6 +28,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <syslog.h>
+#include <netinet/in.h>
 #include <linux/if_ether.h>
 
 #define MCASTPA_STRING_SIZE 128
@@ -36,6 +40,54 @@ struct mcastpa_system_init_t {
 	char wan[MCASTPA_STRING_SIZE];	/**< ascii string name of wan video ingress device */
 };
 
+/**
+ * binary ip address as carried in join and leave requests
+ */
+struct mcastpa_addr_t {
+	int family;				/**< AF_INET or AF_INET6 - AF_UNSPEC if not set */
+	union {
+		struct in_addr ip4;
+		struct in6_addr ip6;
+	} u;
+};
+
+#define MCASTPA_PORTMAP_BITS 1024		/**< port numbers of one bridge - the kernel limit of ports per bridge */
+#define MCASTPA_PORTMAP_WORDS (MCASTPA_PORTMAP_BITS / 64)
+
+/**
+ * set of lan bridge ports that are members of a group
+ * bit n is the port mcast_port_ifindex(br_ifindex, n) - each bridge numbers its ports from 0
+ * as they join, so the set of a bridge with few ports only uses the low words
+ */
+struct mcastpa_portmap_t {
+	uint64_t bits[MCASTPA_PORTMAP_WORDS];
+};
+
+/**
+ * @brief first port of a set at or after port
+ * @returns port number or -1 if none
+ */
+static inline int
+mcastpa_portmap_next(const struct mcastpa_portmap_t *pm, int port)
+{
+	uint64_t w;
+	int i;
+
+	for (i = port / 64; i < MCASTPA_PORTMAP_WORDS; i++) {
+		w = pm->bits[i];
+		if (i == port / 64)
+			w &= ~0ULL << (port % 64);
+		if (w)
+			return (i * 64 + __builtin_ctzll(w));
+	}
+	return (-1);
+}
+
+#define mcastpa_portmap_for_each(port, pm) \
+	for ((port) = mcastpa_portmap_next((pm), 0); (port) >= 0; (port) = mcastpa_portmap_next((pm), (port) + 1))
+
+#define MCASTPA_JL_VERSION 4		/**< binary request - version 1 was all ascii strings, 2 a list of ifindexes, 3 one 64 port set */
+
 struct mcastpa_join_leave_t {
 #define MJL_FLAG_EXP		1<<0		/**<  experimental use */
 #define MJL_FLAG_BRIDGE	1<<1		/**<  bridge mode - no src ip */
@@ -43,16 +95,44 @@ struct mcastpa_join_leave_t {
 #define MJL_FLAG_LAN		1<<3		/**<  contains lan entries i.e. not empty */
 #define MJL_FLAG_UPDATE	1<<4		/**<  group has been joined at least once i.e. update to add */
 
+	int version;				/**< MCASTPA_JL_VERSION */
 	int flags;				/**< bridge, srcip valid etc. */
-	char group[MCASTPA_STRING_SIZE];	/**< ascii string of ip mc group e.g. 224.0.18.101 */
-	char srcip[MCASTPA_STRING_SIZE];	/**< ascii string name of video source ip */
-	char wan[MCASTPA_STRING_SIZE];	/**< ascii string name of wan video ingress device */
-	char lan[MCASTPA_STRING_SIZE];	/**< ascii string names of lan interfaces e.g. lan1 lan2 wifi5g etc */
-	char lan_dev[MCASTPA_STRING_SIZE];	/**< ascii string names of lan interfaces that is joined or leaved */
-	char srcmac[ETH_ALEN];		/**< source mac address of group subscriber */
+	struct mcastpa_addr_t group;		/**< ip mc group e.g. 224.0.18.101 */
+	struct mcastpa_addr_t srcip;		/**< ip address of video source */
+	int wan_ifindex;			/**< ifindex of wan video ingress device */
+	int br_ifindex;			/**< ifindex of the bridge whose port numbers lan uses */
+	int lan_ifindex;			/**< ifindex of the lan port that is joined or leaved */
+	struct mcastpa_portmap_t lan;		/**< all lan ports of the group e.g. lan1 lan2 wifi5g etc */
+	unsigned char srcmac[ETH_ALEN];	/**< source mac address of group subscriber */
+};
+
+/* current interface name of an ifindex - for drivers that need names */
+const char *mcast_if_name(int ifindex);
+/* ifindex of a port number of a bridge in a struct mcastpa_portmap_t */
+int mcast_port_ifindex(int br_ifindex, int port);
+
+/**
+ * accelerator backend - chosen at startup with --backend
+ * join and leave are only called from the programming worker
+ */
+struct mcast_pa_ops_t {
+#define MCAST_PA_CAP_UPDATE	1<<0		/**<  takes MJL_FLAG_UPDATE joins as member adds to a joined group */
+#define MCAST_PA_CAP_BATCH	1<<1		/**<  takes requests back to back - not paced or slowed on errors */
+	const char *name;			/**< --backend name */
+	unsigned int caps;			/**< MCAST_PA_CAP_ flags */
+	unsigned int capacity;			/**< accelerated members the backend holds - 0 if unknown */
+	int (*init) (struct mcastpa_system_init_t * msi);
+	int (*join) (struct mcastpa_join_leave_t * mjl);
+	int (*leave) (struct mcastpa_join_leave_t * mjl);
+	int (*deinit) (struct mcastpa_system_init_t * msi);
 };
 
-int pa_init(struct mcastpa_system_init_t *msi);
-int pa_join(struct mcastpa_join_leave_t *mjl);
-int pa_leave(struct mcastpa_join_leave_t *mjl);
-int pa_deinit(struct mcastpa_system_init_t *msi);
+#ifdef MCAST_PA_INTEL
+extern struct mcast_pa_ops_t mcast_pa_intel_ops;
+#endif
+
+struct mcast_pa_ops_t *mcast_pa_ops_get(const char *name);
+void mcast_pa_ops_list(FILE * f);
+void mcast_pa_record_path(const char *path);
+
+#endif
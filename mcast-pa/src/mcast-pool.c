@@ -0,0 +1,155 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: fixed capacity element pools for group heads and members       */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-pool.c
+  @author tim.hayes@smartrg.com
+  @brief Fixed capacity element pools
+  @details Group heads and members are taken from pools sized once at startup so that
+  steady state joins and leaves do no malloc() or free() and do not fragment the heap
+
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <mcast-pool.h>
+
+/**
+ * @brief allocates the element array and builds the free list
+ * @details
+ * @returns 0 if OK -1 if out of memory
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_pool_init(struct mcast_pool_t *pool, const char *name, size_t size, unsigned int capacity)
+{
+	unsigned int i;
+	void **elem;
+
+	memset(pool, 0, sizeof (struct mcast_pool_t));
+	pool->name = name;
+	pool->size = (size + sizeof (void *) - 1) & ~(sizeof (void *) - 1);
+	pool->capacity = capacity;
+	pool->base = calloc(capacity, pool->size);
+	if (pool->base == NULL) {
+		syslog(LOG_ERR, "%s:%d pool %s cannot allocate %u x %u bytes\n", __FUNCTION__, __LINE__, name,
+		       capacity, (unsigned int) pool->size);
+		return (-1);
+	}
+
+	/* push in reverse so the first allocations come from the start of the array */
+	for (i = capacity; i > 0; i--) {
+		elem = (void **) (pool->base + (size_t) (i - 1) * pool->size);
+		*elem = pool->free;
+		pool->free = elem;
+	}
+	return (0);
+}
+
+/**
+ * @brief takes an element from the pool
+ * @details
+ * @returns zeroed element or NULL if the pool is exhausted
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void *
+mcast_pool_alloc(struct mcast_pool_t *pool)
+{
+	void **elem = (void **) pool->free;
+
+	if (elem == NULL) {
+		if (pool->fails++ == 0) {
+			syslog(LOG_NOTICE, "%s:%d pool %s exhausted at %u elements\n", __FUNCTION__, __LINE__,
+			       pool->name, pool->capacity);
+		}
+		return (NULL);
+	}
+	pool->free = *elem;
+	memset(elem, 0, pool->size);
+	pool->used++;
+	pool->allocs++;
+	if (pool->used > pool->hwm)
+		pool->hwm = pool->used;
+	return (elem);
+}
+
+/**
+ * @brief returns an element to the pool
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_pool_free(struct mcast_pool_t *pool, void *elem)
+{
+	void **p = (void **) elem;
+
+	if (elem == NULL)
+		return;
+	*p = pool->free;
+	pool->free = p;
+	pool->used--;
+}
+
+/**
+ * @brief releases the element array
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_pool_deinit(struct mcast_pool_t *pool)
+{
+	free(pool->base);
+	pool->base = NULL;
+	pool->free = NULL;
+}
+
+/**
+ * @brief show pool usage and memory high-water mark
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_pool_show(FILE * f, struct mcast_pool_t *pool)
+{
+	if (f == NULL)
+		return;
+	fprintf(f, "pool %s: size %u capacity %u used %u hwm %u (%u bytes of %u) fails %u\n", pool->name,
+		(unsigned int) pool->size, pool->capacity, pool->used, pool->hwm,
+		(unsigned int) (pool->hwm * pool->size), (unsigned int) (pool->capacity * pool->size), pool->fails);
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: fixed capacity element pools for group heads and members       */
+/*                                                                           */
+/*****************************************************************************/
+#ifndef MCAST_POOL_H
+#define MCAST_POOL_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * fixed capacity pool of equally sized elements
+ * all memory is taken once at startup, alloc and free are a free list pop and push
+ */
+struct mcast_pool_t {
+	const char *name;			/**< pool name for logging */
+	size_t size;				/**< element size rounded up to pointer alignment */
+	unsigned int capacity;		/**< number of elements in the pool */
+	unsigned int used;			/**< elements currently allocated */
+	unsigned int hwm;			/**< high-water mark of used elements */
+	unsigned int fails;			/**< allocations refused because the pool was empty */
+	unsigned long long allocs;		/**< allocations served since init */
+	char *base;				/**< start of the element array */
+	void *free;				/**< free list threaded through the free elements */
+};
+
+int mcast_pool_init(struct mcast_pool_t *pool, const char *name, size_t size, unsigned int capacity);
+void *mcast_pool_alloc(struct mcast_pool_t *pool);
+void mcast_pool_free(struct mcast_pool_t *pool, void *elem);
+void mcast_pool_deinit(struct mcast_pool_t *pool);
+void mcast_pool_show(FILE * f, struct mcast_pool_t *pool);
+
+#endif
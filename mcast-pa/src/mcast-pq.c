@@ -0,0 +1,600 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: accelerator programming queue and worker thread                  */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-pq.c
+  @author tim.hayes@smartrg.com
+  @brief Accelerator programming queue
+  @details pa_join() and pa_leave() can take a second or more (bridge mode settle time, the
+  CLI and PPA drivers fork a shell). They run on a worker thread fed through a single producer
+  single consumer ring so the netlink thread keeps draining the socket while the driver is busy.
+  There is one worker and the ring is FIFO so requests for a group reach the driver in the order
+  the netlink thread made them.
+
+  The mcast_helper module cannot take adds back to back, but how fast it takes them depends on
+  the platform and its load. Requests start unpaced (or at the --pa-rate cap) and a token bucket
+  takes over when the driver refuses one: each transient error halves the pace, each success
+  raises it by MCAST_PQ_RATE_STEP until it is back at the cap or, uncapped, above
+  MCAST_PQ_RATE_CEIL where the bucket is dropped again. A driver error also makes the worker back
+  off exponentially before the next request, so at boot entries go in as fast as the helper
+  accepts them. Each request is sent once - a failed one is handed back and retried later by
+  the netlink thread.
+
+  The result of every request is handed back to the netlink thread on a result ring so it can
+  keep a shadow of what is programmed, schedule retries and account software time. A request
+  keeps its ring slot until its result was read, so no result is ever dropped. When the ring is
+  full, requests wait in order on a backlog the netlink thread feeds into the ring as results
+  are read - a startup dump or a resync never stalls netlink reads behind a slow driver.
+
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <mcast-pq.h>
+#include <mcast-trace.h>
+
+/**
+ * @brief sleeps for ms milliseconds
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_pq_sleep(unsigned int ms)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+}
+
+/**
+ * @brief takes a token from the bucket - waits for one if the bucket is empty
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_pq_throttle(struct mcast_pq_t *pq)
+{
+	struct timespec now;
+	uint64_t us;
+	uint64_t wait;
+
+	if (pq->rate == 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	us = (uint64_t) (now.tv_sec - pq->refill.tv_sec) * 1000000 + (now.tv_nsec - pq->refill.tv_nsec) / 1000;
+	pq->refill = now;
+	pq->tokens += us * pq->rate;
+	if (pq->tokens > (uint64_t) pq->burst * 1000000)
+		pq->tokens = (uint64_t) pq->burst * 1000000;
+
+	if (pq->tokens < 1000000) {
+		__atomic_add_fetch(&pq->throttled, 1, __ATOMIC_RELAXED);
+		wait = (1000000 - pq->tokens + pq->rate - 1) / pq->rate;
+		mcast_pq_sleep((wait + 999) / 1000);
+		clock_gettime(CLOCK_MONOTONIC, &pq->refill);
+		pq->tokens = 1000000;
+	}
+	pq->tokens -= 1000000;
+}
+
+/**
+ * @brief adapts the pace of the driver requests to a driver result
+ * @details additive increase multiplicative decrease - a transient error halves the pace, down to
+ * @details MCAST_PQ_RATE_MIN, a success raises it by MCAST_PQ_RATE_STEP, up to the cap
+ * @note called from the worker only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_pq_adapt(struct mcast_pq_t *pq, int res)
+{
+	unsigned int rate = pq->rate;
+	unsigned int limit = pq->rate_max ? pq->rate_max : MCAST_PQ_RATE_CEIL;
+
+	if (!pq->adapt)
+		return;
+	if (mcast_pq_transient(res)) {
+		if (rate == 0) {
+			/* from unpaced - the bucket starts empty so the next request waits */
+			rate = limit;
+			clock_gettime(CLOCK_MONOTONIC, &pq->refill);
+			pq->tokens = 0;
+		}
+		rate /= 2;
+		if (rate < MCAST_PQ_RATE_MIN)
+			rate = MCAST_PQ_RATE_MIN;
+		__atomic_add_fetch(&pq->slowed, 1, __ATOMIC_RELAXED);
+	} else if ((res == 0) && (rate != 0)) {
+		rate += MCAST_PQ_RATE_STEP;
+		if (rate >= limit)
+			rate = pq->rate_max;
+	}
+	__atomic_store_n(&pq->rate, rate, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief writes a trace record for a driver call
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static inline void
+mcast_pq_trace(struct mcast_pq_item_t *item, int ev, int res, int attempt)
+{
+	struct mcastpa_join_leave_t *mjl = &item->mjl;
+
+	mcast_trace(ev, mjl->group.family, &mjl->group.u, mjl->lan_ifindex, mjl->srcmac, res, attempt);
+}
+
+/**
+ * @brief sends one request to the driver
+ * @details one call per request - a failed request goes back to the netlink thread which
+ * @details owns retries, errors only slow down the requests behind it through the backoff
+ * @details which grows on transient errors and decays on success
+ * @returns driver result
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static int
+mcast_pq_run(struct mcast_pq_t *pq, struct mcast_pq_item_t *item)
+{
+	int kind = mcast_pq_hist_kind(item);
+	uint64_t start;
+	int res;
+
+	if (pq->backoff)
+		mcast_pq_sleep(pq->backoff);
+	mcast_pq_throttle(pq);
+	mcast_pq_trace(item, item->op == MCAST_PQ_JOIN ? MT_JOIN_ENTER : MT_LEAVE_ENTER, 0, item->attempt);
+	start = mcast_hist_now();
+	mcast_hist_add(&pq->hist->h[MH_UPDATE_DISPATCH][kind], start - item->put_ns);
+	if (item->op == MCAST_PQ_JOIN)
+		res = pq->ops->join(&item->mjl);
+	else
+		res = pq->ops->leave(&item->mjl);
+	mcast_hist_add(&pq->hist->h[MH_DRIVER][kind], mcast_hist_now() - start);
+	mcast_pq_trace(item, item->op == MCAST_PQ_JOIN ? MT_JOIN_EXIT : MT_LEAVE_EXIT, res, item->attempt);
+	__atomic_add_fetch(&pq->calls, 1, __ATOMIC_RELAXED);
+	if (item->attempt)
+		__atomic_add_fetch(&pq->retries, 1, __ATOMIC_RELAXED);
+	mcast_pq_adapt(pq, res);
+	if (!mcast_pq_transient(res)) {
+		pq->backoff /= 2;
+	} else {
+		pq->backoff = pq->backoff ? pq->backoff * 2 : MCAST_PQ_BACKOFF_MIN;
+		if (pq->backoff > MCAST_PQ_BACKOFF_MAX)
+			pq->backoff = MCAST_PQ_BACKOFF_MAX;
+	}
+	return (res);
+}
+
+/**
+ * @brief hands the result of a request back to the netlink thread
+ * @details
+ * @note called from the worker only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_pq_result_put(struct mcast_pq_t *pq, struct mcast_pq_item_t *item)
+{
+	unsigned int head = pq->res_head;
+
+	/* the producer keeps at most size requests whose result is unread - there is always room */
+	memcpy(&pq->res_ring[head & (pq->size - 1)], item, sizeof (struct mcast_pq_item_t));
+	__atomic_store_n(&pq->res_head, head + 1, __ATOMIC_RELEASE);
+	eventfd_write(pq->res_fd, 1);
+}
+
+/**
+ * @brief moves a request into the ring
+ * @details
+ * @note called from the netlink thread only - the caller checked for room
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_pq_push(struct mcast_pq_t *pq, struct mcast_pq_item_t *src)
+{
+	unsigned int depth;
+
+	memcpy(&pq->ring[pq->head & (pq->size - 1)], src, sizeof (struct mcast_pq_item_t));
+	__atomic_store_n(&pq->head, pq->head + 1, __ATOMIC_RELEASE);
+	sem_post(&pq->items);
+
+	pq->queued++;
+	depth = pq->head - __atomic_load_n(&pq->tail, __ATOMIC_ACQUIRE);
+	if (depth > pq->hwm)
+		pq->hwm = depth;
+}
+
+/**
+ * @brief determines if the ring has a slot for another request
+ * @returns 1 if a slot is free 0 otherwise
+ * @note a slot is busy until the result of its request was read
+ * @author tim.hayes@smartrg.com
+ */
+static inline int
+mcast_pq_room(struct mcast_pq_t *pq)
+{
+	return ((pq->head - pq->res_tail) < pq->size);
+}
+
+/**
+ * @brief moves backlogged requests into the ring as long as it has room
+ * @details
+ * @note called from the netlink thread only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void
+mcast_pq_feed(struct mcast_pq_t *pq)
+{
+	while ((pq->backlog_tail != pq->backlog_head) && mcast_pq_room(pq))
+		mcast_pq_push(pq, &pq->backlog[pq->backlog_tail++]);
+	if (pq->backlog_tail == pq->backlog_head)
+		pq->backlog_tail = pq->backlog_head = 0;
+}
+
+/**
+ * @brief takes a backlog slot - compacts or doubles the backlog when it is full
+ * @returns slot or NULL if out of memory
+ * @note called from the netlink thread only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static struct mcast_pq_item_t *
+mcast_pq_backlog_slot(struct mcast_pq_t *pq)
+{
+	struct mcast_pq_item_t *backlog;
+	unsigned int n;
+
+	if (pq->backlog_head == pq->backlog_size) {
+		n = pq->backlog_head - pq->backlog_tail;
+		if (pq->backlog_tail > pq->backlog_size / 2) {
+			memmove(pq->backlog, &pq->backlog[pq->backlog_tail], n * sizeof (struct mcast_pq_item_t));
+		} else {
+			backlog = realloc(pq->backlog, 2 * (pq->backlog_size ? pq->backlog_size : pq->size) *
+					  sizeof (struct mcast_pq_item_t));
+			if (backlog == NULL)
+				return (NULL);
+			pq->backlog = backlog;
+			pq->backlog_size = 2 * (pq->backlog_size ? pq->backlog_size : pq->size);
+			memmove(pq->backlog, &pq->backlog[pq->backlog_tail], n * sizeof (struct mcast_pq_item_t));
+		}
+		pq->backlog_tail = 0;
+		pq->backlog_head = n;
+	}
+	n = pq->backlog_head - pq->backlog_tail + 1;
+	if (n > pq->backlog_hwm)
+		pq->backlog_hwm = n;
+	return (&pq->backlog[pq->backlog_head++]);
+}
+
+/**
+ * @brief takes one result from the result ring
+ * @details clears the eventfd once the ring is empty, the freed slot takes the next
+ * @details backlogged request
+ * @returns 1 if a result was copied to item 0 if none
+ * @note called from the netlink thread only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_pq_result_get(struct mcast_pq_t *pq, struct mcast_pq_item_t *item)
+{
+	eventfd_t count;
+	unsigned int tail = pq->res_tail;
+
+	if (tail == __atomic_load_n(&pq->res_head, __ATOMIC_ACQUIRE)) {
+		eventfd_read(pq->res_fd, &count);
+		/* a result may have landed between the check and the read */
+		if (tail == __atomic_load_n(&pq->res_head, __ATOMIC_ACQUIRE))
+			return (0);
+	}
+	memcpy(item, &pq->res_ring[tail & (pq->size - 1)], sizeof (struct mcast_pq_item_t));
+	__atomic_store_n(&pq->res_tail, tail + 1, __ATOMIC_RELEASE);
+	mcast_pq_feed(pq);
+	return (1);
+}
+
+/**
+ * @brief returns the fd to poll for results
+ * @returns eventfd
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_pq_fd(struct mcast_pq_t *pq)
+{
+	return (pq->res_fd);
+}
+
+/**
+ * @brief runs queued requests until a stop request
+ * @details all signals are blocked so they are handled on the netlink thread
+ * @returns NULL
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+static void *
+mcast_pq_worker(void *arg)
+{
+	struct mcast_pq_t *pq = (struct mcast_pq_t *) arg;
+	struct mcast_pq_item_t *item;
+	sigset_t set;
+	unsigned int tail;
+	int res;
+	int op;
+
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+	mcast_trace_thread(1);
+
+	do {
+		while (sem_wait(&pq->items) < 0 && errno == EINTR)
+			;
+		tail = pq->tail;
+		item = &pq->ring[tail & (pq->size - 1)];
+		op = item->op;
+		res = (op == MCAST_PQ_STOP) ? 0 : mcast_pq_run(pq, item);
+		if (res != 0) {
+			__atomic_add_fetch(&pq->fails, 1, __ATOMIC_RELAXED);
+			syslog(LOG_NOTICE, "%s:%d queue %s op %d failed res %d\n", __FUNCTION__, __LINE__, pq->name, op,
+			       res);
+		}
+		if (op != MCAST_PQ_STOP) {
+			item->res = res;
+			mcast_pq_result_put(pq, item);
+		}
+		__atomic_add_fetch(&pq->done, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&pq->tail, tail + 1, __ATOMIC_RELEASE);
+	} while (op != MCAST_PQ_STOP);
+
+	return (NULL);
+}
+
+/**
+ * @brief allocates the ring and starts the worker
+ * @details rate caps the pace, 0 for no cap - a MCAST_PA_CAP_BATCH backend sends requests as fast
+ * @details as the backend returns and driver errors do not slow it
+ * @returns 0 if OK -1 otherwise
+ * @note size is rounded up to a power of 2
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_pq_init(struct mcast_pq_t *pq, const char *name, struct mcast_pa_ops_t *ops, unsigned int size,
+	      unsigned int rate, unsigned int burst)
+{
+	unsigned int n = 2;
+
+	memset(pq, 0, sizeof (struct mcast_pq_t));
+	while (n < size)
+		n <<= 1;
+	pq->name = name;
+	pq->size = n;
+	pq->ops = ops;
+	/* backends that take requests back to back are not paced */
+	pq->adapt = !(ops->caps & MCAST_PA_CAP_BATCH);
+	pq->rate_max = pq->adapt ? rate : 0;
+	pq->rate = pq->rate_max;
+	pq->burst = burst ? burst : 1;
+	pq->tokens = (uint64_t) pq->burst * 1000000;
+	pq->hist = mcast_hist_backend(ops->name);
+	clock_gettime(CLOCK_MONOTONIC, &pq->refill);
+	pq->ring = calloc(n, sizeof (struct mcast_pq_item_t));
+	pq->res_ring = calloc(n, sizeof (struct mcast_pq_item_t));
+	pq->res_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if ((pq->ring == NULL) || (pq->res_ring == NULL) || (pq->res_fd < 0)) {
+		syslog(LOG_ERR, "%s:%d queue %s cannot allocate %u slots\n", __FUNCTION__, __LINE__, name, n);
+		free(pq->ring);
+		free(pq->res_ring);
+		if (pq->res_fd >= 0)
+			close(pq->res_fd);
+		return (-1);
+	}
+	sem_init(&pq->items, 0, 0);
+	if (pthread_create(&pq->worker, NULL, mcast_pq_worker, pq) != 0) {
+		syslog(LOG_ERR, "%s:%d queue %s cannot start worker\n", __FUNCTION__, __LINE__, name);
+		free(pq->ring);
+		free(pq->res_ring);
+		close(pq->res_fd);
+		pq->ring = NULL;
+		pq->res_ring = NULL;
+		return (-1);
+	}
+	pq->running = 1;
+	return (0);
+}
+
+/**
+ * @brief queues a driver request
+ * @details never waits - with the ring full or requests already backlogged the request goes
+ * @details to the end of the backlog so ordering is never given up
+ * @returns 0 if OK -1 if the worker is not running -ENOMEM if the backlog cannot grow
+ * @note called from the netlink thread only
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_pq_put(struct mcast_pq_t *pq, int op, struct mcastpa_join_leave_t *mjl, unsigned int attempt,
+	     unsigned int seq)
+{
+	struct mcast_pq_item_t tmp;
+	struct mcast_pq_item_t *item = &tmp;
+
+	if (!pq->running)
+		return (-1);
+
+	mcast_pq_feed(pq);
+	if ((pq->backlog_tail != pq->backlog_head) || !mcast_pq_room(pq)) {
+		item = mcast_pq_backlog_slot(pq);
+		if (item == NULL) {
+			syslog(LOG_ERR, "%s:%d queue %s backlog cannot grow past %u requests\n", __FUNCTION__,
+			       __LINE__, pq->name, pq->backlog_size);
+			return (-ENOMEM);
+		}
+		if (pq->full++ == 0)
+			syslog(LOG_NOTICE, "%s:%d queue %s full at %u requests - backlogged\n", __FUNCTION__,
+			       __LINE__, pq->name, pq->size);
+	}
+
+	item->op = op;
+	item->attempt = attempt;
+	item->seq = seq;
+	item->res = 0;
+	item->rx_ns = pq->rx_ns;
+	item->put_ns = mcast_hist_now();
+	if (mjl != NULL)
+		memcpy(&item->mjl, mjl, sizeof (struct mcastpa_join_leave_t));
+	if (item->rx_ns && (op != MCAST_PQ_STOP))
+		mcast_hist_add(&pq->hist->h[MH_RX_UPDATE][mcast_pq_hist_kind(item)], item->put_ns - item->rx_ns);
+	if (item == &tmp)
+		mcast_pq_push(pq, item);
+	return (0);
+}
+
+/**
+ * @brief drains the queue, stops the worker and releases the ring
+ * @details requests already queued or backlogged are still sent to the driver
+ * @note results not read yet are dropped
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_pq_deinit(struct mcast_pq_t *pq)
+{
+	struct mcast_pq_item_t item;
+
+	if (!pq->running)
+		return;
+	/* reading results frees the slots the backlog and the stop request wait for */
+	while ((mcast_pq_put(pq, MCAST_PQ_STOP, NULL, 0, 0) < 0) && !mcast_pq_result_get(pq, &item))
+		mcast_pq_sleep(1);
+	while (pq->backlog_tail != pq->backlog_head) {
+		if (!mcast_pq_result_get(pq, &item))
+			mcast_pq_sleep(1);
+	}
+	pthread_join(pq->worker, NULL);
+	pq->running = 0;
+	sem_destroy(&pq->items);
+	close(pq->res_fd);
+	free(pq->ring);
+	free(pq->res_ring);
+	free(pq->backlog);
+	pq->ring = NULL;
+	pq->res_ring = NULL;
+	pq->backlog = NULL;
+}
+
+/**
+ * @brief number of requests in flight i.e. backlogged, queued, being sent or with an unread result
+ * @returns 0 once every result has been read
+ * @note called from the netlink thread only - the worker posts a result before it moves tail, so
+ * @note a request only stops counting when its result was read
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+unsigned int
+mcast_pq_depth(struct mcast_pq_t *pq)
+{
+	return (pq->backlog_head - pq->backlog_tail + pq->head - pq->res_tail);
+}
+
+/**
+ * @brief determines if the caller is the worker thread
+ * @returns 1 if worker 0 otherwise
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_pq_is_worker(struct mcast_pq_t *pq)
+{
+	return (pq->running && pthread_equal(pthread_self(), pq->worker));
+}
+
+/**
+ * @brief show queue depth and counters
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_pq_show(FILE * f, struct mcast_pq_t *pq)
+{
+	if (f == NULL)
+		return;
+	fprintf(f, "queue %s: size %u depth %u hwm %u queued %llu done %llu fails %llu full %llu\n", pq->name,
+		pq->size, pq->head - __atomic_load_n(&pq->tail, __ATOMIC_ACQUIRE), pq->hwm,
+		(unsigned long long) pq->queued,
+		(unsigned long long) __atomic_load_n(&pq->done, __ATOMIC_RELAXED),
+		(unsigned long long) __atomic_load_n(&pq->fails, __ATOMIC_RELAXED), (unsigned long long) pq->full);
+	fprintf(f, "queue %s: backlog %u hwm %u of %u\n", pq->name, pq->backlog_head - pq->backlog_tail,
+		pq->backlog_hwm, pq->backlog_size);
+	fprintf(f, "queue %s: rate %u/s cap %u/s burst %u backoff %u ms throttled %llu slowed %llu calls %llu "
+		"retries %llu\n", pq->name, __atomic_load_n(&pq->rate, __ATOMIC_RELAXED), pq->rate_max, pq->burst,
+		__atomic_load_n(&pq->backoff, __ATOMIC_RELAXED),
+		(unsigned long long) __atomic_load_n(&pq->throttled, __ATOMIC_RELAXED),
+		(unsigned long long) __atomic_load_n(&pq->slowed, __ATOMIC_RELAXED),
+		(unsigned long long) __atomic_load_n(&pq->calls, __ATOMIC_RELAXED),
+		(unsigned long long) __atomic_load_n(&pq->retries, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,143 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: accelerator programming queue and worker thread                  */
+/*                                                                           */
+/*****************************************************************************/
+#ifndef MCAST_PQ_H
+#define MCAST_PQ_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+#include <mcast-pa.h>
+#include <mcast-hist.h>
+
+#define MCAST_PQ_SIZE_DEFAULT 1024		/* queued requests - must be a power of 2 */
+#define MCAST_PQ_RATE_DEFAULT 0		/* cap on driver requests per second - 0 is none, the pace adapts below it */
+#define MCAST_PQ_RATE_MIN 10			/* lowest pace driver errors bring requests down to */
+#define MCAST_PQ_RATE_CEIL 1000		/* pace halved on the first error of an uncapped queue - unpaced again above it */
+#define MCAST_PQ_RATE_STEP 1			/* requests per second the pace grows by with each driver success */
+#define MCAST_PQ_BURST_DEFAULT 16		/* driver requests sent back to back before the rate applies */
+#define MCAST_PQ_BACKOFF_MIN 10		/* ms to wait after the first driver error */
+#define MCAST_PQ_BACKOFF_MAX 1000		/* ms cap on the wait after repeated driver errors */
+
+enum mcast_pq_op_t {
+	MCAST_PQ_JOIN = 1,			/**< backend join */
+	MCAST_PQ_LEAVE,				/**< backend leave */
+	MCAST_PQ_STOP,				/**< worker exits after the requests ahead of it */
+};
+
+/**
+ * one queued driver request
+ */
+struct mcast_pq_item_t {
+	int op;					/**< enum mcast_pq_op_t */
+	unsigned int attempt;			/**< earlier failed tries - the netlink thread queues retries */
+	unsigned int seq;			/**< sequence number of the producer - handed back with the result */
+	int res;				/**< driver result - set by the worker */
+	uint64_t rx_ns;				/**< netlink receive time of the event - 0 if not from netlink */
+	uint64_t put_ns;			/**< time the request was queued i.e. the group table was updated */
+	struct mcastpa_join_leave_t mjl;	/**< copy of the request - the worker owns it */
+};
+
+/**
+ * single producer single consumer ring feeding the driver worker
+ * the netlink thread only writes head and the worker only writes tail, the semaphore
+ * only parks the worker when it has nothing to do
+ * results of all requests go back the same way on a second ring, the worker
+ * writes res_head and the netlink thread res_tail, an eventfd wakes the netlink thread
+ * a ring slot is only reused once its result was read so the result ring never overflows,
+ * requests that find the ring full wait in order on the backlog - the netlink thread never blocks
+ */
+struct mcast_pq_t {
+	const char *name;			/**< queue name for logging */
+	unsigned int size;			/**< number of ring slots - power of 2 */
+	struct mcast_pq_item_t *ring;		/**< request slots */
+	unsigned int head;			/**< next slot to fill - written by the producer */
+	unsigned int tail;			/**< next slot to drain - written by the worker */
+	sem_t items;				/**< filled slots */
+	struct mcast_pq_item_t *backlog;	/**< requests waiting for a ring slot - netlink thread only */
+	unsigned int backlog_size;		/**< backlog slots allocated - doubled when full */
+	unsigned int backlog_head;		/**< next backlog slot to fill */
+	unsigned int backlog_tail;		/**< next backlog slot to move to the ring */
+	unsigned int backlog_hwm;		/**< high-water mark of backlogged requests */
+	struct mcast_pq_item_t *res_ring;	/**< result slots */
+	unsigned int res_head;			/**< next result slot to fill - written by the worker */
+	unsigned int res_tail;			/**< next result slot to read - written by the netlink thread */
+	int res_fd;				/**< eventfd signalled when results are queued */
+	unsigned int rate;			/**< token bucket refill in requests per second - 0 is unpaced, written by the worker */
+	unsigned int rate_max;			/**< --pa-rate cap the pace grows back to - 0 is none */
+	int adapt;				/**< set if driver errors lower the pace - not for MCAST_PA_CAP_BATCH backends */
+	unsigned int burst;			/**< token bucket depth */
+	uint64_t tokens;			/**< available requests scaled by 1000000 */
+	struct timespec refill;		/**< last token bucket refill */
+	unsigned int backoff;			/**< ms wait before the next request - grows on errors, decays on success */
+	pthread_t worker;			/**< driver worker thread */
+	int running;				/**< set while the worker thread exists */
+	unsigned int hwm;			/**< high-water mark of queued requests */
+	uint64_t queued;			/**< requests queued */
+	uint64_t full;				/**< requests that found the ring full and went to the backlog */
+	uint64_t done;				/**< requests completed by the worker */
+	uint64_t fails;				/**< requests the driver failed - handed back for the netlink thread to retry */
+	uint64_t throttled;			/**< requests held back by the token bucket */
+	uint64_t slowed;			/**< driver errors that lowered the pace */
+	uint64_t calls;				/**< driver calls made - one per request */
+	uint64_t retries;			/**< driver calls for requests queued again after a failure */
+	uint64_t rx_ns;				/**< netlink receive time of the event being applied - set by the producer */
+	struct mcast_pa_ops_t *ops;		/**< backend the worker calls */
+	struct mcast_hist_backend_t *hist;	/**< latency histograms of the backend */
+};
+
+int mcast_pq_init(struct mcast_pq_t *pq, const char *name, struct mcast_pa_ops_t *ops, unsigned int size,
+		  unsigned int rate, unsigned int burst);
+int mcast_pq_put(struct mcast_pq_t *pq, int op, struct mcastpa_join_leave_t *mjl, unsigned int attempt,
+		 unsigned int seq);
+int mcast_pq_result_get(struct mcast_pq_t *pq, struct mcast_pq_item_t *item);
+void mcast_pq_deinit(struct mcast_pq_t *pq);
+void mcast_pq_show(FILE * f, struct mcast_pq_t *pq);
+int mcast_pq_is_worker(struct mcast_pq_t *pq);
+int mcast_pq_fd(struct mcast_pq_t *pq);
+unsigned int mcast_pq_depth(struct mcast_pq_t *pq);
+
+/**
+ * @brief determines if a driver error may go away by itself
+ * @details the helper refuses requests that come too fast - bad requests never succeed
+ * @returns 1 if worth sending again 0 otherwise
+ */
+static inline int
+mcast_pq_transient(int res)
+{
+	return ((res != 0) && (res != -EINVAL) && (res != -ENOENT) && (res != -EEXIST));
+}
+
+/**
+ * @brief latency histogram kind of a request
+ * @author tim.hayes@smartrg.com
+ */
+static inline int
+mcast_pq_hist_kind(struct mcast_pq_item_t *item)
+{
+	if (item->op == MCAST_PQ_LEAVE)
+		return (MH_LEAVE);
+	return ((item->mjl.flags & MJL_FLAG_UPDATE) ? MH_UPDATE : MH_JOIN);
+}
+
+#endif
@@ -0,0 +1,217 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: reader for the mcast-pa table snapshot                           */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-snap-read.c
+  @author tim.hayes@smartrg.com
+  @brief mcastpa-snap - prints the mcast-pa group table snapshot
+  @details Maps /dev/shm/mcastpa-snap read only and copies the published buffer, copying
+  again if the daemon rewrote it meanwhile, so the groups, members and interfaces printed
+  are one consistent view.  The daemon is never stopped or signalled.  With -i it prints a
+  new view each time one is published.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <mcast-snap.h>
+
+#define SNAP_COPY_TRIES 100			/* copies before giving up on a busy writer */
+
+/**
+ * @brief copies the published buffer
+ * @details buf is buf_size bytes - a copy is kept only if the buffer seq was even and did not move
+ * @returns 0 if OK -1 if nothing is published yet or every copy was torn
+ * @author tim.hayes@smartrg.com
+ */
+static int
+snap_copy(struct mcast_snap_shm_t *shm, struct mcast_snap_buf_t *copy, unsigned int *torn)
+{
+	struct mcast_snap_buf_t *buf;
+	uint64_t published;
+	uint64_t seq;
+	int i;
+
+	for (i = 0; i < SNAP_COPY_TRIES; i++) {
+		published = __atomic_load_n(&shm->published, __ATOMIC_ACQUIRE);
+		if (published == 0)
+			return (-1);
+		buf = mcast_snap_buf(shm, published);
+		seq = __atomic_load_n(&buf->seq, __ATOMIC_ACQUIRE);
+		if ((seq & 1) == 0) {
+			memcpy(copy, buf, shm->buf_size);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&buf->seq, __ATOMIC_RELAXED) == seq)
+				return (0);
+		}
+		(*torn)++;
+	}
+	return (-1);
+}
+
+/**
+ * @brief name of an interface in the copy
+ * @author tim.hayes@smartrg.com
+ */
+static const char *
+snap_if_name(struct mcast_snap_shm_t *shm, struct mcast_snap_buf_t *buf, int ifindex)
+{
+	struct mcast_snap_if_t *sif = mcast_snap_ifs(shm, buf);
+	static char name[16];
+	uint32_t i;
+
+	for (i = 0; i < buf->ifs; i++)
+		if (sif[i].ifindex == ifindex)
+			return (sif[i].name);
+	snprintf(name, sizeof (name), "if%d", ifindex);
+	return (name);
+}
+
+/**
+ * @brief prints one consistent copy
+ * @author tim.hayes@smartrg.com
+ */
+static void
+snap_print(struct mcast_snap_shm_t *shm, struct mcast_snap_buf_t *buf, int counts)
+{
+	struct mcast_snap_group_t *g = mcast_snap_groups(shm, buf);
+	struct mcast_snap_member_t *m = mcast_snap_members(shm, buf);
+	struct mcast_snap_if_t *sif = mcast_snap_ifs(shm, buf);
+	char abuf[INET6_ADDRSTRLEN];
+	char sbuf[INET6_ADDRSTRLEN];
+	uint32_t i;
+	uint32_t j;
+
+	printf("snapshot %llu at %llu.%03llu groups %u members %u interfaces %u\n", (unsigned long long) buf->gen,
+	       (unsigned long long) (buf->ns / 1000000000ULL), (unsigned long long) (buf->ns / 1000000 % 1000),
+	       buf->groups, buf->members, buf->ifs);
+	if (counts)
+		return;
+	for (i = 0; i < buf->ifs; i++)
+		printf("if %-3d %-16s role 0x%02x master %-3d flags 0x%x\n", sif[i].ifindex, sif[i].name, sif[i].role,
+		       sif[i].master, sif[i].flags);
+	for (i = 0; i < buf->groups; i++, g++) {
+		inet_ntop(g->family, g->group, abuf, sizeof (abuf));
+		if ((g->src_family == 0) || (inet_ntop(g->src_family, g->src, sbuf, sizeof (sbuf)) == NULL))
+			strcpy(sbuf, "-");
+		printf("group %s src %s wan %s", abuf, sbuf, snap_if_name(shm, buf, g->wan_ifindex));
+		printf(" bridge %s", g->br_ifindex ? snap_if_name(shm, buf, g->br_ifindex) : "-");
+		printf(" members %u software %u/%llu ms\n", g->members, g->sw_members, (unsigned long long) g->sw_ms);
+		if (g->first + g->members > buf->members)
+			continue;
+		for (j = g->first; j < g->first + g->members; j++)
+			printf("  member %-16s %02x:%02x:%02x:%02x:%02x:%02x %s%s retries %u\n",
+			       snap_if_name(shm, buf, m[j].ifindex), m[j].mac[0], m[j].mac[1], m[j].mac[2], m[j].mac[3],
+			       m[j].mac[4], m[j].mac[5],
+			       (m[j].flags & MCAST_SNAP_PARKED) ? "parked" : (m[j].flags & MCAST_SNAP_SOFTWARE) ?
+			       "software" : (m[j].flags & MCAST_SNAP_JOINED) ? "joined" : "waiting", (m[j].flags & MCAST_SNAP_LOCAL) ? " local" : "", m[j].retries);
+	}
+}
+
+static void
+usage(void)
+{
+	printf("mcastpa-snap [-c] [-i ms]\n");
+	printf(" -c counts only\n");
+	printf(" -i ms poll every ms and print each new snapshot\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct mcast_snap_shm_t *shm;
+	struct mcast_snap_buf_t *copy;
+	struct stat st;
+	uint64_t last = 0;
+	unsigned int torn = 0;
+	int interval = 0;
+	int counts = 0;
+	int fd;
+	int c;
+
+	while ((c = getopt(argc, argv, "ci:h")) != -1) {
+		switch (c) {
+		case 'c':
+			counts = 1;
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		default:
+			usage();
+			exit(0);
+		}
+	}
+
+	fd = shm_open(MCAST_SNAP_SHM, O_RDONLY, 0);
+	if ((fd < 0) || (fstat(fd, &st) < 0)) {
+		printf("no snapshot segment %s - is mcast-pa running?\n", MCAST_SNAP_SHM);
+		exit(-1);
+	}
+	shm = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		printf("cannot map %s\n", MCAST_SNAP_SHM);
+		exit(-1);
+	}
+	if ((__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != MCAST_SNAP_MAGIC) ||
+	    (shm->version != MCAST_SNAP_VERSION) || (shm->group_size != sizeof (struct mcast_snap_group_t)) ||
+	    (shm->member_size != sizeof (struct mcast_snap_member_t)) ||
+	    (shm->if_size != sizeof (struct mcast_snap_if_t)) ||
+	    (st.st_size < sizeof (*shm) + 2 * shm->buf_size)) {
+		printf("snapshot segment version mismatch\n");
+		exit(-1);
+	}
+	copy = malloc(shm->buf_size);
+	if (copy == NULL)
+		exit(-1);
+
+	do {
+		if (snap_copy(shm, copy, &torn) == 0) {
+			if (copy->gen != last)
+				snap_print(shm, copy, counts);
+			last = copy->gen;
+		} else if (interval == 0) {
+			printf("no snapshot published\n");
+		}
+		fflush(stdout);
+		if (interval)
+			usleep(interval * 1000);
+	} while (interval);
+
+	if (torn)
+		printf("%u copies retried while the daemon wrote\n", torn);
+	free(copy);
+	munmap(shm, st.st_size);
+	return (0);
+}
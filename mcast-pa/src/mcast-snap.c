@@ -0,0 +1,184 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: shared memory snapshot of the group tables                       */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-snap.c
+  @author tim.hayes@smartrg.com
+  @brief Shared memory snapshot of the group tables
+  @details The netlink thread publishes the group, member and interface tables as fixed size
+  binary records to one of two buffers in a shared memory segment, then flips published to it.
+  Each buffer carries a seqlock so a reader that was still copying a buffer when the daemon
+  started rewriting it sees the seq move and copies again.  Readers never make a syscall into
+  the daemon and the daemon never waits for a reader.  mcastpa-snap decodes the segment.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <syslog.h>
+#include <sys/mman.h>
+#include <mcast-snap.h>
+
+static struct mcast_snap_shm_t *snap;
+static size_t snap_len;
+static uint64_t snap_begin_ns;			/* when the publish in progress started */
+static uint64_t snap_cost_ns;			/* time the last publish took */
+static uint64_t snap_cost_max_ns;		/* longest publish */
+
+/**
+ * @brief creates and maps the snapshot segment
+ * @details sized for the group and member pools so a publish never truncates the tables
+ * @returns 0 if OK -1 if the snapshot is off
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_snap_init(uint32_t groups, uint32_t members, uint32_t ifs)
+{
+	uint64_t buf_size;
+	int fd;
+	void *p;
+
+	buf_size = sizeof (struct mcast_snap_buf_t) + (uint64_t) groups * sizeof (struct mcast_snap_group_t) +
+	    (uint64_t) members * sizeof (struct mcast_snap_member_t) + (uint64_t) ifs * sizeof (struct mcast_snap_if_t);
+	snap_len = sizeof (struct mcast_snap_shm_t) + 2 * buf_size;
+	fd = shm_open(MCAST_SNAP_SHM, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		syslog(LOG_NOTICE, "%s:%d no shm for %s\n", __FUNCTION__, __LINE__, MCAST_SNAP_SHM);
+		return (-1);
+	}
+	if (ftruncate(fd, snap_len) < 0) {
+		close(fd);
+		shm_unlink(MCAST_SNAP_SHM);
+		return (-1);
+	}
+	p = mmap(NULL, snap_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(MCAST_SNAP_SHM);
+		return (-1);
+	}
+
+	snap = (struct mcast_snap_shm_t *) p;
+	snap->max_groups = groups;
+	snap->max_members = members;
+	snap->max_ifs = ifs;
+	snap->group_size = sizeof (struct mcast_snap_group_t);
+	snap->member_size = sizeof (struct mcast_snap_member_t);
+	snap->if_size = sizeof (struct mcast_snap_if_t);
+	snap->buf_size = buf_size;
+	snap->version = MCAST_SNAP_VERSION;
+	__atomic_store_n(&snap->magic, MCAST_SNAP_MAGIC, __ATOMIC_RELEASE);
+	return (0);
+}
+
+/**
+ * @brief unmaps and removes the snapshot segment
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_snap_deinit(void)
+{
+	if (snap == NULL)
+		return;
+	munmap(snap, snap_len);
+	snap = NULL;
+	shm_unlink(MCAST_SNAP_SHM);
+}
+
+/**
+ * @brief starts writing the buffer that is not published
+ * @details the caller fills the arrays of shm and the counts and then calls mcast_snap_commit()
+ * @returns buffer or NULL if the snapshot is off
+ * @note single writer - the netlink thread
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+struct mcast_snap_buf_t *
+mcast_snap_begin(struct mcast_snap_shm_t **shm)
+{
+	struct mcast_snap_buf_t *buf;
+	struct timespec ts;
+
+	if (snap == NULL)
+		return (NULL);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	snap_begin_ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	*shm = snap;
+	buf = mcast_snap_buf(snap, snap->published + 1);
+	__atomic_store_n(&buf->seq, buf->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return (buf);
+}
+
+/**
+ * @brief publishes a buffer filled after mcast_snap_begin()
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_snap_commit(struct mcast_snap_buf_t *buf)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	buf->gen = snap->published + 1;
+	buf->ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	__atomic_store_n(&buf->seq, buf->seq + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&snap->published, buf->gen, __ATOMIC_RELEASE);
+	snap_cost_ns = buf->ns - snap_begin_ns;
+	if (snap_cost_ns > snap_cost_max_ns)
+		snap_cost_max_ns = snap_cost_ns;
+}
+
+/**
+ * @brief prints publish counters
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_snap_show(FILE * f)
+{
+	if (snap == NULL)
+		return;
+	fprintf(f, "snapshot: published %llu size %llu bytes last %llu us max %llu us\n",
+		(unsigned long long) snap->published, (unsigned long long) snap_len,
+		(unsigned long long) (snap_cost_ns / 1000), (unsigned long long) (snap_cost_max_ns / 1000));
+}
@@ -0,0 +1,145 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: shared memory snapshot of the group tables                       */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifndef MCAST_SNAP_H
+#define MCAST_SNAP_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define MCAST_SNAP_SHM "/mcastpa-snap"		/* shm_open() name - /dev/shm/mcastpa-snap */
+#define MCAST_SNAP_MAGIC 0x4d43534e		/* "MCSN" */
+#define MCAST_SNAP_VERSION 1
+#define MCAST_SNAP_IFS 256			/* interfaces in one snapshot */
+
+#define MCAST_SNAP_JOINED	1<<0		/**< programmed in the accelerator */
+#define MCAST_SNAP_SOFTWARE	1<<1		/**< refused by the accelerator - software bridged */
+#define MCAST_SNAP_LOCAL	1<<2		/**< added over the control socket - not in the kernel mdb */
+#define MCAST_SNAP_PARKED	1<<3		/**< station left the fdb - out of the accelerator until seen again */
+
+/**
+ * one group - its members are member[first] to member[first + members - 1]
+ */
+struct mcast_snap_group_t {
+	uint8_t family;				/**< AF_INET or AF_INET6 */
+	uint8_t src_family;			/**< AF_INET AF_INET6 or 0 until a route is seen */
+	uint16_t pad;
+	int32_t ifindex;			/**< bridge port that first joined */
+	int32_t br_ifindex;			/**< bridge - 0 for control socket groups */
+	int32_t wan_ifindex;			/**< wan interface */
+	uint32_t first;				/**< index of the first member */
+	uint32_t members;			/**< members of the group */
+	uint32_t sw_members;			/**< members the accelerator refused */
+	uint32_t pad2;
+	uint64_t sw_ms;				/**< total ms the group ran in software */
+	uint8_t group[16];			/**< group address */
+	uint8_t src[16];			/**< video source address */
+};
+
+/**
+ * one group member
+ */
+struct mcast_snap_member_t {
+	uint32_t group;				/**< index of its group */
+	int32_t ifindex;			/**< joined bridge port */
+	uint8_t mac[6];				/**< subscriber srcmac */
+	uint8_t flags;				/**< MCAST_SNAP_ flags */
+	uint8_t retries;			/**< consecutive failed joins */
+};
+
+/**
+ * one interface the groups refer to
+ */
+struct mcast_snap_if_t {
+	int32_t ifindex;
+	int32_t role;				/**< MCAST_IF_ role flags of the daemon */
+	int32_t master;				/**< bridge ifindex of a lan port */
+	uint32_t flags;				/**< IFF_ link flags */
+	char name[16];
+};
+
+/**
+ * one of the two snapshot buffers - followed by the group, member and interface arrays
+ * seq is odd while the daemon writes the buffer
+ */
+struct mcast_snap_buf_t {
+	uint64_t seq;				/**< seqlock - bumped before and after each write */
+	uint64_t gen;				/**< publish number of the contents */
+	uint64_t ns;				/**< CLOCK_MONOTONIC nanoseconds of the publish */
+	uint32_t groups;			/**< groups in use */
+	uint32_t members;			/**< members in use */
+	uint32_t ifs;				/**< interfaces in use */
+	uint32_t pad;
+	uint64_t pad2[3];
+};
+
+/**
+ * shared memory segment - header followed by two buffers of buf_size bytes
+ * readers copy the buffer published selects and retry if its seq moved meanwhile
+ */
+struct mcast_snap_shm_t {
+	uint32_t magic;				/**< MCAST_SNAP_MAGIC */
+	uint32_t version;			/**< MCAST_SNAP_VERSION */
+	uint32_t max_groups;			/**< groups a buffer holds */
+	uint32_t max_members;			/**< members a buffer holds */
+	uint32_t max_ifs;			/**< interfaces a buffer holds */
+	uint16_t group_size;			/**< sizeof (struct mcast_snap_group_t) */
+	uint16_t member_size;			/**< sizeof (struct mcast_snap_member_t) */
+	uint16_t if_size;			/**< sizeof (struct mcast_snap_if_t) */
+	uint16_t pad;
+	uint32_t pad2;
+	uint64_t buf_size;			/**< bytes per buffer including its header */
+	uint64_t published;			/**< gen of the current buffer - buffer published & 1 - 0 if none yet */
+	uint64_t pad3[3];
+};
+
+static inline struct mcast_snap_buf_t *
+mcast_snap_buf(struct mcast_snap_shm_t *shm, uint64_t gen)
+{
+	return ((struct mcast_snap_buf_t *) ((char *) (shm + 1) + (gen & 1) * shm->buf_size));
+}
+
+static inline struct mcast_snap_group_t *
+mcast_snap_groups(struct mcast_snap_shm_t *shm, struct mcast_snap_buf_t *buf)
+{
+	return ((struct mcast_snap_group_t *) (buf + 1));
+}
+
+static inline struct mcast_snap_member_t *
+mcast_snap_members(struct mcast_snap_shm_t *shm, struct mcast_snap_buf_t *buf)
+{
+	return ((struct mcast_snap_member_t *) ((char *) (buf + 1) + (size_t) shm->max_groups * shm->group_size));
+}
+
+static inline struct mcast_snap_if_t *
+mcast_snap_ifs(struct mcast_snap_shm_t *shm, struct mcast_snap_buf_t *buf)
+{
+	return ((struct mcast_snap_if_t *) ((char *) mcast_snap_members(shm, buf) +
+					    (size_t) shm->max_members * shm->member_size));
+}
+
+int mcast_snap_init(uint32_t groups, uint32_t members, uint32_t ifs);
+void mcast_snap_deinit(void);
+struct mcast_snap_buf_t *mcast_snap_begin(struct mcast_snap_shm_t **shm);
+void mcast_snap_commit(struct mcast_snap_buf_t *buf);
+void mcast_snap_show(FILE * f);
+
+#endif
@@ -0,0 +1,455 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: group table microbenchmark                                       */
+/*                                                                           */
+/*****************************************************************************/
+
+
+/**
+
+  @file mcast-tbench.c
+  @author tim.hayes@smartrg.com
+  @brief mcast-pa-tbench - cost of the group table operations at large member counts
+  @details Fills the group table with a synthetic population of (group, port, MAC)
+  memberships and times insert, refresh, leave and the full teardown done on exit through
+  the unmodified table code - mcg_br_entry_head_get(), mcg_br_entry_get(), mcg_br_entry_join(),
+  mcg_br_entry_leave() and mcg_br_entry_head_list_del_all().  Requests go to the null or
+  record backend.  For each table size ns per operation, cache misses per operation when the
+  kernel allows perf counters and group and member pool allocations per operation are printed,
+  the best of the repeats is kept.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <syslog.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+#include <asm/types.h>
+#include <linux/perf_event.h>
+#include "if_bridge.h"
+#include <mcast-pa.h>
+#include <mcast-bench.h>
+#include <mcast-hist.h>
+
+#define TBENCH_IFINDEX_BASE 2			/* first synthetic ifindex - 1 is lo */
+#define TBENCH_SIZES_MAX 8
+
+enum tbench_op_t {
+	TB_INSERT,				/**< new member of a new or existing group */
+	TB_REFRESH,				/**< member already joined */
+	TB_LEAVE,				/**< single member leave */
+	TB_TEARDOWN,				/**< every group left and removed - per member */
+	TB_OPS,
+};
+
+static const char *tbench_op_name[TB_OPS] = { "insert", "refresh", "leave", "teardown" };
+
+enum tbench_ctr_t {
+	TB_CACHE_MISSES,			/**< last level cache misses */
+	TB_L1D_MISSES,				/**< level 1 data cache read misses */
+	TB_CTRS,
+};
+
+struct tbench_result_t {
+	uint64_t ns;				/**< time for all operations of the phase */
+	uint64_t ctr[TB_CTRS];			/**< perf counters for the phase */
+	unsigned long long allocs;		/**< pool allocations during the phase */
+};
+
+struct tbench_t {
+	int bridges;				/**< bridges */
+	int ports;				/**< ports per bridge */
+	int groups;				/**< distinct groups */
+	int per_station;			/**< groups joined by each station */
+	int ipv6;				/**< ff3e:: groups instead of 239.x.y.z */
+	int repeat;				/**< runs per size - the fastest is shown */
+	int sizes[TBENCH_SIZES_MAX];		/**< memberships per run */
+	int nsizes;				/**< entries in sizes */
+	struct mcast_pa_ops_t *pa;		/**< backend */
+	int fd[TB_CTRS];			/**< perf counters - fd[0] leads the group, -1 if unavailable */
+	struct br_mdb_entry *e;			/**< memberships */
+	int *br;				/**< bridge of each membership */
+	int *order;				/**< shuffled membership indexes */
+};
+
+static struct tbench_t tbench;
+
+/**
+ * @brief opens the cache miss counters for this thread
+ * @details the programming worker is not counted
+ * @author tim.hayes@smartrg.com
+ */
+static void
+tbench_perf_open(void)
+{
+	static const uint64_t config[TB_CTRS] = {
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+	};
+	static const uint32_t type[TB_CTRS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+	struct perf_event_attr attr;
+	int i;
+
+	for (i = 0; i < TB_CTRS; i++) {
+		memset(&attr, 0, sizeof (attr));
+		attr.size = sizeof (attr);
+		attr.type = type[i];
+		attr.config = config[i];
+		attr.disabled = (i == 0);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		tbench.fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i ? tbench.fd[0] : -1, 0);
+		if (tbench.fd[i] < 0) {
+			if (i == 0)
+				printf("no cache miss counters: %s\n", strerror(errno));
+			break;
+		}
+	}
+	for (; i < TB_CTRS; i++)
+		tbench.fd[i] = -1;
+}
+
+static void
+tbench_start(struct tbench_result_t *r)
+{
+	memset(r, 0, sizeof (struct tbench_result_t));
+	r->allocs = mcastpa_bench_allocs();
+	if (tbench.fd[0] >= 0) {
+		ioctl(tbench.fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(tbench.fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+	r->ns = mcast_hist_now();
+}
+
+static void
+tbench_stop(struct tbench_result_t *r)
+{
+	int i;
+
+	r->ns = mcast_hist_now() - r->ns;
+	if (tbench.fd[0] >= 0)
+		ioctl(tbench.fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	for (i = 0; i < TB_CTRS; i++) {
+		if ((tbench.fd[i] < 0) || (read(tbench.fd[i], &r->ctr[i], sizeof (uint64_t)) != sizeof (uint64_t)))
+			r->ctr[i] = 0;
+	}
+	r->allocs = mcastpa_bench_allocs() - r->allocs;
+}
+
+/**
+ * @brief lets the programming worker and the result handling run empty
+ * @details not timed
+ * @author tim.hayes@smartrg.com
+ */
+static void
+tbench_drain(void)
+{
+	struct timespec ts = { 0, 100000 };
+	int timeout;
+
+	while ((timeout = mcastpa_bench_timeout()) >= 0) {
+		if (timeout > 0)
+			nanosleep(&ts, NULL);
+		mcastpa_bench_input(NULL, 0);
+	}
+}
+
+/**
+ * @brief builds n memberships
+ * @details stations get consecutive macs and are spread over the bridge ports, each joins
+ * @details per_station groups starting at a random one so groups fill unevenly as they do
+ * @returns 0 if OK -1 otherwise
+ * @author tim.hayes@smartrg.com
+ */
+static int
+tbench_population(int n)
+{
+	struct br_mdb_entry *e;
+	int station;
+	int first = 0;
+	int group;
+	int b;
+	int i;
+	int j;
+
+	free(tbench.e);
+	free(tbench.br);
+	free(tbench.order);
+	tbench.e = calloc(n, sizeof (struct br_mdb_entry));
+	tbench.br = calloc(n, sizeof (int));
+	tbench.order = calloc(n, sizeof (int));
+	if ((tbench.e == NULL) || (tbench.br == NULL) || (tbench.order == NULL))
+		return (-1);
+
+	for (i = 0; i < n; i++) {
+		station = i / tbench.per_station;
+		if ((i % tbench.per_station) == 0)
+			first = lrand48() % tbench.groups;
+		group = (first + i % tbench.per_station) % tbench.groups;
+		b = station % tbench.bridges;
+		e = &tbench.e[i];
+		tbench.br[i] = TBENCH_IFINDEX_BASE + b;
+		e->ifindex = TBENCH_IFINDEX_BASE + tbench.bridges + b * tbench.ports +
+		    (station / tbench.bridges) % tbench.ports;
+		e->state = MDB_TEMPORARY;
+		e->src_addr.eth_addr[0] = 0x02;
+		e->src_addr.eth_addr[2] = station >> 24;
+		e->src_addr.eth_addr[3] = station >> 16;
+		e->src_addr.eth_addr[4] = station >> 8;
+		e->src_addr.eth_addr[5] = station;
+		if (tbench.ipv6) {
+			e->addr.proto = htons(ETH_P_IPV6);
+			inet_pton(AF_INET6, "ff3e::4000:0", &e->addr.u.ip6);
+			e->addr.u.ip6.s6_addr[14] = group >> 8;
+			e->addr.u.ip6.s6_addr[15] = group;
+		} else {
+			e->addr.proto = htons(ETH_P_IP);
+			e->addr.u.ip4 = htonl(0xef000000 | (group + 0x10000));
+		}
+		tbench.order[i] = i;
+	}
+
+	/* fisher-yates */
+	for (i = n - 1; i > 0; i--) {
+		j = lrand48() % (i + 1);
+		b = tbench.order[i];
+		tbench.order[i] = tbench.order[j];
+		tbench.order[j] = b;
+	}
+	return (0);
+}
+
+/**
+ * @brief one pass of every operation over n memberships
+ * @returns memberships that did not fit in the pools
+ * @author tim.hayes@smartrg.com
+ */
+static int
+tbench_run(int n, struct tbench_result_t *r)
+{
+	struct mcastpa_bench_params_t bp;
+	int fails = 0;
+	int i;
+
+	memset(&bp, 0, sizeof (bp));
+	bp.src.family = tbench.ipv6 ? AF_INET6 : AF_INET;
+	inet_pton(bp.src.family, tbench.ipv6 ? "2001:db8::1" : "192.0.2.1", &bp.src.u);
+	bp.max_groups = tbench.groups;
+	bp.max_members = n;
+	/* the teardown queues a leave for every member at once */
+	bp.pq_size = n;
+	bp.pa = tbench.pa;
+	if (mcastpa_bench_init(&bp) < 0)
+		return (-1);
+
+	tbench_start(&r[TB_INSERT]);
+	for (i = 0; i < n; i++) {
+		if (mcastpa_bench_table_add(tbench.br[i], &tbench.e[i]) < 0)
+			fails++;
+	}
+	tbench_stop(&r[TB_INSERT]);
+	tbench_drain();
+
+	tbench_start(&r[TB_REFRESH]);
+	for (i = 0; i < n; i++)
+		mcastpa_bench_table_add(tbench.br[tbench.order[i]], &tbench.e[tbench.order[i]]);
+	tbench_stop(&r[TB_REFRESH]);
+	tbench_drain();
+
+	tbench_start(&r[TB_LEAVE]);
+	for (i = 0; i < n; i++)
+		mcastpa_bench_table_del(&tbench.e[tbench.order[i]]);
+	tbench_stop(&r[TB_LEAVE]);
+	tbench_drain();
+
+	for (i = 0; i < n; i++)
+		mcastpa_bench_table_add(tbench.br[i], &tbench.e[i]);
+	tbench_drain();
+	tbench_start(&r[TB_TEARDOWN]);
+	mcastpa_bench_table_teardown();
+	tbench_stop(&r[TB_TEARDOWN]);
+	tbench_drain();
+
+	mcastpa_bench_deinit();
+	return (fails);
+}
+
+static void
+tbench_show(int n, struct tbench_result_t *best)
+{
+	int op;
+
+	printf("%-9s %8s %10s %12s %12s %10s\n", "op", "ops", "ns/op", "misses/op", "l1d/op", "allocs/op");
+	for (op = 0; op < TB_OPS; op++) {
+		printf("%-9s %8d %10.1f", tbench_op_name[op], n, (double) best[op].ns / n);
+		if (tbench.fd[TB_CACHE_MISSES] >= 0)
+			printf(" %12.2f", (double) best[op].ctr[TB_CACHE_MISSES] / n);
+		else
+			printf(" %12s", "-");
+		if (tbench.fd[TB_L1D_MISSES] >= 0)
+			printf(" %12.2f", (double) best[op].ctr[TB_L1D_MISSES] / n);
+		else
+			printf(" %12s", "-");
+		printf(" %10.2f\n", (double) best[op].allocs / n);
+	}
+}
+
+static void
+usage(void)
+{
+	printf("mcast-pa-tbench [options]\n");
+	printf(" -n memberships - comma separated sizes (1000,10000,100000)\n");
+	printf(" -b bridges         (1)\n");
+	printf(" -p ports per bridge (8)\n");
+	printf(" -g groups          (1000)\n");
+	printf(" -k groups per station (1)\n");
+	printf(" -r repeats - the fastest is shown (3)\n");
+	printf(" -P backend         (null) one of: ");
+	mcast_pa_ops_list(stdout);
+	printf(" -6 ipv6 groups\n");
+	printf(" -S random seed\n");
+	printf(" -v log engine messages to syslog\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct tbench_result_t best[TB_OPS];
+	struct tbench_result_t r[TB_OPS];
+	const char *backend = "null";
+	char *tok;
+	long seed = 1;
+	int verbose = 0;
+	int fails;
+	int opt;
+	int op;
+	int s;
+	int i;
+
+	tbench.bridges = 1;
+	tbench.ports = 8;
+	tbench.groups = 1000;
+	tbench.per_station = 1;
+	tbench.repeat = 3;
+
+	while ((opt = getopt(argc, argv, "n:b:p:g:k:r:P:6S:vh")) != -1) {
+		switch (opt) {
+		case 'n':
+			tbench.nsizes = 0;
+			for (tok = strtok(optarg, ","); tok && (tbench.nsizes < TBENCH_SIZES_MAX); tok = strtok(NULL, ","))
+				tbench.sizes[tbench.nsizes++] = atoi(tok);
+			break;
+		case 'b':
+			tbench.bridges = atoi(optarg);
+			break;
+		case 'p':
+			tbench.ports = atoi(optarg);
+			break;
+		case 'g':
+			tbench.groups = atoi(optarg);
+			break;
+		case 'k':
+			tbench.per_station = atoi(optarg);
+			break;
+		case 'r':
+			tbench.repeat = atoi(optarg);
+			break;
+		case 'P':
+			backend = optarg;
+			break;
+		case '6':
+			tbench.ipv6 = 1;
+			break;
+		case 'S':
+			seed = atol(optarg);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage();
+			exit(0);
+		}
+	}
+	if (tbench.nsizes == 0) {
+		tbench.sizes[0] = 1000;
+		tbench.sizes[1] = 10000;
+		tbench.sizes[2] = 100000;
+		tbench.nsizes = 3;
+	}
+	if ((tbench.bridges < 1) || (tbench.ports < 1) || (tbench.groups < 1) || (tbench.groups > 0xffff) ||
+	    (tbench.per_station < 1) || (tbench.per_station > tbench.groups) || (tbench.repeat < 1)) {
+		usage();
+		exit(-1);
+	}
+	for (s = 0; s < tbench.nsizes; s++) {
+		if (tbench.sizes[s] < 1) {
+			usage();
+			exit(-1);
+		}
+	}
+	tbench.pa = mcast_pa_ops_get(backend);
+	if (tbench.pa == NULL) {
+		usage();
+		exit(-1);
+	}
+
+	openlog("mcast-pa-tbench", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_LOCAL1);
+	setlogmask(verbose ? LOG_UPTO(LOG_INFO) : LOG_UPTO(LOG_ERR));
+	srand48(seed);
+	tbench_perf_open();
+
+	printf("backend %s bridges %d ports %d groups %d groups per station %d %s best of %d\n", tbench.pa->name,
+	       tbench.bridges, tbench.ports, tbench.groups, tbench.per_station, tbench.ipv6 ? "ipv6" : "ipv4",
+	       tbench.repeat);
+	for (s = 0; s < tbench.nsizes; s++) {
+		if (tbench_population(tbench.sizes[s]) < 0) {
+			printf("cannot allocate %d memberships\n", tbench.sizes[s]);
+			exit(-1);
+		}
+		for (i = 0; i < tbench.repeat; i++) {
+			fails = tbench_run(tbench.sizes[s], r);
+			if (fails < 0) {
+				printf("cannot start the engine\n");
+				exit(-1);
+			}
+			if (fails > 0)
+				printf("%d memberships did not fit in the pools\n", fails);
+			for (op = 0; op < TB_OPS; op++) {
+				if ((i == 0) || (r[op].ns < best[op].ns))
+					best[op] = r[op];
+			}
+		}
+		printf("\nmemberships %d stations %d\n", tbench.sizes[s],
+		       (tbench.sizes[s] + tbench.per_station - 1) / tbench.per_station);
+		tbench_show(tbench.sizes[s], best);
+	}
+
+	closelog();
+	return (0);
+}
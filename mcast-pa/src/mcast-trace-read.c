@@ -0,0 +1,176 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: reader for the mcast-pa event trace ring                         */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-trace-read.c
+  @author tim.hayes@smartrg.com
+  @brief mcastpa-trace - decodes the mcast-pa trace ring
+  @details Maps /dev/shm/mcastpa-trace read only and prints the records still in the ring,
+  oldest first.  With -f it keeps following new records.  The daemon is never stopped or
+  signalled.  Records overwritten while being copied are skipped.
+
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <mcast-trace.h>
+
+static const char *ev_names[MT_EV_MAX] = {
+	[MT_NL_RECV] = "nl-recv",
+	[MT_NL_MSG] = "nl-msg",
+	[MT_NL_OVERFLOW] = "nl-overflow",
+	[MT_HEAD_ADD] = "head-add",
+	[MT_HEAD_DEL] = "head-del",
+	[MT_MBR_ADD] = "member-add",
+	[MT_MBR_DEL] = "member-del",
+	[MT_ROUTE] = "route",
+	[MT_JOIN_ENTER] = "join>",
+	[MT_JOIN_EXIT] = "join<",
+	[MT_LEAVE_ENTER] = "leave>",
+	[MT_LEAVE_EXIT] = "leave<",
+	[MT_RESYNC] = "resync",
+	[MT_REDUMP] = "redump",
+};
+
+/**
+ * @brief copies a complete record out of the ring
+ * @returns 1 if the record for slot was copied 0 if it is overwritten or not yet written
+ * @author tim.hayes@smartrg.com
+ */
+static int
+trace_rec_get(struct mcast_trace_shm_t *trace, uint64_t slot, struct mcast_trace_rec_t *out)
+{
+	struct mcast_trace_rec_t *rec = &trace->rec[slot & (trace->entries - 1)];
+
+	if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != slot + 1)
+		return (0);
+	memcpy(out, rec, sizeof (struct mcast_trace_rec_t));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (__atomic_load_n(&rec->seq, __ATOMIC_RELAXED) == slot + 1);
+}
+
+/**
+ * @brief prints one record
+ * @author tim.hayes@smartrg.com
+ */
+static void
+trace_rec_print(struct mcast_trace_rec_t *rec, uint64_t base)
+{
+	char abuf[INET6_ADDRSTRLEN] = "-";
+	uint64_t us = (rec->ns - base) / 1000;
+
+	if (rec->family)
+		inet_ntop(rec->family, rec->group, abuf, sizeof (abuf));
+	printf("%6llu.%06llu %c %-11s if %-3d grp %-20s mac %02x:%02x:%02x:%02x:%02x:%02x res %-4d arg %u\n",
+	       (unsigned long long) (us / 1000000), (unsigned long long) (us % 1000000), rec->thread ? 'W' : 'N',
+	       rec->ev < MT_EV_MAX && ev_names[rec->ev] ? ev_names[rec->ev] : "?", rec->ifindex, abuf, rec->mac[0],
+	       rec->mac[1], rec->mac[2], rec->mac[3], rec->mac[4], rec->mac[5], rec->res, rec->arg);
+}
+
+static void
+usage(void)
+{
+	printf("mcastpa-trace [-f]\n");
+	printf(" -f follow - keep printing new records\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct mcast_trace_shm_t *trace;
+	struct mcast_trace_rec_t rec;
+	struct stat st;
+	uint64_t slot;
+	uint64_t head;
+	uint64_t base = 0;
+	uint64_t lost = 0;
+	int follow = 0;
+	int fd;
+	int c;
+
+	while ((c = getopt(argc, argv, "fh")) != -1) {
+		switch (c) {
+		case 'f':
+			follow = 1;
+			break;
+		default:
+			usage();
+			exit(0);
+		}
+	}
+
+	fd = shm_open(MCAST_TRACE_SHM, O_RDONLY, 0);
+	if ((fd < 0) || (fstat(fd, &st) < 0)) {
+		printf("no trace segment %s - is mcast-pa running?\n", MCAST_TRACE_SHM);
+		exit(-1);
+	}
+	trace = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (trace == MAP_FAILED) {
+		printf("cannot map %s\n", MCAST_TRACE_SHM);
+		exit(-1);
+	}
+	if ((trace->magic != MCAST_TRACE_MAGIC) || (trace->version != MCAST_TRACE_VERSION) ||
+	    (trace->rec_size != sizeof (struct mcast_trace_rec_t)) ||
+	    (st.st_size < sizeof (*trace) + (uint64_t) trace->entries * trace->rec_size)) {
+		printf("trace segment version mismatch\n");
+		exit(-1);
+	}
+
+	head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+	slot = head > trace->entries ? head - trace->entries : 0;
+	do {
+		for (; slot < head; slot++) {
+			if (!trace_rec_get(trace, slot, &rec)) {
+				lost++;
+				continue;
+			}
+			if (base == 0)
+				base = rec.ns;
+			trace_rec_print(&rec, base);
+		}
+		if (follow) {
+			usleep(100000);
+			head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+			if (head - slot > trace->entries) {
+				lost += head - slot - trace->entries;
+				slot = head - trace->entries;
+			}
+		}
+	} while (follow);
+
+	if (lost)
+		printf("%llu records overwritten while reading\n", (unsigned long long) lost);
+	munmap(trace, st.st_size);
+	return (0);
+}
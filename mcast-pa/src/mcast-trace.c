@@ -0,0 +1,161 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: binary event trace ring in shared memory                         */
+/*                                                                           */
+/*****************************************************************************/
+
+/**
+
+  @file mcast-trace.c
+  @author tim.hayes@smartrg.com
+  @brief Always on event trace
+  @details Netlink receive, group table changes and driver calls are written as fixed size binary
+  records to a ring in a shared memory segment.  Writers on either thread take a slot with one
+  atomic add and never block.  mcastpa-trace maps the segment read only and decodes it while
+  the daemon runs - no syslog, no --verbose, no change in timing.
+
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <syslog.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <mcast-trace.h>
+
+static struct mcast_trace_shm_t *trace;
+static size_t trace_len;
+static __thread uint8_t trace_thread;
+
+/**
+ * @brief creates and maps the trace segment
+ * @details the daemon keeps tracing into private memory if shm is not available
+ * @returns 0 if OK -1 if tracing is off
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+int
+mcast_trace_init(void)
+{
+	int fd;
+	void *p;
+
+	trace_len = sizeof (struct mcast_trace_shm_t) + MCAST_TRACE_ENTRIES * sizeof (struct mcast_trace_rec_t);
+	fd = shm_open(MCAST_TRACE_SHM, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if ((fd >= 0) && (ftruncate(fd, trace_len) == 0)) {
+		p = mmap(NULL, trace_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	} else {
+		syslog(LOG_NOTICE, "%s:%d no shm for %s - trace is private\n", __FUNCTION__, __LINE__,
+		       MCAST_TRACE_SHM);
+		p = mmap(NULL, trace_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	if (fd >= 0)
+		close(fd);
+	if (p == MAP_FAILED)
+		return (-1);
+
+	trace = (struct mcast_trace_shm_t *) p;
+	memset(trace, 0, trace_len);
+	trace->entries = MCAST_TRACE_ENTRIES;
+	trace->rec_size = sizeof (struct mcast_trace_rec_t);
+	trace->version = MCAST_TRACE_VERSION;
+	__atomic_store_n(&trace->magic, MCAST_TRACE_MAGIC, __ATOMIC_RELEASE);
+	return (0);
+}
+
+/**
+ * @brief unmaps and removes the trace segment
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_trace_deinit(void)
+{
+	if (trace == NULL)
+		return;
+	munmap(trace, trace_len);
+	trace = NULL;
+	shm_unlink(MCAST_TRACE_SHM);
+}
+
+/**
+ * @brief names the calling thread in its records
+ * @details
+ * @note
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_trace_thread(uint8_t thread)
+{
+	trace_thread = thread;
+}
+
+/**
+ * @brief writes one trace record
+ * @details group is a binary in_addr or in6_addr, group and mac may be NULL
+ * @note safe from any thread - a slow writer lapped by the ring only loses its own record
+ * @author tim.hayes@smartrg.com
+ * @callgraph
+ * @callergraph
+ */
+void
+mcast_trace(int ev, int family, const void *group, int ifindex, const unsigned char *mac, int res, uint32_t arg)
+{
+	struct mcast_trace_rec_t *rec;
+	struct timespec ts;
+	uint64_t slot;
+
+	if (trace == NULL)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	slot = __atomic_fetch_add(&trace->head, 1, __ATOMIC_RELAXED);
+	rec = &trace->rec[slot & (MCAST_TRACE_ENTRIES - 1)];
+
+	__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rec->ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	rec->ev = ev;
+	rec->thread = trace_thread;
+	rec->ifindex = ifindex;
+	rec->res = res;
+	rec->arg = arg;
+	memset(rec->group, 0, sizeof (rec->group));
+	rec->family = 0;
+	if (group != NULL) {
+		rec->family = family;
+		memcpy(rec->group, group, family == AF_INET6 ? 16 : 4);
+	}
+	if (mac != NULL)
+		memcpy(rec->mac, mac, sizeof (rec->mac));
+	else
+		memset(rec->mac, 0, sizeof (rec->mac));
+	__atomic_store_n(&rec->seq, slot + 1, __ATOMIC_RELEASE);
+}
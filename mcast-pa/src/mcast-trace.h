@@ -0,0 +1,86 @@
+/*****************************************************************************/
+/*               _____                      _  ______ _____                  */
+/*              /  ___|                    | | | ___ \  __ \                 */
+/*              \ `--. _ __ ___   __ _ _ __| |_| |_/ / |  \/                 */
+/*               `--. \ '_ ` _ \ / _` | '__| __|    /| | __                  */
+/*              /\__/ / | | | | | (_| | |  | |_| |\ \| |_\ \                 */
+/*             \____/|_| |_| |_|\__,_|_|   \__\_| \_|\____/ Inc.             */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/*                       copyright 2018 by SmartRG, Inc.                     */
+/*                              Santa Barbara, CA                            */
+/*                                                                           */
+/*****************************************************************************/
+/*                                                                           */
+/* Author: tim.hayes@smartrg.com                                             */
+/*                                                                           */
+/* Purpose: binary event trace ring in shared memory                         */
+/*                                                                           */
+/*****************************************************************************/
+#ifndef MCAST_TRACE_H
+#define MCAST_TRACE_H
+
+#include <stdint.h>
+
+#define MCAST_TRACE_SHM "/mcastpa-trace"	/* shm_open() name - /dev/shm/mcastpa-trace */
+#define MCAST_TRACE_MAGIC 0x4d435452		/* "MCTR" */
+#define MCAST_TRACE_VERSION 1
+#define MCAST_TRACE_ENTRIES 4096		/* records in the ring - must be a power of 2 */
+
+enum mcast_trace_ev_t {
+	MT_NL_RECV = 1,				/**< netlink read - arg bytes */
+	MT_NL_MSG,				/**< netlink message - arg nlmsg_type */
+	MT_NL_OVERFLOW,				/**< netlink ENOBUFS */
+	MT_HEAD_ADD,				/**< group head created */
+	MT_HEAD_DEL,				/**< group head freed */
+	MT_MBR_ADD,				/**< group member created */
+	MT_MBR_DEL,				/**< group member freed */
+	MT_ROUTE,				/**< video source learned from an mroute */
+	MT_JOIN_ENTER,				/**< pa_join() called - arg attempt */
+	MT_JOIN_EXIT,				/**< pa_join() returned - res driver result */
+	MT_LEAVE_ENTER,				/**< pa_leave() called - arg attempt */
+	MT_LEAVE_EXIT,				/**< pa_leave() returned - res driver result */
+	MT_RESYNC,				/**< mdb resync after lost netlink messages */
+	MT_REDUMP,				/**< periodic mdb redump */
+	MT_EV_MAX
+};
+
+/**
+ * one trace record - 64 bytes
+ * seq is zero while the record is written and slot + 1 once it is complete
+ */
+struct mcast_trace_rec_t {
+	uint64_t seq;				/**< ring slot + 1 - written last */
+	uint64_t ns;				/**< CLOCK_MONOTONIC nanoseconds */
+	uint16_t ev;				/**< enum mcast_trace_ev_t */
+	uint8_t thread;				/**< 0 netlink thread 1 programming worker */
+	uint8_t family;				/**< AF_INET AF_INET6 or 0 if no group */
+	int32_t ifindex;			/**< bridge port or interface */
+	int32_t res;				/**< driver return code */
+	uint32_t arg;				/**< event specific */
+	uint8_t group[16];			/**< group address */
+	uint8_t mac[6];				/**< subscriber srcmac */
+	uint8_t pad[2];
+};
+
+/**
+ * shared memory segment - header followed by the ring
+ */
+struct mcast_trace_shm_t {
+	uint32_t magic;				/**< MCAST_TRACE_MAGIC */
+	uint32_t version;			/**< MCAST_TRACE_VERSION */
+	uint32_t entries;			/**< records in rec[] */
+	uint32_t rec_size;			/**< sizeof (struct mcast_trace_rec_t) */
+	uint64_t head;				/**< next slot - taken with an atomic add by each writer */
+	uint64_t pad[5];
+	struct mcast_trace_rec_t rec[];		/**< the ring */
+};
+
+int mcast_trace_init(void);
+void mcast_trace_deinit(void);
+void mcast_trace_thread(uint8_t thread);
+void mcast_trace(int ev, int family, const void *group, int ifindex, const unsigned char *mac, int res,
+		 uint32_t arg);
+
+#endif